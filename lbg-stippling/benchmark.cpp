@@ -0,0 +1,85 @@
+/*
+ *      Micro-benchmarks of the LBG sampling stages on a synthetic fovea density:
+ *      voronoi diagram computation, cell accumulation and the natural neighbor stage.
+ *      Uses the harness of the volume raycaster (../src/bench/microbenchmark.h).
+ */
+
+#include <QApplication>
+#include <QtMath>
+#include <random>
+
+#include "lbgstippling.h"
+#include "voronoicell.h"
+#include "voronoidiagram.h"
+#include "../src/bench/microbenchmark.h"
+
+QImage syntheticDensity(int size) {
+    QImage density(size, size, QImage::Format_Grayscale8);
+    const float sigma = size * 0.15f;
+    for (int y = 0; y < density.height(); ++y) {
+        uchar* line = density.scanLine(y);
+        for (int x = 0; x < density.width(); ++x) {
+            const float dx = x - size * 0.5f;
+            const float dy = y - size * 0.5f;
+            const float g = qExp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            line[x] = static_cast<uchar>(qMin(static_cast<int>((1.0f - g) * 255.0f), 254));
+        }
+    }
+    return density;
+}
+
+QVector<QVector2D> randomPoints(int n) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dis(0.01f, 0.99f);
+    QVector<QVector2D> points(n);
+    for (auto& p : points) p = QVector2D(dis(gen), dis(gen));
+    return points;
+}
+
+int main(int argc, char* argv[]) {
+    QApplication app(argc, argv);
+    app.setApplicationName("LBGSamplingBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks of the LBG sampling stages.");
+    parser.addHelpOption();
+    MicroBenchmark::addOptions(parser);
+    parser.addOptions({{"size", "Edge length of the density map.", "pixels", "512"},
+                       {"points", "Number of voronoi sites.", "points", "10000"},
+                       {"rows", "Index map rows of the natural neighbor stage.", "rows", "2"}});
+    parser.process(app);
+
+    MicroBenchmark bench;
+    bench.configure(parser);
+    const int size = qMax(16, parser.value("size").toInt());
+    const int pointCount = qMax(static_cast<int>(NeighborBucketCount) + 1, parser.value("points").toInt());
+    const int rows = qBound(1, parser.value("rows").toInt(), size);
+    bench.setMetadata("size", QString::number(size));
+    bench.setMetadata("points", QString::number(pointCount));
+    bench.setMetadata("rows", QString::number(rows));
+
+    QImage density = syntheticDensity(size);
+    VoronoiDiagram voronoi(density);
+    const QVector<QVector2D> points = randomPoints(pointCount);
+
+    IndexMap indexMap = voronoi.calculate(points);
+    bench.run("VoronoiDiagram::calculate", [&]() {
+        return MicroBenchmark::wallTime([&]() { indexMap = voronoi.calculate(points); });
+    });
+    bench.run("accumulateCells", [&]() {
+        return MicroBenchmark::wallTime([&]() { accumulateCells(indexMap, density); });
+    });
+
+    // identity morton mapping, the ordering does not influence the work
+    QList<unsigned int> point2morton;
+    for (int i = 0; i < points.size(); ++i) point2morton.append(static_cast<unsigned int>(i));
+    std::vector<uint32_t> ids(indexMap.width * rows * NeighborBucketCount, 0);
+    std::vector<float> weights(indexMap.width * rows * NeighborBucketCount, 0.0f);
+    bench.run("naturalNeighbors", [&]() {
+        return MicroBenchmark::wallTime([&]() {
+            naturalNeighbors(voronoi, points, indexMap, point2morton, size / 2, rows, ids, weights);
+        });
+    });
+
+    return bench.finish() > 0 ? 2 : 0;
+}
@@ -164,6 +164,125 @@ unsigned int encodeMorton(QVector2D p, size_t width, size_t height)
     return  x | (y << 1);
 }
 
+/**
+ * @brief naturalNeighbors
+ * Insert a point at every pixel and collect the cells it steals from in the modified
+ * voronoi diagram.
+ * @param firstRow First index map row to process
+ * @param rows Number of rows, the neighbor maps have to hold rows * width * NeighborBucketCount
+ */
+void naturalNeighbors(VoronoiDiagram& voronoi, const QVector<QVector2D>& points,
+                      const IndexMap& indexMap, const QList<unsigned int>& point2morton,
+                      const int firstRow, const int rows,
+                      std::vector<uint32_t>& neighborIndexMap,
+                      std::vector<float>& neighborWeightMap) {
+    const size_t BucketCount = NeighborBucketCount;
+    using namespace nanoflann;
+    typedef KDTreeSingleIndexAdaptor<L2_Simple_Adaptor<float, QVectorAdaptor>, QVectorAdaptor, 2>
+        my_kd_tree_t;
+
+    QVectorAdaptor adaptor(points);
+    my_kd_tree_t index(2, adaptor, KDTreeSingleIndexAdaptorParams(10));
+    index.buildIndex();
+
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+//    QElapsedTimer perfTimer;
+//    perfTimer.start();
+
+    const size_t k = BucketCount; // + 4;
+    std::vector<size_t> ret_indices(k);
+    std::vector<float> out_dists_sqr(k);
+
+    for (int y = firstRow; y < firstRow + rows; ++y)
+    {
+        int yOffset = (y - firstRow);
+        for (int x = 0; x < indexMap.width; ++x)
+        {
+            if (x == 1 && (y % 10 == 0))
+            {
+                float pointsTotal = static_cast<float>(indexMap.width * rows);
+                float pointsProgress = static_cast<float>(yOffset * indexMap.width + x) / pointsTotal;
+                auto elapsedTime = progressTimer.elapsed();
+                auto remainingTime = ((1. - pointsProgress) / pointsProgress) * elapsedTime;
+                qDebug() << "Natural Neighbor" << qSetRealNumberPrecision(5) << pointsProgress
+                         << elapsedTime / 1000. << "sec" << remainingTime / 1000. / 60. << "min";
+            }
+
+            // Insert point at pixel to compute the modified voronoi diagram.
+            QVector2D modifierPoint(static_cast<float>(x) / indexMap.width,
+                                    static_cast<float>(y) / indexMap.height);
+            QVector<QVector2D> pointsModified;
+
+            float query_pt[2] = {modifierPoint.x(), modifierPoint.y()};
+            nanoflann::KNNResultSet<float> resultSet(k);
+            resultSet.init(&ret_indices[0], &out_dists_sqr[0]);
+            bool yay = index.findNeighbors(resultSet, &query_pt[0], nanoflann::SearchParams());
+            assert(yay && "Ohne KNN gehts halt net");
+            for (size_t i = 0; i < k; ++i) { pointsModified.append(points[ret_indices[i]]); }
+
+            pointsModified.append(modifierPoint);
+            IndexMap indexMapModified = voronoi.calculate(pointsModified);
+
+            // Count intersection for each cell in the original index map.
+            float intersectionSum = 0;
+            QMap<uint32_t, float> intersectionSet;
+            uint32_t modifierPointIndex = indexMapModified.get(x, y);
+
+            int kernelHeight = 32;  //indexMapModified.height /4;
+            int kernelWidth = 32;   //indexMapModified.width /4;
+            bool overflow = false;
+//#pragma omp parallel for
+            for (int yy = std::max(yOffset - kernelHeight, 0); yy < std::min(y + kernelHeight, static_cast<int>(indexMapModified.height)); ++yy)
+            {
+                for (int xx = std::max(x - kernelWidth, 0); xx < std::min(x + kernelWidth, static_cast<int>(indexMapModified.width)); ++xx)
+                {
+                    if (indexMapModified.get(xx, yy) == modifierPointIndex)
+                    {
+                        if (intersectionSet.size() >= BucketCount)
+                        {
+//                            qDebug() << "__Bucket overflow on pixel" << x << y;
+                            overflow = true;
+                        }
+                        else
+                        {
+                            intersectionSum++;
+                        }
+                        // encode in morton order
+                        auto originalIndex = point2morton.value(indexMap.get(xx, yy));
+                        intersectionSet[originalIndex]++;
+                    }
+                }
+            }            
+//            qDebug() << "# pixels" << intersectionSum << "time " << perfTimer.restart();
+//            assert(intersectionSet.size() < BucketCount && "Mehr geht halt net erstmal...");
+
+            auto smap = intersectionSet.toStdMap();
+            while (smap.size() > BucketCount)
+            {
+                qDebug() << "__Bucket overflow on pixel" << x << y << "size" << smap.size();
+                auto it = min_element(smap.begin(), smap.end(),
+                                      [](decltype(smap)::value_type & l, decltype(smap)::value_type& r) -> bool { return l.second < r.second; });
+                smap.erase(it);
+            }
+            intersectionSet = QMap<uint32_t, float>(smap);
+
+            // Normalize weights and copy to neighbor maps.
+            size_t bucketIndex = 0;
+            for (auto key : intersectionSet.keys())
+            {
+                intersectionSet[key] = intersectionSet[key] / intersectionSum;
+                auto offset = (yOffset * indexMap.width + x) * BucketCount + bucketIndex;
+                neighborIndexMap[offset] = key;
+                neighborWeightMap[offset] = intersectionSet[key];
+                bucketIndex++;
+            }
+        }
+    }
+
+}
+
 LBGStippling::Result LBGStippling::stipple(const QImage& density, const Params& params,
                                            const int batchCount, const int batchNo) const {
     QImage densityGray =
@@ -287,7 +406,7 @@ LBGStippling::Result LBGStippling::stipple(const QImage& density, const Params&
     QList<unsigned int> point2morton = mortonMap.values();
 
     const size_t batchSize = indexMap.height / batchCount;
-    const size_t BucketCount = 16;
+    const size_t BucketCount = NeighborBucketCount;
     std::vector<uint32_t> neighborIndexMap;
     std::vector<float> neighborWeightMap;
 
@@ -298,109 +417,8 @@ LBGStippling::Result LBGStippling::stipple(const QImage& density, const Params&
     qDebug() << "Starting batch" << batchNo << "/" << batchCount << "with size" << batchSize
              << indexMap.width << "x" << indexMap.height;
 
-    using namespace nanoflann;
-    typedef KDTreeSingleIndexAdaptor<L2_Simple_Adaptor<float, QVectorAdaptor>, QVectorAdaptor, 2>
-        my_kd_tree_t;
-
-    QVectorAdaptor adaptor(points);
-    my_kd_tree_t index(2, adaptor, KDTreeSingleIndexAdaptorParams(10));
-    index.buildIndex();
-
-    QElapsedTimer progressTimer;
-    progressTimer.start();
-
-//    QElapsedTimer perfTimer;
-//    perfTimer.start();
-
-    const size_t k = BucketCount; // + 4;
-    std::vector<size_t> ret_indices(k);
-    std::vector<float> out_dists_sqr(k);
-
-    for (int y = batchNo*batchSize; y < batchNo*batchSize + batchSize; ++y)
-    {
-        int yOffset = (y - batchNo * batchSize);
-        for (int x = 0; x < indexMap.width; ++x)
-        {
-            if (x == 1 && (y % 10 == 0))
-            {
-                float pointsTotal = static_cast<float>(indexMap.width * batchSize);
-                float pointsProgress = static_cast<float>(yOffset * indexMap.width + x) / pointsTotal;
-                auto elapsedTime = progressTimer.elapsed();
-                auto remainingTime = ((1. - pointsProgress) / pointsProgress) * elapsedTime;
-                qDebug() << "Natural Neighbor" << qSetRealNumberPrecision(5) << pointsProgress
-                         << elapsedTime / 1000. << "sec" << remainingTime / 1000. / 60. << "min";
-            }
-
-            // Insert point at pixel to compute the modified voronoi diagram.
-            QVector2D modifierPoint(static_cast<float>(x) / indexMap.width,
-                                    static_cast<float>(y) / indexMap.height);
-            QVector<QVector2D> pointsModified;
-
-            float query_pt[2] = {modifierPoint.x(), modifierPoint.y()};
-            nanoflann::KNNResultSet<float> resultSet(k);
-            resultSet.init(&ret_indices[0], &out_dists_sqr[0]);
-            bool yay = index.findNeighbors(resultSet, &query_pt[0], nanoflann::SearchParams());
-            assert(yay && "Ohne KNN gehts halt net");
-            for (size_t i = 0; i < k; ++i) { pointsModified.append(points[ret_indices[i]]); }
-
-            pointsModified.append(modifierPoint);
-            IndexMap indexMapModified = voronoi.calculate(pointsModified);
-
-            // Count intersection for each cell in the original index map.
-            float intersectionSum = 0;
-            QMap<uint32_t, float> intersectionSet;
-            uint32_t modifierPointIndex = indexMapModified.get(x, y);
-
-            int kernelHeight = 32;  //indexMapModified.height /4;
-            int kernelWidth = 32;   //indexMapModified.width /4;
-            bool overflow = false;
-//#pragma omp parallel for
-            for (int yy = std::max(yOffset - kernelHeight, 0); yy < std::min(y + kernelHeight, static_cast<int>(indexMapModified.height)); ++yy)
-            {
-                for (int xx = std::max(x - kernelWidth, 0); xx < std::min(x + kernelWidth, static_cast<int>(indexMapModified.width)); ++xx)
-                {
-                    if (indexMapModified.get(xx, yy) == modifierPointIndex)
-                    {
-                        if (intersectionSet.size() >= BucketCount)
-                        {
-//                            qDebug() << "__Bucket overflow on pixel" << x << y;
-                            overflow = true;
-                        }
-                        else
-                        {
-                            intersectionSum++;
-                        }
-                        // encode in morton order
-                        auto originalIndex = point2morton.value(indexMap.get(xx, yy));
-                        intersectionSet[originalIndex]++;
-                    }
-                }
-            }            
-//            qDebug() << "# pixels" << intersectionSum << "time " << perfTimer.restart();
-//            assert(intersectionSet.size() < BucketCount && "Mehr geht halt net erstmal...");
-
-            auto smap = intersectionSet.toStdMap();
-            while (smap.size() > BucketCount)
-            {
-                qDebug() << "__Bucket overflow on pixel" << x << y << "size" << smap.size();
-                auto it = min_element(smap.begin(), smap.end(),
-                                      [](decltype(smap)::value_type & l, decltype(smap)::value_type& r) -> bool { return l.second < r.second; });
-                smap.erase(it);
-            }
-            intersectionSet = QMap<uint32_t, float>(smap);
-
-            // Normalize weights and copy to neighbor maps.
-            size_t bucketIndex = 0;
-            for (auto key : intersectionSet.keys())
-            {
-                intersectionSet[key] = intersectionSet[key] / intersectionSum;
-                auto offset = (yOffset * indexMap.width + x) * BucketCount + bucketIndex;
-                neighborIndexMap[offset] = key;
-                neighborWeightMap[offset] = intersectionSet[key];
-                bucketIndex++;
-            }
-        }
-    }
+    naturalNeighbors(voronoi, points, indexMap, point2morton, batchNo*batchSize, batchSize,
+                     neighborIndexMap, neighborWeightMap);
 
     qDebug() << "Natural Neighbor: Done";
     qDebug() << "Batch no" << batchNo << " / " << batchCount;
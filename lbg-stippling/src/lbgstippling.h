@@ -19,6 +19,17 @@ struct Stipple {
     QColor color;
 };
 
+// Maximum number of natural neighbors stored per pixel.
+const size_t NeighborBucketCount = 16;
+
+// Natural neighbor ids (in morton order) and weights of the index map rows
+// [firstRow, firstRow + rows).
+void naturalNeighbors(VoronoiDiagram& voronoi, const QVector<QVector2D>& points,
+                      const IndexMap& indexMap, const QList<unsigned int>& point2morton,
+                      const int firstRow, const int rows,
+                      std::vector<uint32_t>& neighborIndexMap,
+                      std::vector<float>& neighborWeightMap);
+
 class LBGStippling {
 
   public:
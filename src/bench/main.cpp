@@ -0,0 +1,302 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Micro-benchmarks of the renderer hot paths on synthetic data: raycasting per feature flag,
+ * LBG interpolation, multi-resolution composition, brick generation, downsampling and reading
+ * dat/raw files.
+ * Runs on an OpenCL CPU device by default so results are comparable between machines,
+ * see MicroBenchmark for the statistics, JSON output and baseline comparison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include "src/bench/microbenchmark.h"
+#include "src/core/camera.h"
+#include "src/core/volumerendercl.h"
+#include "src/io/datrawreader.h"
+
+/**
+ * @brief Write a cubic UCHAR volume with a few concentric shells and noise.
+ * @return Name of the dat file.
+ */
+static QString writeSyntheticVolume(const QDir &dir, const size_t res)
+{
+    std::vector<unsigned char> data(res*res*res);
+    const double c = 0.5*(res - 1);
+    unsigned int noise = 12345u;
+    for (size_t z = 0; z < res; ++z)
+        for (size_t y = 0; y < res; ++y)
+            for (size_t x = 0; x < res; ++x)
+            {
+                const double r = std::sqrt((x - c)*(x - c) + (y - c)*(y - c) + (z - c)*(z - c)) / c;
+                noise = noise*1103515245u + 12345u;
+                const double shells = r < 1.0 ? 0.5 + 0.5*std::cos(r*6.0*3.14159265) : 0.0;
+                data[(z*res + y)*res + x] = static_cast<unsigned char>(
+                            std::min(255.0, shells*200.0 + ((noise >> 16) & 0x1f)));
+            }
+    std::ofstream raw(dir.filePath("synthetic.raw").toStdString(), std::ios::out | std::ios::binary);
+    raw.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    raw.close();
+
+    std::ofstream dat(dir.filePath("synthetic.dat").toStdString(), std::ios::out);
+    dat << "ObjectFileName: \tsynthetic.raw\n";
+    dat << "Resolution: \t\t" << res << " " << res << " " << res << "\n";
+    dat << "SliceThickness: \t1 1 1\n";
+    dat << "Format: \t\t\tUCHAR\n";
+    return dir.filePath("synthetic.dat");
+}
+
+/**
+ * @brief Write LBG maps for samples on a regular grid: index map, sampling map and natural
+ *        neighbor ids/weights with bilinear weights of the four surrounding samples.
+ * @return Index map, sampling map, neighbor ids and neighbor weights file names.
+ */
+static QStringList writeSyntheticLbgMaps(const QDir &dir, const int size, const int spacing)
+{
+    const int grid = size / spacing;
+    QImage indexMap(size, size, QImage::Format_ARGB32);
+    QImage samplingMap(grid*grid, 2, QImage::Format_ARGB32);
+    for (int i = 0; i < grid*grid; ++i)
+    {
+        const int x = (i % grid)*spacing + spacing/2;
+        const int y = (i / grid)*spacing + spacing/2;
+        samplingMap.setPixel(i, 0, qRgba((x >> 16) & 0xff, (x >> 8) & 0xff, x & 0xff, 255));
+        samplingMap.setPixel(i, 1, qRgba((y >> 16) & 0xff, (y >> 8) & 0xff, y & 0xff, 255));
+    }
+
+    const size_t pixels = static_cast<size_t>(size)*size;
+    std::vector<quint32> ids(pixels*16, 0);
+    std::vector<float> weights(pixels*16, 0.f);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            const int gx = std::min(x / spacing, grid - 1);
+            const int gy = std::min(y / spacing, grid - 1);
+            const int id = gy*grid + gx;
+            indexMap.setPixel(x, y, qRgba((id >> 16) & 0xff, (id >> 8) & 0xff, id & 0xff, 255));
+
+            const float fx = (x - gx*spacing) / static_cast<float>(spacing);
+            const float fy = (y - gy*spacing) / static_cast<float>(spacing);
+            const int gx1 = std::min(gx + 1, grid - 1);
+            const int gy1 = std::min(gy + 1, grid - 1);
+            const size_t o = (static_cast<size_t>(y)*size + x)*16;
+            ids[o + 0] = static_cast<quint32>(gy*grid + gx);
+            ids[o + 1] = static_cast<quint32>(gy*grid + gx1);
+            ids[o + 2] = static_cast<quint32>(gy1*grid + gx);
+            ids[o + 3] = static_cast<quint32>(gy1*grid + gx1);
+            weights[o + 0] = (1.f - fx)*(1.f - fy);
+            weights[o + 1] = fx*(1.f - fy);
+            weights[o + 2] = (1.f - fx)*fy;
+            weights[o + 3] = fx*fy;
+        }
+    }
+
+    const QStringList files = { dir.filePath("index.png"), dir.filePath("sampling.png"),
+                                dir.filePath("neighbor_ids"), dir.filePath("neighbor_weights") };
+    indexMap.save(files.at(0));
+    samplingMap.save(files.at(1));
+    QFile idFile(files.at(2));
+    if (idFile.open(QFile::WriteOnly))
+        idFile.write(reinterpret_cast<const char*>(ids.data()), static_cast<qint64>(ids.size()*sizeof(quint32)));
+    QFile weightFile(files.at(3));
+    if (weightFile.open(QFile::WriteOnly))
+        weightFile.write(reinterpret_cast<const char*>(weights.data()),
+                         static_cast<qint64>(weights.size()*sizeof(float)));
+    return files;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("VolumeRaycasterBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks of the OpenCL volume raycaster.");
+    parser.addHelpOption();
+    MicroBenchmark::addOptions(parser);
+    parser.addOptions({
+        {"volume-size", "Edge length of the synthetic volume.", "voxels", "256"},
+        {"image-size", "Edge length of the rendered image.", "pixels", "512"},
+        {"gpu", "Use an OpenCL GPU device instead of the CPU."},
+        {"platform", "OpenCL platform id.", "id", "-1"},
+        {"device", "OpenCL device name.", "name"},
+    });
+    parser.process(a);
+
+    MicroBenchmark bench;
+    bench.configure(parser);
+
+    QTemporaryDir tmp;
+    if (!tmp.isValid())
+    {
+        std::cerr << "Could not create a temporary directory." << std::endl;
+        return 1;
+    }
+    const QDir dir(tmp.path());
+    const size_t volumeSize = std::max(64u, parser.value("volume-size").toUInt());
+    const size_t imgSize = std::max(16u, parser.value("image-size").toUInt());
+    const QString datFile = writeSyntheticVolume(dir, volumeSize);
+    const QStringList lbgMaps = writeSyntheticLbgMaps(dir, static_cast<int>(imgSize), 8);
+
+    // CPU hot path
+    bench.run("DatRawReader::read_files", [&]() {
+        DatRawReader dr;
+        return MicroBenchmark::wallTime([&]() { dr.read_files(datFile.toStdString()); });
+    });
+
+    VolumeRenderCL renderer;
+    try
+    {
+        renderer.initialize(false, !parser.isSet("gpu"), VENDOR_ANY,
+                            parser.value("device").toStdString(), parser.value("platform").toInt());
+        renderer.loadVolumeData(datFile.toStdString());
+        std::vector<unsigned char> tff(256*4, 0);
+        for (size_t i = 0; i < 256; ++i)
+        {
+            tff[i*4 + 0] = static_cast<unsigned char>(i);
+            tff[i*4 + 1] = static_cast<unsigned char>(255 - i);
+            tff[i*4 + 2] = 128;
+            tff[i*4 + 3] = static_cast<unsigned char>(i > 40 ? i/2 : 0);
+        }
+        renderer.setTransferFunction(tff);
+        renderer.loadIndexAndSamplingMap(lbgMaps.at(0).toStdString(), lbgMaps.at(1).toStdString(),
+                                         lbgMaps.at(2), lbgMaps.at(3));
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    bench.setMetadata("device", QString::fromStdString(renderer.getCurrentDeviceName()));
+    bench.setMetadata("volumeSize", QString::number(volumeSize));
+    bench.setMetadata("imageSize", QString::number(imgSize));
+
+    Camera cam;
+    cam.rotate(0.1f, 0.05f);
+    renderer.updateView(cam.getViewMatrix());
+    renderer.updateOutputImg(imgSize, imgSize, 0);
+    std::vector<unsigned char> img;
+    const auto raycast = [&]() {
+        renderer.runRaycastNoGL(imgSize, imgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_RAYCAST) * 1000.0;
+    };
+
+    // raycasting kernel, one feature enabled at a time
+    struct Feature
+    {
+        const char *name;
+        std::function<void(bool)> set;
+    };
+    const std::vector<Feature> features = {
+        {"baseline", [](bool) {}},
+        {"linear", [&](bool on) { renderer.setLinearInterpolation(on); }},
+        {"illumination", [&](bool on) { renderer.setIllumination(on ? 1u : 0u); }},
+        {"objESS", [&](bool on) { renderer.setObjEss(on); }},
+        {"imgESS", [&](bool on) { renderer.setImgEss(on); }},
+        {"preIntegration", [&](bool on) { renderer.setPreIntegration(on); }},
+        {"ambientOcclusion", [&](bool on) { renderer.setAmbientOcclusion(on); }},
+        {"contours", [&](bool on) { renderer.setContours(on); }},
+        {"aerial", [&](bool on) { renderer.setAerial(on); }},
+        {"orthographic", [&](bool on) { renderer.setCamOrtho(on); }},
+    };
+    renderer.updateRenderingParameters(0);
+    for (const Feature &f : features)
+    {
+        try
+        {
+            f.set(true);
+            bench.run(QString("volumeRender/%1").arg(f.name), raycast);
+            f.set(false);
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << f.name << ": " << e.what() << std::endl;
+        }
+    }
+
+    // LBG sampling and natural neighbor interpolation, the frame may cover at most a third of the maps
+    const size_t lbgSize = imgSize / 3;
+    renderer.updateOutputImg(lbgSize, lbgSize, 0);
+    renderer.updateRenderingParameters(1);
+    cl_float2 gaze = {{0.5f, 0.5f}};
+    renderer.setGazePoint(gaze);
+    bench.run("volumeRender/lbg", [&]() {
+        renderer.runRaycastLBGNoGL(lbgSize, lbgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_RAYCAST) * 1000.0;
+    });
+    bench.run("interpolateLBG", [&]() {
+        renderer.runRaycastLBGNoGL(lbgSize, lbgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_INTERPOLATE) * 1000.0;
+    });
+    renderer.updateOutputImg(imgSize, imgSize, 0);
+
+    // multi-resolution layers and their composition at the full image size
+    renderer.updateRenderingParameters(2);
+    bench.run("volumeRender/multiRes", [&]() {
+        renderer.runRaycastMultiResNoGL(imgSize, imgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_RAYCAST) * 1000.0;
+    });
+    bench.run("composeMultiRes", [&]() {
+        renderer.runRaycastMultiResNoGL(imgSize, imgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_INTERPOLATE) * 1000.0;
+    });
+
+    // variable rate pre-pass, rate map and lattice raycast, and the edge-aware fill
+    renderer.updateRenderingParameters(3);
+    bench.run("volumeRender/variableRate", [&]() {
+        renderer.runRaycastVariableRateNoGL(imgSize, imgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_RAYCAST) * 1000.0;
+    });
+    bench.run("fillVariableRate", [&]() {
+        renderer.runRaycastVariableRateNoGL(imgSize, imgSize, 0, img);
+        return renderer.getLastFrameTiming().values.at(TIMING_INTERPOLATE) * 1000.0;
+    });
+    renderer.updateRenderingParameters(0);
+
+    // volume preprocessing
+    bench.run("generateBricks", [&]() {
+        return MicroBenchmark::wallTime([&]() { renderer.generateBricks(); });
+    });
+    bench.run("downsampling", [&]() {
+        return MicroBenchmark::wallTime([&]() { renderer.generateVolumeDownsampling(0, 2); });
+    });
+
+    const int regressions = bench.finish();
+    if (regressions < 0)
+        return 1;
+    if (regressions > 0)
+        std::cerr << regressions << " benchmark(s) regressed." << std::endl;
+    return regressions > 0 ? 2 : 0;
+}
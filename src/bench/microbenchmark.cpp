@@ -0,0 +1,266 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "microbenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+/**
+ * @brief Two sided 97.5% quantile of Student's t distribution.
+ */
+static double tQuantile(const size_t dof)
+{
+    static const double table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                    2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                    2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                    2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (dof == 0)
+        return 0.0;
+    if (dof <= 30)
+        return table[dof - 1];
+    return dof <= 60 ? 2.000 : 1.960;
+}
+
+/**
+ * @brief MicroBenchmark::MicroBenchmark
+ */
+MicroBenchmark::MicroBenchmark()
+    : _warmup(3)
+    , _repetitions(10)
+    , _maxRepetitions(100)
+    , _precision(0.02)
+    , _threshold(0.1)
+    , _output("benchmark.json")
+{
+}
+
+/**
+ * @brief MicroBenchmark::addOptions
+ * @param parser
+ */
+void MicroBenchmark::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        {"warmup", "Untimed runs before measuring.", "count", "3"},
+        {"repetitions", "Minimum number of timed runs.", "count", "10"},
+        {"max-repetitions", "Maximum number of timed runs.", "count", "100"},
+        {"precision", "Target relative half width of the 95% confidence interval.", "ratio", "0.02"},
+        {{"o", "output"}, "JSON result file.", "file", "benchmark.json"},
+        {{"b", "baseline"}, "JSON result file of a previous run to compare against.", "file"},
+        {"threshold", "Relative slow down counted as regression.", "ratio", "0.1"},
+        {{"f", "filter"}, "Only run benchmarks matching this regular expression.", "regexp"},
+    });
+}
+
+/**
+ * @brief MicroBenchmark::configure
+ * @param parser
+ */
+void MicroBenchmark::configure(const QCommandLineParser &parser)
+{
+    _warmup = std::max(0, parser.value("warmup").toInt());
+    _repetitions = std::max(2, parser.value("repetitions").toInt());
+    _maxRepetitions = std::max(_repetitions, parser.value("max-repetitions").toInt());
+    _precision = parser.value("precision").toDouble();
+    _threshold = parser.value("threshold").toDouble();
+    _output = parser.value("output");
+    _baseline = parser.value("baseline");
+    if (parser.isSet("filter"))
+        _filter = QRegularExpression(parser.value("filter"));
+}
+
+void MicroBenchmark::setMetadata(const QString &key, const QString &value)
+{
+    _metadata[key] = value;
+}
+
+const std::vector<MicroBenchmarkResult> &MicroBenchmark::getResults() const
+{
+    return _results;
+}
+
+/**
+ * @brief MicroBenchmark::wallTime
+ * @param fn
+ * @return
+ */
+double MicroBenchmark::wallTime(const std::function<void()> &fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief MicroBenchmark::calcStats
+ */
+MicroBenchmarkResult MicroBenchmark::calcStats(const QString &name, std::vector<double> samples)
+{
+    MicroBenchmarkResult r;
+    r.name = name;
+    r.samples = samples.size();
+    if (samples.empty())
+        return r;
+    std::sort(samples.begin(), samples.end());
+    const double n = static_cast<double>(samples.size());
+    r.min = samples.front();
+    r.median = samples.size() % 2 ? samples[samples.size()/2]
+                                  : 0.5*(samples[samples.size()/2 - 1] + samples[samples.size()/2]);
+    r.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    double var = 0.0;
+    for (double s : samples)
+        var += (s - r.mean)*(s - r.mean);
+    r.stddev = samples.size() > 1 ? std::sqrt(var / (n - 1.0)) : 0.0;
+    r.ci95 = tQuantile(samples.size() - 1) * r.stddev / std::sqrt(n);
+    return r;
+}
+
+/**
+ * @brief MicroBenchmark::run
+ * @param name
+ * @param fn
+ */
+void MicroBenchmark::run(const QString &name, const std::function<double()> &fn)
+{
+    if (!_filter.pattern().isEmpty() && !_filter.match(name).hasMatch())
+        return;
+
+    try
+    {
+        for (int i = 0; i < _warmup; ++i)
+            fn();
+        std::vector<double> samples;
+        MicroBenchmarkResult r;
+        do
+        {
+            samples.push_back(fn());
+            if (static_cast<int>(samples.size()) >= _repetitions)
+                r = calcStats(name, samples);
+        } while (static_cast<int>(samples.size()) < _repetitions
+                 || (static_cast<int>(samples.size()) < _maxRepetitions
+                     && r.ci95 > _precision * r.mean));
+
+        std::cout << std::left << std::setw(40) << name.toStdString() << std::right
+                  << std::fixed << std::setprecision(4)
+                  << std::setw(12) << r.mean << " ms +- " << std::setw(8) << r.ci95
+                  << " (median " << r.median << ", n=" << r.samples << ")" << std::endl;
+        _results.push_back(r);
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << name.toStdString() << " failed: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief MicroBenchmark::compareBaseline
+ * @return
+ */
+int MicroBenchmark::compareBaseline() const
+{
+    QFile f(_baseline);
+    if (!f.open(QFile::ReadOnly))
+    {
+        std::cerr << "Could not open baseline " << _baseline.toStdString() << std::endl;
+        return -1;
+    }
+    QJsonParseError err;
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &err);
+    if (err.error != QJsonParseError::NoError || !doc.object()["results"].isArray())
+    {
+        std::cerr << "Invalid baseline " << _baseline.toStdString() << std::endl;
+        return -1;
+    }
+    const QJsonArray baseline = doc.object()["results"].toArray();
+
+    int regressions = 0;
+    std::cout << "\nComparison with " << _baseline.toStdString() << " (threshold "
+              << _threshold*100.0 << "%):" << std::endl;
+    for (const QJsonValue &v : baseline)
+    {
+        const QJsonObject b = v.toObject();
+        const QString name = b["name"].toString();
+        if (!_filter.pattern().isEmpty() && !_filter.match(name).hasMatch())
+            continue;
+        const auto r = std::find_if(_results.begin(), _results.end(),
+                                    [&name](const MicroBenchmarkResult &res) {
+            return res.name == name;
+        });
+        std::cout << std::left << std::setw(40) << name.toStdString() << std::right;
+        if (r == _results.end())    // failed or no longer run, the gate must not pass silently
+        {
+            ++regressions;
+            std::cout << "  MISSING" << std::endl;
+            continue;
+        }
+        const double bMean = b["mean"].toDouble();
+        const double bCi = b["ci95"].toDouble();
+        const double change = bMean > 0.0 ? (r->mean - bMean) / bMean : 0.0;
+        const bool regressed = change > _threshold && r->mean - r->ci95 > bMean + bCi;
+        regressions += regressed ? 1 : 0;
+        std::cout << std::showpos << std::setw(9) << std::setprecision(1) << change*100.0
+                  << std::noshowpos << " %" << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
+
+/**
+ * @brief MicroBenchmark::finish
+ * @return
+ */
+int MicroBenchmark::finish()
+{
+    QJsonObject json = _metadata;
+    json["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    QJsonArray results;
+    for (const MicroBenchmarkResult &r : _results)
+    {
+        QJsonObject o;
+        o["name"] = r.name;
+        o["samples"] = static_cast<int>(r.samples);
+        o["mean"] = r.mean;
+        o["median"] = r.median;
+        o["min"] = r.min;
+        o["stddev"] = r.stddev;
+        o["ci95"] = r.ci95;
+        results.append(o);
+    }
+    json["results"] = results;
+
+    QFile f(_output);
+    if (f.open(QFile::WriteOnly))
+        f.write(QJsonDocument(json).toJson());
+    else
+        std::cerr << "Could not write " << _output.toStdString() << std::endl;
+
+    return _baseline.isEmpty() ? 0 : compareBaseline();
+}
@@ -0,0 +1,111 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+
+/**
+ * @brief Statistics of one micro-benchmark, all times in milliseconds.
+ */
+struct MicroBenchmarkResult
+{
+    QString name;
+    size_t samples = 0;
+    double mean = 0.0;
+    double median = 0.0;
+    double min = 0.0;
+    double stddev = 0.0;
+    double ci95 = 0.0;      // half width of the 95% confidence interval of the mean
+};
+
+/**
+ * @brief Small harness for timing micro-benchmarks.
+ *        Every benchmark is warmed up and then repeated until the 95% confidence interval of
+ *        the mean is narrower than the requested precision or the maximum number of
+ *        repetitions is reached. Results are written as JSON and optionally compared to a
+ *        baseline file written by an earlier run. A benchmark counts as regressed if its mean
+ *        exceeds the baseline mean by more than the threshold and the confidence intervals
+ *        do not overlap.
+ */
+class MicroBenchmark
+{
+public:
+    MicroBenchmark();
+
+    /**
+     * @brief Add the common command line options (--warmup, --repetitions, --output, ...).
+     */
+    static void addOptions(QCommandLineParser &parser);
+
+    /**
+     * @brief Apply the common command line options after parsing.
+     */
+    void configure(const QCommandLineParser &parser);
+
+    /**
+     * @brief Store additional information such as the device name in the JSON output.
+     */
+    void setMetadata(const QString &key, const QString &value);
+
+    /**
+     * @brief Time a benchmark, skipped if it does not match the --filter expression.
+     * @param name Unique benchmark name.
+     * @param fn Runs the workload once and returns its duration in milliseconds.
+     */
+    void run(const QString &name, const std::function<double()> &fn);
+
+    /**
+     * @brief Measure the host wall clock time of a function in milliseconds.
+     */
+    static double wallTime(const std::function<void()> &fn);
+
+    /**
+     * @brief Write the JSON output and compare against the baseline.
+     * @return Number of regressed benchmarks, including baseline entries without a current
+     *         result, or -1 if the baseline cannot be read.
+     */
+    int finish();
+
+    const std::vector<MicroBenchmarkResult> &getResults() const;
+
+private:
+    static MicroBenchmarkResult calcStats(const QString &name, std::vector<double> samples);
+    int compareBaseline() const;
+
+    std::vector<MicroBenchmarkResult> _results;
+    QJsonObject _metadata;
+
+    int _warmup;
+    int _repetitions;
+    int _maxRepetitions;
+    double _precision;      // target relative CI half width
+    double _threshold;      // allowed relative slow down
+    QString _output;
+    QString _baseline;
+    QRegularExpression _filter;
+};
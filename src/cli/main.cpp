@@ -0,0 +1,526 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Headless command line renderer. Renders a sequence of frames through the no-GL code path
+ * of VolumeRenderCL and writes the images and per frame timings to an output directory.
+ * The camera/gaze path uses the interaction log format written by the GUI.
+ * With --manifest, a batch of benchmark configurations is run instead (see BenchmarkRunner),
+ * with --generate-path, a synthetic camera/gaze path is written (see TrajectoryGenerator).
+ * With --gaze-source, the gaze of LBG frames is taken from a replayed or received gaze stream
+ * in real time instead of the path (see ReplayGazeSource and GazeProcessor).
+ */
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QTextStream>
+
+#include "src/core/volumerendercl.h"
+#include "src/core/camera.h"
+#include "src/core/benchmarkrunner.h"
+#include "src/core/eventlogger.h"
+#include "src/core/tracer.h"
+#include "src/core/trajectory.h"
+#include "src/gaze/gazelatency.h"
+#include "src/gaze/gazeprocessor.h"
+#include "src/gaze/gazesource.h"
+
+/**
+ * @brief Read a raw transfer function file (whitespace separated RGBA values in [0,255]).
+ */
+static bool loadRawTff(const QString &fileName, std::vector<unsigned char> &tff)
+{
+    std::ifstream tffFile(fileName.toStdString(), std::ios::in);
+    if (!tffFile.is_open())
+        return false;
+    float value = 0;
+    tff.clear();
+    while (tffFile >> value)
+        tff.push_back(static_cast<unsigned char>(value));
+    return !tff.empty();
+}
+
+/**
+ * @brief Read an interaction log, one frame per time stamp.
+ */
+static bool loadPath(const QString &fileName, QStringList &path)
+{
+    try
+    {
+        path = readInteractionFrames(fileName);
+    }
+    catch (std::invalid_argument)
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Apply one line of an interaction log to the render state.
+ */
+static void applyPathLine(QString line, Camera &cam, cl_float2 &gaze, size_t &timestep)
+{
+    int pos = line.lastIndexOf(';');
+    if (line.contains("gaze"))
+    {
+        QStringList values = line.remove(0, pos + 2).split(' ', QString::SkipEmptyParts);
+        if (values.size() >= 2)
+        {
+            gaze.s[0] = values.at(0).toFloat();
+            gaze.s[1] = values.at(1).toFloat();
+        }
+    }
+    else if (line.contains("camera"))
+    {
+        cam.fromString(line.remove(0, pos + 2));
+    }
+    else if (line.contains("timestep"))
+    {
+        timestep = static_cast<size_t>(line.remove(0, pos + 2).toInt());
+    }
+}
+
+/**
+ * @brief Apply all events of one frame of an interaction log to the render state.
+ */
+static void applyPathStep(const QString &step, Camera &cam, cl_float2 &gaze, size_t &timestep)
+{
+    for (const QString &line : step.split('\n'))
+        applyPathLine(line, cam, gaze, timestep);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("VolumeRaycasterCLI");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless OpenCL volume raycaster.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"v", "volume"}, "Volume data set description (.dat).", "file"},
+        {{"t", "tff"}, "Raw transfer function (.tff).", "file"},
+        {{"p", "path"}, "Camera/gaze path in interaction log format.", "file"},
+        {{"m", "mode"}, "Rendering mode: standard, lbg, multires or vrs.", "mode", "standard"},
+        {{"n", "frames"}, "Number of frames to render (default: length of path or 1).", "count"},
+        {"width", "Output image width.", "pixels", "1024"},
+        {"height", "Output image height.", "pixels", "1024"},
+        {{"o", "out"}, "Output directory for images and timings.", "dir", "."},
+        {"no-images", "Do not write images, only timings."},
+        {"sampling-rate", "Ray sampling rate relative to the voxel size.", "rate", "1.5"},
+        {"precision", "Image precision: 8, 16 or 32 bit.", "bits", "8"},
+        {"index-map", "LBG index map (.png).", "file"},
+        {"sampling-map", "LBG sampling map (.png).", "file"},
+        {"neighbor-ids", "LBG neighbor ids.", "file"},
+        {"neighbor-weights", "LBG neighbor weights.", "file"},
+        {"platform", "OpenCL platform id.", "id", "-1"},
+        {"device", "OpenCL device name.", "name"},
+        {"cpu", "Use an OpenCL CPU device."},
+        {"manifest", "Run all benchmarks listed in a JSON manifest and exit.", "file"},
+        {"trace", "Record a Chrome trace to <file>.", "file"},
+        {"generate-path", "Write a generated camera/gaze path of --frames frames to <file> and exit.", "file"},
+        {"seed", "Seed of the generated path.", "seed", "42"},
+        {"fps", "Frame rate of the generated path.", "rate", "60"},
+        {"convert-log", "Convert a binary event log (<file>.bin) to the text format and exit.", "file"},
+        {"gaze-source", "Replay the gaze of an interaction log in real time or receive it on "
+                        "udp:<port> (foveated modes).", "source"},
+        {"gaze-filter", "Filter the gaze and detect fixations."},
+        {"fixation-detection", "Fixation detection method, ivt or idt.", "method", "ivt"},
+        {"gaze-prediction", "Predict the gaze at the expected display time of a frame."},
+        {"display-latency", "Time from the end of a frame until it is shown.", "ms", "16"},
+        {"pixels-per-degree", "Display resolution in pixels per degree.", "ppd", "40"},
+        {"reprojection", "Reproject the LBG temporal history on camera motion."},
+        {"history", "LBG temporal history, ema (moving average) or frames.", "mode", "ema"},
+        {"history-depth", "Frames in the LBG temporal history.", "frames", "8"},
+        {"history-format", "Format of the LBG temporal history, output, half or float.",
+         "format", "output"},
+        {"multires-layers", "Layers of the multi-resolution mode, 2 or 3.", "layers", "3"},
+        {"multires-fovea", "Radius of the full resolution multi-resolution layer, fraction of "
+                           "the larger image side.", "radius", "0.15"},
+        {"multires-scale", "Resolution factor between multi-resolution layers.", "factor", "2"},
+        {"vrs-fovea", "Full rate radius of the variable rate mode, fraction of the larger image "
+                      "side.", "radius", "0.1"},
+        {"vrs-threshold", "Luminance deviation of a tile that is traced at full rate.",
+         "deviation", "0.02"},
+    });
+    parser.process(a);
+
+    Tracer::setThreadName("main");
+    if (parser.isSet("trace"))
+        Tracer::start(parser.value("trace").toStdString());
+    // write the trace on every exit path
+    struct TraceGuard { ~TraceGuard() { if (Tracer::isEnabled()) Tracer::stop(); } } traceGuard;
+
+    if (parser.isSet("manifest"))
+    {
+        try
+        {
+            BenchmarkRunner runner;
+            runner.loadManifest(parser.value("manifest"));
+            const size_t n = runner.run();
+            std::cout << "Wrote " << n << " benchmark result files." << std::endl;
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (parser.isSet("convert-log"))
+    {
+        QString textFile = parser.value("convert-log");
+        if (textFile.endsWith(".bin"))
+            textFile.chop(4);
+        if (!EventLogger::convertToText(textFile + ".bin", textFile))
+        {
+            std::cerr << "Could not convert event log " << textFile.toStdString() << ".bin" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (parser.isSet("generate-path"))
+    {
+        TrajectoryGenerator::Parameters params;
+        params.frameRate = parser.value("fps").toDouble();
+        const int n = parser.isSet("frames") ? parser.value("frames").toInt() : 600;
+        try
+        {
+            TrajectoryGenerator gen(parser.value("seed").toULongLong(), params);
+            TrajectoryGenerator::writeInteractionLog(gen.generate(static_cast<size_t>(std::max(n, 1))),
+                                                     parser.value("generate-path"));
+        }
+        catch (std::invalid_argument e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!parser.isSet("volume"))
+    {
+        std::cerr << "No volume data set given." << std::endl;
+        parser.showHelp(1);
+    }
+    const bool lbg = parser.value("mode").toLower() == "lbg";
+    const bool multiRes = parser.value("mode").toLower() == "multires";
+    const bool variableRate = parser.value("mode").toLower() == "vrs";
+    if (lbg && !(parser.isSet("index-map") && parser.isSet("sampling-map")
+                 && parser.isSet("neighbor-ids") && parser.isSet("neighbor-weights")))
+    {
+        std::cerr << "LBG mode requires index map, sampling map, neighbor ids and weights."
+                  << std::endl;
+        return 1;
+    }
+
+    const size_t width = parser.value("width").toUInt();
+    const size_t height = parser.value("height").toUInt();
+    const bool writeImages = !parser.isSet("no-images");
+    QDir outDir(parser.value("out"));
+    if (!outDir.exists() && !outDir.mkpath("."))
+    {
+        std::cerr << "Could not create output directory " << outDir.path().toStdString()
+                  << std::endl;
+        return 1;
+    }
+
+    QStringList path;
+    if (parser.isSet("path") && !loadPath(parser.value("path"), path))
+    {
+        std::cerr << "Could not open path file " << parser.value("path").toStdString() << std::endl;
+        return 1;
+    }
+    int frames = path.empty() ? 1 : path.size();
+
+    // live gaze stream, frames are rendered until the replay ends if --frames is not given
+    GazeBuffer gazeBuffer;
+    GazeProcessor gazeProcessor;
+    std::unique_ptr<ReplayGazeSource> gazeSource;
+    if (parser.isSet("gaze-source"))
+    {
+        const double ppd = parser.value("pixels-per-degree").toDouble();
+        GazeFilter::Parameters filterParams = gazeProcessor.filter().getParameters();
+        filterParams.enabled = parser.isSet("gaze-filter");
+        filterParams.method = parser.value("fixation-detection") == "idt" ? GazeFilter::IDT
+                                                                          : GazeFilter::IVT;
+        filterParams.pixelsPerDegree = ppd;
+        gazeProcessor.filter().setParameters(filterParams);
+        GazePredictor::Parameters predictorParams = gazeProcessor.predictor().getParameters();
+        predictorParams.enabled = parser.isSet("gaze-prediction");
+        predictorParams.pixelsPerDegree = ppd;
+        gazeProcessor.predictor().setParameters(predictorParams);
+        gazeProcessor.setDisplaySize(width, height);
+        gazeProcessor.setDisplayLatency(parser.value("display-latency").toDouble());
+        gazeSource.reset(new ReplayGazeSource(gazeBuffer, parser.value("gaze-source")));
+        frames = INT_MAX;
+    }
+    if (parser.isSet("frames"))
+        frames = parser.value("frames").toInt();
+
+    VolumeRenderCL renderer;
+    try
+    {
+        renderer.initialize(false, parser.isSet("cpu"), VENDOR_ANY,
+                            parser.value("device").toStdString(),
+                            parser.value("platform").toInt());
+        renderer.loadVolumeData(parser.value("volume").toStdString());
+
+        std::vector<unsigned char> tff;
+        if (parser.isSet("tff"))
+        {
+            if (!loadRawTff(parser.value("tff"), tff))
+            {
+                std::cerr << "Could not read transfer function " << parser.value("tff").toStdString()
+                          << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            // simple linear ramp as in VolumeRenderCL::loadVolumeData
+            tff.resize(256*4, 0);
+            std::iota(tff.begin() + 3, tff.end(), 0);
+        }
+        renderer.setTransferFunction(tff);
+        renderer.updateSamplingRate(parser.value("sampling-rate").toDouble());
+
+        const int bits = parser.value("precision").toInt();
+        renderer.setImagePrecision(bits == 32 ? VolumeRenderCL::PRECISION_FLOAT
+                                              : (bits == 16 ? VolumeRenderCL::PRECISION_HALF
+                                                            : VolumeRenderCL::PRECISION_UNORM8));
+        renderer.updateOutputImg(width, height, 0);
+
+        if (lbg)
+        {
+            renderer.loadIndexAndSamplingMap(parser.value("index-map").toStdString(),
+                                             parser.value("sampling-map").toStdString(),
+                                             parser.value("neighbor-ids"),
+                                             parser.value("neighbor-weights"));
+        }
+        renderer.updateRenderingParameters(lbg ? 1u : (multiRes ? 2u : (variableRate ? 3u : 0u)));
+        renderer.setReprojection(parser.isSet("reprojection"));
+        TemporalHistory::Parameters history;
+        history.mode = parser.value("history") == "frames" ? TemporalHistory::FRAMES
+                                                           : TemporalHistory::ACCUMULATE;
+        history.depth = parser.value("history-depth").toUInt();
+        const QString historyFormat = parser.value("history-format");
+        history.format = historyFormat == "float" ? TemporalHistory::FORMAT_FLOAT
+                                                  : (historyFormat == "half" ? TemporalHistory::FORMAT_HALF
+                                                                             : TemporalHistory::FORMAT_OUTPUT);
+        renderer.setTemporalHistory(history);
+        VolumeRenderCL::MultiResParameters multiResParams;
+        multiResParams.layers = parser.value("multires-layers").toUInt();
+        multiResParams.foveaRadius = parser.value("multires-fovea").toFloat();
+        multiResParams.scale = parser.value("multires-scale").toUInt();
+        renderer.setMultiResParameters(multiResParams);
+        VolumeRenderCL::VariableRateParameters variableRateParams;
+        variableRateParams.foveaRadius = parser.value("vrs-fovea").toFloat();
+        variableRateParams.threshold = parser.value("vrs-threshold").toFloat();
+        renderer.setVariableRateParameters(variableRateParams);
+    }
+    catch (std::invalid_argument e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch (std::runtime_error e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    QFile timingFile(outDir.filePath("timings.csv"));
+    if (!timingFile.open(QFile::WriteOnly | QFile::Text))
+    {
+        std::cerr << "Could not open timings file." << std::endl;
+        return 1;
+    }
+    QTextStream timings(&timingFile);
+    timings << "frame; exec; wall";
+    for (int i = 0; i < TIMING_COUNT; ++i)
+        timings << "; " << timingName(static_cast<timing_id>(i));
+#ifdef KERNEL_COUNTERS
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+        timings << "; " << counterName(static_cast<counter_id>(i));
+#endif
+    timings << "\n";
+
+    QFile gazeFile(outDir.filePath("gaze.csv"));
+    QTextStream gazeLog(&gazeFile);
+    // gaze-to-photon latency per frame in seconds, a headless frame is presented once read back
+    QFile latencyFile(outDir.filePath("latency.csv"));
+    QTextStream latencyLog(&latencyFile);
+    LatencyRecorder latency(4096);
+    if (gazeSource)
+    {
+        if (!gazeFile.open(QFile::WriteOnly | QFile::Text)
+                || !latencyFile.open(QFile::WriteOnly | QFile::Text))
+        {
+            std::cerr << "Could not open gaze file." << std::endl;
+            return 1;
+        }
+        gazeLog << "frame; x; y; fixation; predicted x; predicted y; raw x; raw y; "
+                   "actual x; actual y; horizon\n";
+        latencyLog << "frame; total";
+        for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+            latencyLog << "; " << latencyStageName(static_cast<latency_stage>(i));
+        latencyLog << "\n";
+        if (!gazeSource->start())
+            return 1;
+    }
+
+    Camera cam;
+    cl_float2 gaze = {{0.5f, 0.5f}};
+    size_t timestep = 0;
+    std::vector<float> imgData;
+    QElapsedTimer wallTimer;
+    renderer.updateView(cam.getViewMatrix());
+    int frame = 0;
+    for (; frame < frames; ++frame)
+    {
+        if (!path.empty() && frame < path.size())
+        {
+            applyPathStep(path.at(frame), cam, gaze, timestep);
+            renderer.updateView(cam.getViewMatrix());
+        }
+        timestep = std::min(timestep, renderer.getResolution().at(3) - 1);
+        if (gazeSource)
+        {
+            if (!gazeSource->isRunning())
+                break;
+            GazeSample sample;
+            const double frameTime = renderer.getLastFrameTiming().values.at(TIMING_HOST);
+            if (gazeProcessor.process(gazeBuffer, frameTime, sample,
+                                      [&](const GazePredictor::Evaluation &e) {
+                gazeLog << frame << "; ; ; ; " << e.predicted[0] << "; " << e.predicted[1]
+                        << "; " << e.raw[0] << "; " << e.raw[1] << "; " << e.actual[0] << "; "
+                        << e.actual[1] << "; " << (e.target - e.time) * 1e-3 << "\n";
+            }))
+            {
+                gaze.s[0] = sample.x;
+                gaze.s[1] = sample.y;
+                latency.begin(gazeProcessor.lastInput());
+            }
+            else
+                latency.cancel();
+            gazeLog << frame << "; " << gaze.s[0] << "; " << gaze.s[1] << "; "
+                    << (gazeProcessor.filter().isFixation() ? 1 : 0) << "\n";
+        }
+
+        wallTimer.restart();
+        try
+        {
+            if (lbg)
+            {
+                renderer.setGazePoint(gaze);
+                renderer.runRaycastLBGNoGL(width, height, timestep, imgData);
+            }
+            else if (multiRes)
+            {
+                renderer.setGazePoint(gaze);
+                renderer.runRaycastMultiResNoGL(width, height, timestep, imgData);
+            }
+            else if (variableRate)
+            {
+                renderer.setGazePoint(gaze);
+                renderer.runRaycastVariableRateNoGL(width, height, timestep, imgData);
+            }
+            else
+            {
+                renderer.runRaycastNoGL(width, height, timestep, imgData);
+            }
+        }
+        catch (std::runtime_error e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        latency.stamp(STAGE_RENDER);
+        if (latency.present())
+        {
+            const FrameLatency last = latency.last();
+            latencyLog << frame << "; " << last.total();
+            for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+                latencyLog << "; " << last.duration(static_cast<latency_stage>(i));
+            latencyLog << "\n";
+        }
+        const double wall = wallTimer.nsecsElapsed()*1e-9;
+        timings << frame << "; " << renderer.getLastExecTime() << "; " << wall;
+        const FrameTiming timing = renderer.getLastFrameTiming();
+        for (double v : timing.values)
+            timings << "; " << v;
+#ifdef KERNEL_COUNTERS
+        for (uint64_t c : timing.counters)
+            timings << "; " << c;
+#endif
+        timings << "\n";
+
+        if (writeImages && imgData.size() >= width*height*4)
+        {
+            TRACE_SCOPE("saveFrame", "cli");
+            // alpha is ignored, the GUI displays the frame on an opaque quad as well
+            QImage img(static_cast<int>(width), static_cast<int>(height), QImage::Format_RGBX8888);
+            for (size_t y = 0; y < height; ++y)
+            {
+                uchar *line = img.scanLine(static_cast<int>(y));
+                for (size_t x = 0; x < width*4; ++x)
+                {
+                    const float v = std::min(std::max(imgData.at(y*width*4 + x), 0.f), 1.f);
+                    line[x] = static_cast<uchar>(v*255.f + 0.5f);
+                }
+            }
+            img.save(outDir.filePath(QString("frame_%1.png").arg(frame, 6, 10, QChar('0'))));
+        }
+    }
+    if (gazeSource)
+        gazeSource->stop();
+    std::cout << "Rendered " << frame << " frames to " << outDir.path().toStdString() << std::endl;
+    std::cout << renderer.getTimingHistory().toString() << std::endl;
+    if (latency.size() > 0)
+        std::cout << "Gaze-to-photon latency [s]: " << latency.toString() << std::endl;
+    if (lbg)
+        std::cout << "Temporal history: " << renderer.getTemporalHistory().getMemoryUsage()
+                  << " bytes" << std::endl;
+    if (multiRes)
+        std::cout << "Multi-resolution rays per frame: " << renderer.getMultiResRayCount()
+                  << " of " << width*height << std::endl;
+    if (variableRate)
+        std::cout << "Variable rate rays in the last frame: " << renderer.getVariableRateRayCount()
+                  << " of " << width*height << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,688 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/benchmarkrunner.h"
+#include "src/core/camera.h"
+#include "src/gaze/gazesource.h"
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+
+static const char * const MODE_NAMES[] = { "Standard", "LBG-Sampling", "Multi-Resolution",
+                                           "Variable-Rate" };
+
+static int precisionBits(const VolumeRenderCL::image_precision p)
+{
+    return p == VolumeRenderCL::PRECISION_FLOAT ? 32 : (p == VolumeRenderCL::PRECISION_HALF ? 16 : 8);
+}
+
+static float canonical(QRandomGenerator64 &prng)
+{
+    return static_cast<float>(std::generate_canonical<float, std::numeric_limits<float>::digits>(prng));
+}
+
+/**
+ * @brief BenchmarkRunner::BenchmarkRunner
+ */
+BenchmarkRunner::BenchmarkRunner()
+    : _modes({0u, 1u, 2u, 3u})
+    , _resolutions({{{1024, 1024}}})
+    , _samplingRates({1.5})
+    , _precisions({VolumeRenderCL::PRECISION_UNORM8})
+    , _seeds({42})
+    , _outputDir(".")
+    , _warmup(10)
+    , _repetitions(1)
+    , _cameraIterations(10)
+    , _gazeIterations(100)
+    , _generatedTrajectory(false)
+    , _useCPU(false)
+    , _platformId(-1)
+    , _quality(false)
+    , _pixelsPerDegree(40.0)
+    , _e2(2.3)
+{
+}
+
+/**
+ * @brief BenchmarkRunner::loadManifest
+ * @param fileName
+ */
+void BenchmarkRunner::loadManifest(const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly))
+        throw std::invalid_argument("Could not open benchmark manifest " + fileName.toStdString());
+
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &err);
+    if (doc.isNull() || !doc.isObject())
+        throw std::invalid_argument("Invalid benchmark manifest " + fileName.toStdString() + ": "
+                                    + err.errorString().toStdString());
+    read(doc.object(), QFileInfo(fileName).absoluteDir());
+}
+
+/**
+ * @brief BenchmarkRunner::read
+ * @param json
+ * @param baseDir
+ */
+void BenchmarkRunner::read(const QJsonObject &json, const QDir &baseDir)
+{
+    auto path = [&baseDir](const QJsonValue &v) {
+        const QString s = v.toString();
+        return s.isEmpty() ? s : QDir::cleanPath(baseDir.absoluteFilePath(s));
+    };
+
+    if (json.contains("output"))
+        _outputDir = path(json["output"]);
+    if (json.contains("warmup"))
+        _warmup = static_cast<quint64>(json["warmup"].toInt());
+    if (json.contains("repetitions"))
+        _repetitions = static_cast<quint64>(qMax(1, json["repetitions"].toInt()));
+    if (json.contains("cameraIterations"))
+        _cameraIterations = static_cast<quint64>(json["cameraIterations"].toInt());
+    if (json.contains("gazeIterations"))
+        _gazeIterations = static_cast<quint64>(qMax(1, json["gazeIterations"].toInt()));
+
+    if (json.contains("trajectory"))
+        _generatedTrajectory = json["trajectory"].toString() == "generated";
+    if (json.contains("device"))
+    {
+        QJsonObject dev = json["device"].toObject();
+        setDevice(dev["cpu"].toBool(false), dev["name"].toString(), dev["platform"].toInt(-1));
+    }
+    if (json.contains("quality"))
+    {
+        QJsonObject q = json["quality"].toObject();
+        setQualityEnabled(q["enabled"].toBool(true), q["pixelsPerDegree"].toDouble(40.0),
+                          q["e2"].toDouble(2.3));
+    }
+    if (json.contains("modes"))
+    {
+        _modes.clear();
+        for (const QJsonValue &v : json["modes"].toArray())
+        {
+            if (v.toString() == MODE_NAMES[0])
+                _modes.push_back(0u);
+            else if (v.toString() == MODE_NAMES[1])
+                _modes.push_back(1u);
+            else if (v.toString() == MODE_NAMES[2])
+                _modes.push_back(2u);
+            else if (v.toString() == MODE_NAMES[3])
+                _modes.push_back(3u);
+            else
+                std::cerr << "Unknown rendering mode " << v.toString().toStdString() << std::endl;
+        }
+    }
+    if (json.contains("resolutions"))
+    {
+        _resolutions.clear();
+        for (const QJsonValue &v : json["resolutions"].toArray())
+        {
+            QJsonArray res = v.toArray();
+            if (res.size() == 2)
+                _resolutions.push_back({{static_cast<size_t>(res.at(0).toInt()),
+                                         static_cast<size_t>(res.at(1).toInt())}});
+        }
+    }
+    if (json.contains("samplingRates"))
+    {
+        _samplingRates.clear();
+        for (const QJsonValue &v : json["samplingRates"].toArray())
+            _samplingRates.push_back(v.toDouble());
+    }
+    if (json.contains("precisions"))
+    {
+        _precisions.clear();
+        for (const QJsonValue &v : json["precisions"].toArray())
+        {
+            const int bits = v.toInt();
+            _precisions.push_back(bits == 32 ? VolumeRenderCL::PRECISION_FLOAT
+                                             : (bits == 16 ? VolumeRenderCL::PRECISION_HALF
+                                                           : VolumeRenderCL::PRECISION_UNORM8));
+        }
+    }
+    if (json.contains("seeds"))
+    {
+        _seeds.clear();
+        for (const QJsonValue &v : json["seeds"].toArray())
+            _seeds.push_back(static_cast<quint64>(v.toInt()));
+    }
+    if (json.contains("lbgMaps"))
+    {
+        QJsonObject maps = json["lbgMaps"].toObject();
+        setLbgMaps({path(maps["indexMap"]), path(maps["samplingMap"]),
+                    path(maps["neighborIds"]), path(maps["neighborWeights"])});
+    }
+    if (json.contains("multiRes"))
+    {
+        QJsonObject mr = json["multiRes"].toObject();
+        VolumeRenderCL::MultiResParameters params;
+        params.layers = static_cast<cl_uint>(mr["layers"].toInt(static_cast<int>(params.layers)));
+        params.scale = static_cast<cl_uint>(mr["scale"].toInt(static_cast<int>(params.scale)));
+        params.foveaRadius = static_cast<float>(mr["foveaRadius"].toDouble(params.foveaRadius));
+        params.blend = static_cast<float>(mr["blend"].toDouble(params.blend));
+        setMultiResParameters(params);
+    }
+    if (json.contains("variableRate"))
+    {
+        QJsonObject vr = json["variableRate"].toObject();
+        VolumeRenderCL::VariableRateParameters params;
+        params.foveaRadius = static_cast<float>(vr["foveaRadius"].toDouble(params.foveaRadius));
+        params.threshold = static_cast<float>(vr["threshold"].toDouble(params.threshold));
+        setVariableRateParameters(params);
+    }
+    if (json.contains("gazeSource"))
+        setGazeSource(path(json["gazeSource"]));
+    if (json.contains("datasets"))
+    {
+        _dataSets.clear();
+        for (const QJsonValue &v : json["datasets"].toArray())
+        {
+            QJsonObject ds = v.toObject();
+            addDataSet(ds["name"].toString(), path(ds["volume"]), path(ds["tff"]));
+        }
+    }
+}
+
+/**
+ * @brief BenchmarkRunner::write
+ * @param json
+ */
+void BenchmarkRunner::write(QJsonObject &json) const
+{
+    json["output"] = _outputDir;
+    json["warmup"] = static_cast<int>(_warmup);
+    json["repetitions"] = static_cast<int>(_repetitions);
+    json["cameraIterations"] = static_cast<int>(_cameraIterations);
+    json["gazeIterations"] = static_cast<int>(_gazeIterations);
+
+    json["trajectory"] = _generatedTrajectory ? "generated" : "random";
+
+    QJsonObject dev;
+    dev["cpu"] = _useCPU;
+    dev["name"] = _deviceName;
+    dev["platform"] = _platformId;
+    json["device"] = dev;
+
+    if (_quality)
+    {
+        QJsonObject q;
+        q["enabled"] = _quality;
+        q["pixelsPerDegree"] = _pixelsPerDegree;
+        q["e2"] = _e2;
+        json["quality"] = q;
+    }
+
+    QJsonArray modes;
+    for (unsigned int m : _modes)
+        modes.append(MODE_NAMES[m]);
+    json["modes"] = modes;
+    QJsonArray resolutions;
+    for (const auto &r : _resolutions)
+        resolutions.append(QJsonArray({static_cast<int>(r.at(0)), static_cast<int>(r.at(1))}));
+    json["resolutions"] = resolutions;
+    QJsonArray rates;
+    for (double r : _samplingRates)
+        rates.append(r);
+    json["samplingRates"] = rates;
+    QJsonArray precisions;
+    for (auto p : _precisions)
+        precisions.append(precisionBits(p));
+    json["precisions"] = precisions;
+    QJsonArray seeds;
+    for (quint64 s : _seeds)
+        seeds.append(static_cast<qint64>(s));
+    json["seeds"] = seeds;
+
+    if (_lbgMaps.size() == 4)
+    {
+        QJsonObject maps;
+        maps["indexMap"] = _lbgMaps.at(0);
+        maps["samplingMap"] = _lbgMaps.at(1);
+        maps["neighborIds"] = _lbgMaps.at(2);
+        maps["neighborWeights"] = _lbgMaps.at(3);
+        json["lbgMaps"] = maps;
+    }
+    QJsonObject mr;
+    mr["layers"] = static_cast<int>(_multiRes.layers);
+    mr["scale"] = static_cast<int>(_multiRes.scale);
+    mr["foveaRadius"] = _multiRes.foveaRadius;
+    mr["blend"] = _multiRes.blend;
+    json["multiRes"] = mr;
+    QJsonObject vr;
+    vr["foveaRadius"] = _variableRate.foveaRadius;
+    vr["threshold"] = _variableRate.threshold;
+    json["variableRate"] = vr;
+    if (!_gazeSource.isEmpty())
+        json["gazeSource"] = _gazeSource;
+    QJsonArray dataSets;
+    for (const DataSet &d : _dataSets)
+    {
+        QJsonObject ds;
+        ds["name"] = d.name;
+        ds["volume"] = d.volume;
+        ds["tff"] = d.tff;
+        dataSets.append(ds);
+    }
+    json["datasets"] = dataSets;
+}
+
+void BenchmarkRunner::addDataSet(const QString &name, const QString &volume, const QString &tff)
+{
+    _dataSets.push_back({name.isEmpty() ? QFileInfo(volume).baseName() : name, volume, tff});
+}
+
+void BenchmarkRunner::setLbgMaps(const QStringList &files)
+{
+    _lbgMaps = files;
+}
+
+void BenchmarkRunner::setMultiResParameters(const VolumeRenderCL::MultiResParameters &parameters)
+{
+    _multiRes = parameters;
+}
+
+void BenchmarkRunner::setVariableRateParameters(
+        const VolumeRenderCL::VariableRateParameters &parameters)
+{
+    _variableRate = parameters;
+}
+
+void BenchmarkRunner::setGazeSource(const QString &fileName)
+{
+    _gazeSource = fileName;
+}
+
+void BenchmarkRunner::setOutputDirectory(const QString &dir)
+{
+    _outputDir = dir;
+}
+
+void BenchmarkRunner::setDevice(const bool useCPU, const QString &deviceName, const int platformId)
+{
+    _useCPU = useCPU;
+    _deviceName = deviceName;
+    _platformId = platformId;
+}
+
+void BenchmarkRunner::setQualityEnabled(const bool enable, const double pixelsPerDegree,
+                                        const double e2)
+{
+    _quality = enable;
+    _pixelsPerDegree = pixelsPerDegree;
+    _e2 = e2;
+}
+
+/**
+ * @brief BenchmarkRunner::run
+ * @return
+ */
+size_t BenchmarkRunner::run()
+{
+    QDir outDir(_outputDir);
+    if (!outDir.mkpath("."))
+        throw std::runtime_error("Could not create benchmark directory " + _outputDir.toStdString());
+
+    VolumeRenderCL renderer;
+    renderer.initialize(false, _useCPU, VENDOR_ANY, _deviceName.toStdString(), _platformId);
+    renderer.setMultiResParameters(_multiRes);
+    renderer.setVariableRateParameters(_variableRate);
+
+    // keep the effective configuration next to the results
+    QJsonObject manifest;
+    write(manifest);
+    manifest["deviceName"] = QString::fromStdString(renderer.getCurrentDeviceName());
+    QFile manifestFile(outDir.filePath("manifest.json"));
+    if (manifestFile.open(QFile::WriteOnly))
+        manifestFile.write(QJsonDocument(manifest).toJson());
+
+    const bool hasLbgMaps = _lbgMaps.size() == 4;
+    bool lbgMapsLoaded = false;
+    size_t written = 0;
+    for (const DataSet &d : _dataSets)
+    {
+        std::cout << "Benchmarking " << d.name.toStdString() << std::endl;
+        try
+        {
+            renderer.loadVolumeData(d.volume.toStdString());
+        }
+        catch (std::runtime_error e)
+        {
+            std::cerr << e.what() << std::endl;
+            continue;
+        }
+
+        // load raw values of tff, fall back to a linear ramp
+        std::vector<unsigned char> tff;
+        std::ifstream tffFile(d.tff.toStdString(), std::ios::in);
+        float value = 0;
+        while (tffFile.is_open() && tffFile >> value)
+            tff.push_back(static_cast<unsigned char>(value));
+        if (tff.empty())
+        {
+            if (!d.tff.isEmpty())
+                std::cerr << "Could not open transfer function file " << d.tff.toStdString()
+                          << ", using a linear ramp." << std::endl;
+            tff.resize(256*4, 0);
+            std::iota(tff.begin() + 3, tff.end(), 0);
+        }
+        renderer.setTransferFunction(tff);
+
+        for (unsigned int mode : _modes)
+        {
+            if (mode == 1u && !lbgMapsLoaded)
+            {
+                if (!hasLbgMaps)
+                {
+                    std::cerr << "Skipping " << MODE_NAMES[mode]
+                              << ": no index and sampling maps given." << std::endl;
+                    continue;
+                }
+                renderer.loadIndexAndSamplingMap(_lbgMaps.at(0).toStdString(),
+                                                 _lbgMaps.at(1).toStdString(),
+                                                 _lbgMaps.at(2), _lbgMaps.at(3));
+                lbgMapsLoaded = true;
+            }
+            renderer.updateRenderingParameters(mode);
+
+            for (const auto &res : _resolutions)
+            for (double rate : _samplingRates)
+            for (auto precision : _precisions)
+            for (quint64 seed : _seeds)
+            {
+                // one sub directory per parameter set, same file names as the GUI benchmark
+                const QString configName = QString("%1x%2_sr%3_%4bit_seed%5")
+                        .arg(res.at(0)).arg(res.at(1)).arg(rate)
+                        .arg(precisionBits(precision)).arg(seed);
+                if (!outDir.mkpath(configName))
+                    throw std::runtime_error("Could not create directory " + configName.toStdString());
+                QFile f(outDir.filePath(configName + "/" + d.name + "_" + MODE_NAMES[mode]));
+                if (!f.open(QFile::WriteOnly | QFile::Text))
+                {
+                    std::cerr << "Could not open " << f.fileName().toStdString() << std::endl;
+                    continue;
+                }
+
+                renderer.updateSamplingRate(rate);
+                renderer.setImagePrecision(precision);
+                renderer.updateOutputImg(res.at(0), res.at(1), 0);
+
+                // quality goes to a separate file to keep the notebook format unchanged
+                QFile qf(f.fileName() + ".quality");
+                QTextStream qout(&qf);
+                const bool quality = _quality && mode != 0u
+                        && qf.open(QFile::WriteOnly | QFile::Text);
+                if (quality)
+                    qout << "iteration; gaze x y; execution time; psnr; ssim; weighted psnr; weighted ssim\n";
+
+                // per frame gaze-to-photon latency if the gaze is replayed
+                QFile lf(f.fileName() + ".latency");
+                QTextStream lout(&lf);
+                const bool latency = !_gazeSource.isEmpty() && mode != 0u
+                        && lf.open(QFile::WriteOnly | QFile::Text);
+                if (latency)
+                {
+                    lout << "iteration; total";
+                    for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+                        lout << "; " << latencyStageName(static_cast<latency_stage>(i));
+                    lout << "\n";
+                }
+
+                QTextStream out(&f);
+                LatencyRecorder latencies;
+                const FrameTimingHistory history = runConfiguration(renderer, mode, res.at(0), res.at(1),
+                                                                    seed, out, quality ? &qout : nullptr,
+                                                                    latencies, latency ? &lout : nullptr);
+                writeTimingStats(history, latencies, f.fileName() + ".stats");
+                ++written;
+                std::cout << "  " << configName.toStdString() << " " << MODE_NAMES[mode] << std::endl;
+            }
+        }
+    }
+    return written;
+}
+
+/**
+ * @brief Write min, mean, p95 and p99 of every timing value over the most recent frames,
+ *        one line per value, followed by the gaze-to-photon latency if it was measured.
+ */
+void BenchmarkRunner::writeTimingStats(const FrameTimingHistory &history,
+                                       const LatencyRecorder &latency, const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QFile::WriteOnly | QFile::Text))
+    {
+        std::cerr << "Could not open " << fileName.toStdString() << std::endl;
+        return;
+    }
+    QTextStream out(&f);
+    out << "stage; min; mean; p95; p99\n";
+    for (int i = 0; i < TIMING_COUNT; ++i)
+    {
+        const TimingStats stats = history.getStats(static_cast<timing_id>(i));
+        out << timingName(static_cast<timing_id>(i)) << "; " << stats.min << "; " << stats.mean
+            << "; " << stats.p95 << "; " << stats.p99 << "\n";
+    }
+#ifdef KERNEL_COUNTERS
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+    {
+        const TimingStats stats = history.getCounterStats(static_cast<counter_id>(i));
+        out << counterName(static_cast<counter_id>(i)) << "; " << stats.min << "; " << stats.mean
+            << "; " << stats.p95 << "; " << stats.p99 << "\n";
+    }
+#endif
+    if (latency.size() == 0)
+        return;
+    const TimingStats total = latency.getStats(STAGE_CAPTURE, STAGE_PRESENT);
+    out << "latency; " << total.min << "; " << total.mean << "; " << total.p95 << "; "
+        << total.p99 << "\n";
+    for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+    {
+        const TimingStats stats = latency.getStageStats(static_cast<latency_stage>(i));
+        out << "latency/" << latencyStageName(static_cast<latency_stage>(i)) << "; " << stats.min
+            << "; " << stats.mean << "; " << stats.p95 << "; " << stats.p99 << "\n";
+    }
+}
+
+/**
+ * @brief Build the camera/gaze sequence of one configuration. The random trajectory draws camera
+ *        and gaze from separate generators so that all modes share the same camera poses.
+ */
+std::vector<TrajectorySample> BenchmarkRunner::createTrajectory(const unsigned int mode,
+                                                                const quint64 seed) const
+{
+    const quint64 gazeIterations = (mode != 0u || _generatedTrajectory) ? _gazeIterations : 1;
+    std::vector<TrajectorySample> frames;
+    if (_generatedTrajectory)
+    {
+        TrajectoryGenerator gen(seed);
+        frames = gen.generate(static_cast<size_t>(_cameraIterations*gazeIterations));
+        return frames;
+    }
+
+    QRandomGenerator64 camPrng(seed);
+    QRandomGenerator64 gazePrng(seed + 1);
+    Camera cam;
+    for (quint64 c = 0; c < _cameraIterations; ++c)
+    {
+        // same random camera update as the interactive benchmark mode
+        const float dx = canonical(camPrng);
+        const float dy = canonical(camPrng);
+        QVector3D trans = cam.getTranslation();
+        trans.setZ(canonical(camPrng) * 4);
+        cam.setTranslation(trans);
+        cam.rotate(dx, dy);
+
+        for (quint64 g = 0; g < gazeIterations; ++g)
+        {
+            TrajectorySample s;
+            s.camera = cam;
+            if (mode != 0u)
+            {
+                s.gazeX = canonical(gazePrng);
+                s.gazeY = canonical(gazePrng);
+            }
+            frames.push_back(s);
+        }
+    }
+    return frames;
+}
+
+/**
+ * @brief Render the camera/gaze sequence of the given seed.
+ *        If a quality stream is given, each camera pose is additionally rendered in Standard mode
+ *        as ground truth. Those frames are excluded from the returned timing history.
+ *        If a latency stream is given, the gaze is taken from the replayed gaze source and the
+ *        latency of every frame is recorded, a headless frame is presented once read back.
+ */
+FrameTimingHistory BenchmarkRunner::runConfiguration(VolumeRenderCL &renderer,
+                                                     const unsigned int mode,
+                                                     const size_t width, const size_t height,
+                                                     const quint64 seed, QTextStream &out,
+                                                     QTextStream *quality,
+                                                     LatencyRecorder &latency,
+                                                     QTextStream *latencyOut)
+{
+    std::vector<unsigned char> frame;
+    std::vector<float> frameF;
+    std::vector<float> reference;
+    auto render = [&]() {
+        if (mode == 1u && quality)
+            renderer.runRaycastLBGNoGL(width, height, 0, frameF);
+        else if (mode == 1u)
+            renderer.runRaycastLBGNoGL(width, height, 0, frame);
+        else if (mode == 2u && quality)
+            renderer.runRaycastMultiResNoGL(width, height, 0, frameF);
+        else if (mode == 2u)
+            renderer.runRaycastMultiResNoGL(width, height, 0, frame);
+        else if (mode == 3u && quality)
+            renderer.runRaycastVariableRateNoGL(width, height, 0, frameF);
+        else if (mode == 3u)
+            renderer.runRaycastVariableRateNoGL(width, height, 0, frame);
+        else
+            renderer.runRaycastNoGL(width, height, 0, frame);
+    };
+    const ImageQuality metrics(_pixelsPerDegree, _e2);
+
+    Camera cam;
+    renderer.updateView(cam.getViewMatrix());
+    cl_float2 gaze = {{0.5f, 0.5f}};
+    renderer.setGazePoint(gaze);
+    for (quint64 i = 0; i < _warmup; ++i)
+        render();
+
+    // only measured frames go into the timing statistics
+    const std::vector<TrajectorySample> frames = createTrajectory(mode, seed);
+    const size_t measured = qMax(size_t(1), frames.size()*static_cast<size_t>(_repetitions));
+    FrameTimingHistory history(measured);
+
+    GazeBuffer gazeBuffer;
+    std::unique_ptr<ReplayGazeSource> gazeSource;
+    if (latencyOut)
+    {
+        gazeSource.reset(new ReplayGazeSource(gazeBuffer, _gazeSource, true));
+        if (!gazeSource->start())
+            gazeSource.reset();
+        latency = LatencyRecorder(measured);
+    }
+    for (size_t iteration = 0; iteration < frames.size(); ++iteration)
+    {
+        const TrajectorySample &sample = frames.at(iteration);
+        const QQuaternion rot = sample.camera.getRotation();
+        const QVector3D trans = sample.camera.getTranslation();
+        if (iteration == 0 || rot != cam.getRotation() || trans != cam.getTranslation())
+        {
+            cam = sample.camera;
+            renderer.updateView(cam.getViewMatrix());
+            if (quality)
+            {
+                // ground truth does not depend on the gaze point
+                renderer.updateRenderingParameters(0);
+                renderer.runRaycastNoGL(width, height, 0, reference);
+                renderer.updateRenderingParameters(mode);
+            }
+        }
+        if (mode != 0u && !gazeSource)
+        {
+            gaze.s[0] = sample.gazeX;
+            gaze.s[1] = sample.gazeY;
+            renderer.setGazePoint(gaze);
+        }
+
+        for (quint64 r = 0; r < _repetitions; ++r)
+        {
+            GazeSample replayed;
+            if (gazeSource && gazeBuffer.latestValid(replayed))
+            {
+                gaze.s[0] = replayed.x;
+                gaze.s[1] = replayed.y;
+                renderer.setGazePoint(gaze);
+                latency.begin(replayed);
+            }
+            render();
+            history.push(renderer.getLastFrameTiming());
+            latency.stamp(STAGE_RENDER);
+            if (latency.present() && latencyOut)
+            {
+                const FrameLatency last = latency.last();
+                *latencyOut << iteration << "; " << last.total();
+                for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+                    *latencyOut << "; " << last.duration(static_cast<latency_stage>(i));
+                *latencyOut << "\n";
+            }
+            out << iteration << "; ";
+            out << rot.scalar() << " " << rot.x() << " " << rot.y() << " " << rot.z() << "; ";
+            out << trans.x() << " " << trans.y() << " " << trans.z() << "; ";
+            out << (mode != 0u ? gaze.s[0] : 0.f) << " " << (mode != 0u ? gaze.s[1] : 0.f) << "; ";
+            out << renderer.getLastExecTime() << "\n";
+        }
+        if (quality)
+        {
+            const QualityMetrics q = metrics.compare(reference, frameF, width, height,
+                                                     gaze.s[0]*width, gaze.s[1]*height);
+            *quality << iteration << "; " << gaze.s[0] << " " << gaze.s[1] << "; "
+                     << renderer.getLastExecTime() << "; " << q.psnr << "; " << q.ssim << "; "
+                     << q.weightedPsnr << "; " << q.weightedSsim << "\n";
+        }
+    }
+    if (gazeSource)
+        gazeSource->stop();
+    out.flush();
+    if (quality)
+        quality->flush();
+    if (latencyOut)
+        latencyOut->flush();
+    return history;
+}
@@ -0,0 +1,177 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <QDir>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "src/core/imagequality.h"
+#include "src/core/trajectory.h"
+#include "src/core/volumerendercl.h"
+#include "src/gaze/gazelatency.h"
+
+/**
+ * @brief Non-interactive benchmark runner driven by a JSON manifest.
+ *        Renders every combination of data set, rendering mode, resolution, sampling rate,
+ *        image precision and camera path seed headless and writes one result file per
+ *        configuration in the format consumed by FoveatedBenchmarks.ipynb:
+ *        iteration; w x y z; tx ty tz; gaze x y; execution time
+ *        Optionally, every foveated (LBG, multi-resolution or variable rate) frame is compared
+ *        to a full resolution Standard rendering of the same camera pose and the image quality is written
+ *        to a separate .quality file.
+ *        Camera and gaze either follow the uniform random path of the interactive benchmark or a
+ *        generated trajectory with realistic eye movements (manifest key "trajectory": "generated").
+ *        With a gaze source (manifest key "gazeSource", an interaction log), the foveated modes
+ *        use the latest sample of the replayed log instead and the gaze-to-photon latency of
+ *        every frame is written to a separate .latency file.
+ */
+class BenchmarkRunner
+{
+public:
+    struct DataSet
+    {
+        QString name;
+        QString volume;     // .dat file
+        QString tff;        // raw .tff file, linear ramp if empty
+    };
+
+    BenchmarkRunner();
+
+    /**
+     * @brief Load a benchmark manifest. Relative paths are resolved against the directory of
+     *        the manifest file.
+     * @param fileName JSON manifest file.
+     * @throws std::invalid_argument if the file cannot be read or parsed.
+     */
+    void loadManifest(const QString &fileName);
+
+    /**
+     * @brief Read the benchmark configuration from a JSON object.
+     * @param json Manifest object.
+     * @param baseDir Directory relative file names are resolved against.
+     */
+    void read(const QJsonObject &json, const QDir &baseDir = QDir());
+
+    /**
+     * @brief Write the benchmark configuration to a JSON object.
+     * @param json Manifest object.
+     */
+    void write(QJsonObject &json) const;
+
+    /**
+     * @brief Add a data set to benchmark.
+     */
+    void addDataSet(const QString &name, const QString &volume, const QString &tff);
+
+    /**
+     * @brief Set index map, sampling map, neighbor ids and neighbor weights for LBG sampling.
+     */
+    void setLbgMaps(const QStringList &files);
+
+    /**
+     * @brief Set the layer configuration of the multi-resolution mode.
+     */
+    void setMultiResParameters(const VolumeRenderCL::MultiResParameters &parameters);
+
+    /**
+     * @brief Set the shading rate control of the variable rate mode.
+     */
+    void setVariableRateParameters(const VolumeRenderCL::VariableRateParameters &parameters);
+
+    /**
+     * @brief Replay the gaze of an interaction log in the foveated modes and measure the
+     *        gaze-to-photon latency of every frame. An empty file name disables it.
+     */
+    void setGazeSource(const QString &fileName);
+
+    /**
+     * @brief Set the directory the result files are written to.
+     */
+    void setOutputDirectory(const QString &dir);
+
+    /**
+     * @brief Select the OpenCL device used for the benchmark.
+     */
+    void setDevice(const bool useCPU, const QString &deviceName, const int platformId = -1);
+
+    /**
+     * @brief Enable comparing foveated frames to Standard ground truth frames.
+     * @param enable Compute image quality metrics.
+     * @param pixelsPerDegree Screen pixels per degree of visual angle for eccentricity weighting.
+     * @param e2 Eccentricity in degrees at which the weight has dropped to one half.
+     */
+    void setQualityEnabled(const bool enable, const double pixelsPerDegree = 40.0,
+                           const double e2 = 2.3);
+
+    /**
+     * @brief Run all configurations.
+     * @return Number of result files written.
+     * @throws std::runtime_error if the renderer can not be initialized or the output
+     *         directory can not be created.
+     * @throws std::invalid_argument if the multi-resolution or variable rate parameters are
+     *         invalid.
+     */
+    size_t run();
+
+private:
+    std::vector<TrajectorySample> createTrajectory(const unsigned int mode,
+                                                   const quint64 seed) const;
+    FrameTimingHistory runConfiguration(VolumeRenderCL &renderer, const unsigned int mode,
+                                        const size_t width, const size_t height,
+                                        const quint64 seed, QTextStream &out,
+                                        QTextStream *quality, LatencyRecorder &latency,
+                                        QTextStream *latencyOut);
+    void writeTimingStats(const FrameTimingHistory &history, const LatencyRecorder &latency,
+                          const QString &fileName);
+
+    std::vector<DataSet> _dataSets;
+    std::vector<unsigned int> _modes;
+    std::vector<std::array<size_t, 2>> _resolutions;
+    std::vector<double> _samplingRates;
+    std::vector<VolumeRenderCL::image_precision> _precisions;
+    std::vector<quint64> _seeds;
+    QStringList _lbgMaps;
+    VolumeRenderCL::MultiResParameters _multiRes;
+    VolumeRenderCL::VariableRateParameters _variableRate;
+    QString _gazeSource;
+    QString _outputDir;
+
+    quint64 _warmup;
+    quint64 _repetitions;
+    quint64 _cameraIterations;
+    quint64 _gazeIterations;
+    bool _generatedTrajectory;
+
+    bool _useCPU;
+    QString _deviceName;
+    int _platformId;
+
+    bool _quality;
+    double _pixelsPerDegree;
+    double _e2;
+};
@@ -0,0 +1,140 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/camera.h"
+
+#include <QStringList>
+#include <QVector2D>
+
+/**
+ * @brief Camera::Camera
+ */
+Camera::Camera()
+    : _rotation(QQuaternion(1, 0, 0, 0))
+    , _translation(QVector3D(0, 0, 2.0))
+{
+}
+
+/**
+ * @brief Camera::reset
+ */
+void Camera::reset()
+{
+    _rotation = QQuaternion(1, 0, 0, 0);
+    _translation = QVector3D(0, 0, 2.0);
+}
+
+/**
+ * @brief Camera::rotate
+ * @param dx
+ * @param dy
+ */
+void Camera::rotate(float dx, float dy)
+{
+    QVector3D rotAxis = QVector3D(dy, dx, 0.0f).normalized();
+    float angle = QVector2D(dx, dy).length()*360.f;
+    _rotation = _rotation * QQuaternion::fromAxisAndAngle(rotAxis, -angle);
+}
+
+/**
+ * @brief Camera::getViewMatrix
+ * @return
+ */
+std::array<float, 16> Camera::getViewMatrix() const
+{
+    QMatrix4x4 viewMat;
+    viewMat.rotate(_rotation);
+    viewMat.translate(_translation);
+    viewMat.scale(_translation.z());
+
+    std::array<float, 16> viewArray;
+    const QMatrix4x4 viewMatT = viewMat.transposed();
+    for (size_t i = 0; i < viewArray.size(); ++i)
+        viewArray.at(i) = viewMatT.constData()[i];
+    return viewArray;
+}
+
+/**
+ * @brief Camera::getCoordViewMatrix
+ * @return
+ */
+QMatrix4x4 Camera::getCoordViewMatrix() const
+{
+    QMatrix4x4 coordViewMX;
+    coordViewMX.scale(1, -1, 1);
+    coordViewMX.translate(_translation * -1.0);
+    coordViewMX *= QMatrix4x4(_rotation.toRotationMatrix().transposed());
+    return coordViewMX;
+}
+
+/**
+ * @brief Camera::toString
+ * @return
+ */
+QString Camera::toString() const
+{
+    QString s;
+    s += QString::number(_rotation.scalar()) + " ";
+    s += QString::number(_rotation.x()) + " " + QString::number(_rotation.y()) + " ";
+    s += QString::number(_rotation.z()) + ", ";
+    s += QString::number(_translation.x()) + " " + QString::number(_translation.y()) + " ";
+    s += QString::number(_translation.z());
+    return s;
+}
+
+/**
+ * @brief Camera::fromString
+ * @param str
+ * @return
+ */
+bool Camera::fromString(QString str)
+{
+    QStringList values = str.remove(',').split(' ', QString::SkipEmptyParts);
+    if (values.size() < 7)
+        return false;
+
+    _rotation = QQuaternion(values.at(0).toFloat(), values.at(1).toFloat(),
+                            values.at(2).toFloat(), values.at(3).toFloat());
+    _translation = QVector3D(values.at(4).toFloat(), values.at(5).toFloat(),
+                             values.at(6).toFloat());
+    return true;
+}
+
+QQuaternion Camera::getRotation() const
+{
+    return _rotation;
+}
+
+void Camera::setRotation(const QQuaternion &rotation)
+{
+    _rotation = rotation;
+}
+
+QVector3D Camera::getTranslation() const
+{
+    return _translation;
+}
+
+void Camera::setTranslation(const QVector3D &translation)
+{
+    _translation = translation;
+}
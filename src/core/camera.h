@@ -0,0 +1,83 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <array>
+
+#include <QQuaternion>
+#include <QVector3D>
+#include <QMatrix4x4>
+#include <QString>
+
+/**
+ * @brief Orbit camera around the volume center.
+ *        Holds rotation and translation and derives the view matrices used by the renderer
+ *        and the orientation overlay. Independent of any widget or GL context.
+ */
+class Camera
+{
+public:
+    Camera();
+
+    /**
+     * @brief Reset to the default view (no rotation, two units away from the volume).
+     */
+    void reset();
+
+    /**
+     * @brief Rotate the camera by normalized screen space deltas.
+     * @param dx Horizontal delta, 1 corresponds to a full turn.
+     * @param dy Vertical delta, 1 corresponds to a full turn.
+     */
+    void rotate(float dx, float dy);
+
+    /**
+     * @brief Get the view matrix in the row major layout expected by VolumeRenderCL::updateView.
+     */
+    std::array<float, 16> getViewMatrix() const;
+
+    /**
+     * @brief Get the view matrix for drawing the coordinate axes overlay.
+     */
+    QMatrix4x4 getCoordViewMatrix() const;
+
+    /**
+     * @brief Serialize to the interaction log format "w x y z, tx ty tz".
+     */
+    QString toString() const;
+
+    /**
+     * @brief Parse the interaction log format "w x y z, tx ty tz".
+     * @return false if the string does not contain seven values, camera stays unchanged.
+     */
+    bool fromString(QString str);
+
+    QQuaternion getRotation() const;
+    void setRotation(const QQuaternion &rotation);
+
+    QVector3D getTranslation() const;
+    void setTranslation(const QVector3D &translation);
+
+private:
+    QQuaternion _rotation;
+    QVector3D _translation;
+};
@@ -0,0 +1,413 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/eventlogger.h"
+#include "src/core/tracer.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <QFile>
+#include <QTextStream>
+
+static const char LOG_MAGIC[4] = {'F', 'V', 'R', 'L'};
+static const uint32_t LOG_VERSION = 1;
+static const size_t RECORD_HEADER = sizeof(int64_t) + 2*sizeof(uint16_t);
+
+static void packCamera(const Camera &camera, float *v)
+{
+    const QQuaternion rot = camera.getRotation();
+    const QVector3D trans = camera.getTranslation();
+    v[0] = rot.scalar(); v[1] = rot.x(); v[2] = rot.y(); v[3] = rot.z();
+    v[4] = trans.x(); v[5] = trans.y(); v[6] = trans.z();
+}
+
+static Camera unpackCamera(const float *v)
+{
+    Camera camera;
+    camera.setRotation(QQuaternion(v[0], v[1], v[2], v[3]));
+    camera.setTranslation(QVector3D(v[4], v[5], v[6]));
+    return camera;
+}
+
+/**
+ * @brief EventLogger::EventLogger
+ * @param capacity Ring buffer size in bytes.
+ */
+EventLogger::EventLogger(const size_t capacity)
+    : _buffer(capacity)
+    , _head(0)
+    , _tail(0)
+    , _running(false)
+    , _dropped(0)
+    , _convertOnClose(true)
+{
+}
+
+/**
+ * @brief EventLogger::~EventLogger
+ */
+EventLogger::~EventLogger()
+{
+    close();
+}
+
+/**
+ * @brief EventLogger::open
+ * @param fileName
+ * @param convertOnClose
+ * @return
+ */
+bool EventLogger::open(const QString &fileName, const bool convertOnClose)
+{
+    close();
+    _file.open((fileName + ".bin").toStdString(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!_file.is_open())
+        return false;
+    _file.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+    _file.write(reinterpret_cast<const char*>(&LOG_VERSION), sizeof(LOG_VERSION));
+
+    _fileName = fileName;
+    _convertOnClose = convertOnClose;
+    _head = 0;
+    _tail = 0;
+    _dropped = 0;
+    _running = true;
+    _writer = std::thread(&EventLogger::writerLoop, this);
+    return true;
+}
+
+/**
+ * @brief EventLogger::close
+ */
+void EventLogger::close()
+{
+    if (!_running)
+        return;
+    _running = false;
+    if (_writer.joinable())
+        _writer.join();
+    _file.close();
+
+    if (_dropped > 0)
+        std::cerr << "Event log " << _fileName.toStdString() << ": dropped " << _dropped
+                  << " records, buffer full." << std::endl;
+    if (_convertOnClose && !convertToText(_fileName + ".bin", _fileName))
+        std::cerr << "Could not convert event log " << _fileName.toStdString() << std::endl;
+}
+
+bool EventLogger::isOpen() const
+{
+    return _running;
+}
+
+uint64_t EventLogger::getDropped() const
+{
+    return _dropped;
+}
+
+void EventLogger::copyIn(const size_t pos, const void *src, const size_t size)
+{
+    const size_t offset = pos % _buffer.size();
+    const size_t first = std::min(size, _buffer.size() - offset);
+    memcpy(&_buffer[offset], src, first);
+    memcpy(&_buffer[0], static_cast<const char*>(src) + first, size - first);
+}
+
+void EventLogger::copyOut(const size_t pos, void *dst, const size_t size) const
+{
+    const size_t offset = pos % _buffer.size();
+    const size_t first = std::min(size, _buffer.size() - offset);
+    memcpy(dst, &_buffer[offset], first);
+    memcpy(static_cast<char*>(dst) + first, &_buffer[0], size - first);
+}
+
+/**
+ * @brief Append one record to the ring buffer.
+ * @return false if the logger is closed or the buffer is full.
+ */
+bool EventLogger::log(const log_event type, const int64_t time, const void *payload,
+                      const uint16_t size)
+{
+    if (!_running)
+        return false;
+    const size_t head = _head.load(std::memory_order_relaxed);
+    const size_t tail = _tail.load(std::memory_order_acquire);
+    if (_buffer.size() - (head - tail) < RECORD_HEADER + size)
+    {
+        ++_dropped;
+        return false;
+    }
+    const uint16_t t = static_cast<uint16_t>(type);
+    copyIn(head, &time, sizeof(time));
+    copyIn(head + sizeof(time), &t, sizeof(t));
+    copyIn(head + sizeof(time) + sizeof(t), &size, sizeof(size));
+    copyIn(head + RECORD_HEADER, payload, size);
+    _head.store(head + RECORD_HEADER + size, std::memory_order_release);
+    return true;
+}
+
+void EventLogger::logCamera(const int64_t time, const Camera &camera)
+{
+    float v[7];
+    packCamera(camera, v);
+    log(EVENT_CAMERA, time, v, sizeof(v));
+}
+
+void EventLogger::logGaze(const int64_t time, const float x, const float y)
+{
+    const float v[2] = {x, y};
+    log(EVENT_GAZE, time, v, sizeof(v));
+}
+
+void EventLogger::logTimestep(const int64_t time, const int timestep)
+{
+    const int32_t v = static_cast<int32_t>(timestep);
+    log(EVENT_TIMESTEP, time, &v, sizeof(v));
+}
+
+void EventLogger::logTransferFunction(const int64_t time, const std::vector<unsigned char> &tff)
+{
+    log(EVENT_TFF, time, tff.data(), static_cast<uint16_t>(std::min(tff.size(), size_t(UINT16_MAX))));
+}
+
+void EventLogger::logTffInterpolation(const int64_t time, const bool quad)
+{
+    const uint8_t v = quad ? 1 : 0;
+    log(EVENT_TFF_INTERPOLATION, time, &v, sizeof(v));
+}
+
+void EventLogger::logView(const int64_t time, const Camera &camera)
+{
+    float v[7];
+    packCamera(camera, v);
+    log(EVENT_VIEW, time, v, sizeof(v));
+}
+
+void EventLogger::logBenchmark(const int64_t time, const uint64_t iteration, const Camera &camera,
+                               const float gazeX, const float gazeY, const double execTime)
+{
+    char v[sizeof(uint64_t) + 9*sizeof(float) + sizeof(double)];
+    float f[9];
+    packCamera(camera, f);
+    f[7] = gazeX;
+    f[8] = gazeY;
+    memcpy(v, &iteration, sizeof(iteration));
+    memcpy(v + sizeof(iteration), f, sizeof(f));
+    memcpy(v + sizeof(iteration) + sizeof(f), &execTime, sizeof(execTime));
+    log(EVENT_BENCHMARK, time, v, sizeof(v));
+}
+
+void EventLogger::logPrediction(const int64_t time, const float predicted[2], const float raw[2],
+                                const float actual[2], const float horizon)
+{
+    const float v[7] = {predicted[0], predicted[1], raw[0], raw[1], actual[0], actual[1], horizon};
+    log(EVENT_PREDICTION, time, v, sizeof(v));
+}
+
+/**
+ * @brief EventLogger::logLatency
+ * @param time
+ * @param latency Stamps of a presented frame, stages that were not stamped are logged as 0.
+ */
+void EventLogger::logLatency(const int64_t time, const FrameLatency &latency)
+{
+    float v[STAGE_COUNT];
+    v[0] = static_cast<float>(latency.total() * 1e3);
+    for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+        v[i] = static_cast<float>(latency.duration(static_cast<latency_stage>(i)) * 1e3);
+    log(EVENT_LATENCY, time, v, sizeof(v));
+}
+
+/**
+ * @brief Write all complete records to the binary file.
+ * @return Number of bytes written.
+ */
+size_t EventLogger::drain()
+{
+    const size_t head = _head.load(std::memory_order_acquire);
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t bytes = head - tail;
+    // records are contiguous in the ring, write at most two chunks
+    while (tail < head)
+    {
+        const size_t offset = tail % _buffer.size();
+        const size_t chunk = std::min(head - tail, _buffer.size() - offset);
+        _file.write(&_buffer[offset], static_cast<std::streamsize>(chunk));
+        tail += chunk;
+    }
+    _tail.store(tail, std::memory_order_release);
+    return bytes;
+}
+
+/**
+ * @brief Background thread: poll the ring buffer and write records until closed.
+ */
+void EventLogger::writerLoop()
+{
+    Tracer::setThreadName("event logger");
+    while (_running)
+    {
+        if (drain() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    drain();
+    _file.flush();
+}
+
+/**
+ * @brief EventLogger::convertToText
+ * @param binaryFile
+ * @param textFile
+ * @return
+ */
+bool EventLogger::convertToText(const QString &binaryFile, const QString &textFile)
+{
+    std::ifstream in(binaryFile.toStdString(), std::ios::in | std::ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0
+            || !in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != LOG_VERSION)
+        return false;
+
+    // output files are only created if records of their kind exist
+    QFile text(textFile);
+    QFile quat(textFile + "_quat.txt");
+    QFile trans(textFile + "_trans.txt");
+    QTextStream textStream(&text);
+    QTextStream quatStream(&quat);
+    QTextStream transStream(&trans);
+    auto openText = [](QFile &f) {
+        return f.isOpen() || f.open(QFile::WriteOnly | QFile::Text);
+    };
+
+    std::vector<char> payload;
+    int64_t time = 0;
+    uint16_t type = 0;
+    uint16_t size = 0;
+    while (in.read(reinterpret_cast<char*>(&time), sizeof(time)))
+    {
+        if (!in.read(reinterpret_cast<char*>(&type), sizeof(type))
+                || !in.read(reinterpret_cast<char*>(&size), sizeof(size)))
+            return false;
+        payload.resize(size);
+        if (size > 0 && !in.read(payload.data(), size))
+            return false;
+
+        if (type == EVENT_VIEW)
+        {
+            if (size != 7*sizeof(float) || !openText(quat) || !openText(trans))
+                return false;
+            const float *v = reinterpret_cast<const float*>(payload.data());
+            quatStream << v[0] << " " << v[1] << " " << v[2] << " " << v[3] << "; ";
+            transStream << v[4] << " " << v[5] << " " << v[6] << "; ";
+            continue;
+        }
+        if (!openText(text))
+            return false;
+
+        QString s;
+        switch (type)
+        {
+        case EVENT_CAMERA:
+            if (size != 7*sizeof(float))
+                return false;
+            s = QString::number(time) + "; camera; "
+                    + unpackCamera(reinterpret_cast<const float*>(payload.data())).toString() + "\n";
+            break;
+        case EVENT_GAZE:
+        {
+            if (size != 2*sizeof(float))
+                return false;
+            const float *v = reinterpret_cast<const float*>(payload.data());
+            s = QString::number(time) + "; gaze; " + QString::number(v[0]) + " "
+                    + QString::number(v[1]) + "\n";
+            break;
+        }
+        case EVENT_TIMESTEP:
+        {
+            int32_t v = 0;
+            if (size != sizeof(v))
+                return false;
+            memcpy(&v, payload.data(), sizeof(v));
+            s = QString::number(time) + "; timestep; " + QString::number(v) + "\n";
+            break;
+        }
+        case EVENT_TFF:
+            s = QString::number(time) + "; transferFunction; ";
+            for (char c : payload)
+                s += QString::number(static_cast<int>(static_cast<unsigned char>(c))) + " ";
+            s += "\n";
+            break;
+        case EVENT_TFF_INTERPOLATION:
+            if (size != 1)
+                return false;
+            s = QString::number(time) + "; tffInterpolation; " + (payload[0] ? "quad" : "linear") + "\n";
+            break;
+        case EVENT_BENCHMARK:
+        {
+            uint64_t iteration = 0;
+            float v[9];
+            double exec = 0;
+            if (size != sizeof(iteration) + sizeof(v) + sizeof(exec))
+                return false;
+            memcpy(&iteration, payload.data(), sizeof(iteration));
+            memcpy(v, payload.data() + sizeof(iteration), sizeof(v));
+            memcpy(&exec, payload.data() + sizeof(iteration) + sizeof(v), sizeof(exec));
+            // same format as the interactive benchmark and BenchmarkRunner
+            textStream << iteration << "; " << v[0] << " " << v[1] << " " << v[2] << " " << v[3] << "; "
+                       << v[4] << " " << v[5] << " " << v[6] << "; " << v[7] << " " << v[8] << "; "
+                       << exec << "\n";
+            break;
+        }
+        case EVENT_PREDICTION:
+        {
+            if (size != 7*sizeof(float))
+                return false;
+            const float *v = reinterpret_cast<const float*>(payload.data());
+            s = QString::number(time) + "; prediction; " + QString::number(v[0]) + " "
+                    + QString::number(v[1]) + "; " + QString::number(v[2]) + " "
+                    + QString::number(v[3]) + "; " + QString::number(v[4]) + " "
+                    + QString::number(v[5]) + "; " + QString::number(v[6]) + "\n";
+            break;
+        }
+        case EVENT_LATENCY:
+        {
+            if (size != STAGE_COUNT*sizeof(float))
+                return false;
+            const float *v = reinterpret_cast<const float*>(payload.data());
+            s = QString::number(time) + "; latency; " + QString::number(v[0]) + ";";
+            for (int i = 1; i < STAGE_COUNT; ++i)
+                s += " " + QString::number(v[i]);
+            s += "\n";
+            break;
+        }
+        default:
+            std::cerr << "Skipping unknown event type " << type << std::endl;
+            break;
+        }
+        textStream << s;
+    }
+    return true;
+}
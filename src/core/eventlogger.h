@@ -0,0 +1,131 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <QString>
+
+#include "src/core/camera.h"
+#include "src/gaze/gazelatency.h"
+
+/**
+ * @brief Event types of the binary interaction and benchmark log.
+ */
+enum log_event : uint16_t
+{
+    EVENT_CAMERA = 0            // w x y z tx ty tz (7 floats)
+  , EVENT_GAZE                  // x y (2 floats)
+  , EVENT_TIMESTEP              // int32
+  , EVENT_TFF                   // RGBA bytes
+  , EVENT_TFF_INTERPOLATION     // uint8, 1 for quad, 0 for linear
+  , EVENT_VIEW                  // w x y z tx ty tz (7 floats)
+  , EVENT_BENCHMARK             // uint64 iteration, 7 floats camera, 2 floats gaze, double time
+  , EVENT_PREDICTION            // predicted x y, raw x y, actual x y, horizon [ms] (7 floats)
+  , EVENT_LATENCY               // gaze-to-photon total, then the duration of each stage [ms] (6 floats)
+
+  , EVENT_COUNT
+};
+
+/**
+ * @brief Asynchronous logger for interactions and benchmark results.
+ *        Records (time stamp, event type, payload) are appended to a lock-free single producer
+ *        ring buffer and written in a compact binary format by a background thread, so logging
+ *        never blocks the render thread. Records are dropped if the buffer is full.
+ *        When the log is closed, the binary file is converted to the text formats read by
+ *        playInteractionSequence and FoveatedBenchmarks.ipynb.
+ *
+ *        Binary layout (native byte order): "FVRL", uint32 version, then per record
+ *        int64 time [ms], uint16 type, uint16 payload size, payload.
+ */
+class EventLogger
+{
+public:
+    explicit EventLogger(const size_t capacity = 1 << 20);
+    ~EventLogger();
+
+    EventLogger(const EventLogger &) = delete;
+    EventLogger &operator=(const EventLogger &) = delete;
+
+    /**
+     * @brief Start logging to <fileName>.bin.
+     * @param fileName Name of the text log created on close.
+     * @param convertOnClose Convert the binary log to text when closing.
+     * @return false if the binary file can not be opened.
+     */
+    bool open(const QString &fileName, const bool convertOnClose = true);
+
+    /**
+     * @brief Stop the writer thread after all pending records have been written
+     *        and convert the log to text if requested.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief Number of records dropped because the buffer was full.
+     */
+    uint64_t getDropped() const;
+
+    // Producer interface, must only be called from one thread at a time.
+    bool log(const log_event type, const int64_t time, const void *payload, const uint16_t size);
+    void logCamera(const int64_t time, const Camera &camera);
+    void logGaze(const int64_t time, const float x, const float y);
+    void logTimestep(const int64_t time, const int timestep);
+    void logTransferFunction(const int64_t time, const std::vector<unsigned char> &tff);
+    void logTffInterpolation(const int64_t time, const bool quad);
+    void logView(const int64_t time, const Camera &camera);
+    void logBenchmark(const int64_t time, const uint64_t iteration, const Camera &camera,
+                      const float gazeX, const float gazeY, const double execTime);
+    void logPrediction(const int64_t time, const float predicted[2], const float raw[2],
+                       const float actual[2], const float horizon);
+    void logLatency(const int64_t time, const FrameLatency &latency);
+
+    /**
+     * @brief Convert a binary log to the text formats. Interaction events are written to
+     *        textFile, benchmark records in the notebook format to textFile, and view records to
+     *        textFile_quat.txt and textFile_trans.txt.
+     * @return false if the binary log can not be read or is corrupt.
+     */
+    static bool convertToText(const QString &binaryFile, const QString &textFile);
+
+private:
+    void writerLoop();
+    size_t drain();
+    void copyIn(const size_t pos, const void *src, const size_t size);
+    void copyOut(const size_t pos, void *dst, const size_t size) const;
+
+    std::vector<char> _buffer;
+    std::atomic<size_t> _head;      // written by the producer
+    std::atomic<size_t> _tail;      // written by the writer thread
+    std::atomic<bool> _running;
+    std::atomic<uint64_t> _dropped;
+    std::thread _writer;
+    std::ofstream _file;
+    QString _fileName;
+    bool _convertOnClose;
+};
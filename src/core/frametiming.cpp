@@ -0,0 +1,185 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/frametiming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+static const char * const TIMING_NAMES[TIMING_COUNT] =
+{
+    "acquire", "raycast", "interpolate", "copy", "read", "release",
+    "device", "gap", "host", "interval"
+};
+
+static const char * const COUNTER_NAMES[COUNTER_COUNT] =
+{
+    "rays", "samples", "bricksSkipped", "ert"
+};
+
+const char *timingName(const timing_id id)
+{
+    return id < TIMING_COUNT ? TIMING_NAMES[id] : "";
+}
+
+const char *counterName(const counter_id id)
+{
+    return id < COUNTER_COUNT ? COUNTER_NAMES[id] : "";
+}
+
+/**
+ * @brief FrameTimingHistory::FrameTimingHistory
+ * @param capacity
+ */
+FrameTimingHistory::FrameTimingHistory(const size_t capacity)
+    : _frames(std::max(capacity, static_cast<size_t>(1)))
+    , _next(0)
+    , _count(0)
+{
+}
+
+/**
+ * @brief FrameTimingHistory::push
+ * @param timing
+ */
+void FrameTimingHistory::push(const FrameTiming &timing)
+{
+    _frames.at(_next) = timing;
+    _next = (_next + 1) % _frames.size();
+    _count = std::min(_count + 1, _frames.size());
+}
+
+void FrameTimingHistory::clear()
+{
+    _next = 0;
+    _count = 0;
+}
+
+size_t FrameTimingHistory::size() const
+{
+    return _count;
+}
+
+FrameTiming FrameTimingHistory::last() const
+{
+    if (_count == 0)
+        return FrameTiming();
+    return _frames.at((_next + _frames.size() - 1) % _frames.size());
+}
+
+/**
+ * @brief FrameTimingHistory::at
+ * @param i
+ * @return
+ */
+const FrameTiming &FrameTimingHistory::at(const size_t i) const
+{
+    if (i >= _count)
+        throw std::out_of_range("Frame timing index out of range.");
+    return _frames.at((_next + _frames.size() - _count + i) % _frames.size());
+}
+
+/**
+ * @brief FrameTimingHistory::getStats
+ * @param id
+ * @return
+ */
+TimingStats FrameTimingHistory::getStats(const timing_id id) const
+{
+    if (_count == 0 || id >= TIMING_COUNT)
+        return TimingStats();
+
+    std::vector<double> v(_count);
+    for (size_t i = 0; i < _count; ++i)
+        v.at(i) = _frames.at(i).values.at(id);
+    return calcTimingStats(v);
+}
+
+/**
+ * @brief FrameTimingHistory::getCounterStats
+ * @param id
+ * @return
+ */
+TimingStats FrameTimingHistory::getCounterStats(const counter_id id) const
+{
+    if (_count == 0 || id >= COUNTER_COUNT)
+        return TimingStats();
+
+    std::vector<double> v(_count);
+    for (size_t i = 0; i < _count; ++i)
+        v.at(i) = static_cast<double>(_frames.at(i).counters.at(id));
+    return calcTimingStats(v);
+}
+
+/**
+ * @brief calcTimingStats
+ * @param v
+ * @return
+ */
+TimingStats calcTimingStats(std::vector<double> &v)
+{
+    TimingStats stats;
+    if (v.empty())
+        return stats;
+    std::sort(v.begin(), v.end());
+
+    // nearest rank percentiles
+    auto percentile = [&v](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * v.size()));
+        return v.at(std::min(std::max(rank, static_cast<size_t>(1)), v.size()) - 1);
+    };
+    double sum = 0.0;
+    for (double d : v)
+        sum += d;
+    stats.min = v.front();
+    stats.mean = sum / v.size();
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    return stats;
+}
+
+/**
+ * @brief FrameTimingHistory::toString
+ * @return
+ */
+std::string FrameTimingHistory::toString() const
+{
+    std::ostringstream ss;
+    ss << "frames " << _count;
+    for (int i = 0; i < TIMING_COUNT; ++i)
+    {
+        TimingStats s = getStats(static_cast<timing_id>(i));
+        ss << "; " << timingName(static_cast<timing_id>(i)) << " " << s.min << " " << s.mean
+           << " " << s.p95 << " " << s.p99;
+    }
+#ifdef KERNEL_COUNTERS
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+    {
+        TimingStats s = getCounterStats(static_cast<counter_id>(i));
+        ss << "; " << counterName(static_cast<counter_id>(i)) << " " << s.min << " " << s.mean
+           << " " << s.p95 << " " << s.p99;
+    }
+#endif
+    return ss.str();
+}
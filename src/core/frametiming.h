@@ -0,0 +1,152 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Identifiers of the values recorded per frame. The first entries are device side
+ *        command durations measured with OpenCL profiling events, the remaining ones are
+ *        derived or host side values. All values are in seconds.
+ */
+enum timing_id
+{
+      TIMING_ACQUIRE = 0     // acquire GL objects
+    , TIMING_RAYCAST         // raycasting kernel
+    , TIMING_INTERPOLATE     // LBG interpolation or multi-resolution composition kernel
+    , TIMING_COPY            // copy into the temporal history
+    , TIMING_READ            // read back of the output image (no-GL) or variable rate group count
+    , TIMING_RELEASE         // release GL objects
+    , TIMING_DEVICE          // sum of all device commands
+    , TIMING_GAP             // device idle time between the first and the last command
+    , TIMING_HOST            // host wall clock time of the frame
+    , TIMING_INTERVAL        // host time since the start of the previous frame
+    , TIMING_COUNT
+};
+
+/**
+ * @brief Identifiers of the work counters of the raycasting kernel. Only recorded if the
+ *        renderer is built with KERNEL_COUNTERS, must match the CNT_* defines in the kernel.
+ */
+enum counter_id
+{
+      COUNTER_RAYS = 0          // rays that entered the volume
+    , COUNTER_SAMPLES           // volume samples taken
+    , COUNTER_BRICKS_SKIPPED    // empty bricks skipped by object order ESS
+    , COUNTER_ERT               // rays terminated early
+    , COUNTER_COUNT
+};
+
+/**
+ * @brief Get a short, human readable name of a timing value.
+ */
+const char *timingName(const timing_id id);
+
+/**
+ * @brief Get a short, human readable name of a work counter.
+ */
+const char *counterName(const counter_id id);
+
+/**
+ * @brief Timing record of a single frame.
+ */
+struct FrameTiming
+{
+    FrameTiming() { values.fill(0.0); counters.fill(0); }
+
+    std::array<double, TIMING_COUNT> values;
+    std::array<uint64_t, COUNTER_COUNT> counters;
+};
+
+/**
+ * @brief Aggregated statistics of one timing value over the recorded history.
+ */
+struct TimingStats
+{
+    double min = 0.0;
+    double mean = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+/**
+ * @brief Get min, mean, 95th and 99th percentile of a set of values.
+ * @param v Values, sorted in place. Empty statistics are returned if it is empty.
+ */
+TimingStats calcTimingStats(std::vector<double> &v);
+
+/**
+ * @brief Fixed size ring buffer of the most recent frame timings.
+ */
+class FrameTimingHistory
+{
+public:
+    explicit FrameTimingHistory(const size_t capacity = 512);
+
+    /**
+     * @brief Add a frame, overwriting the oldest one if the buffer is full.
+     */
+    void push(const FrameTiming &timing);
+
+    /**
+     * @brief Remove all recorded frames.
+     */
+    void clear();
+
+    /**
+     * @brief Number of recorded frames.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Get the most recent frame. Returns an empty record if no frame has been recorded.
+     */
+    FrameTiming last() const;
+
+    /**
+     * @brief Get a recorded frame, 0 is the oldest and size() - 1 the most recent one.
+     */
+    const FrameTiming &at(const size_t i) const;
+
+    /**
+     * @brief Get min, mean, 95th and 99th percentile of a value over all recorded frames.
+     */
+    TimingStats getStats(const timing_id id) const;
+
+    /**
+     * @brief Get min, mean, 95th and 99th percentile of a work counter over all recorded frames.
+     */
+    TimingStats getCounterStats(const counter_id id) const;
+
+    /**
+     * @brief Get the statistics of all values as a single line, e.g. for logging.
+     */
+    std::string toString() const;
+
+private:
+    std::vector<FrameTiming> _frames;
+    size_t _next;
+    size_t _count;
+};
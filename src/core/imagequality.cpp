@@ -0,0 +1,184 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/imagequality.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+const int SSIM_WINDOW = 8;          // box window as in the original SSIM formulation
+const double SSIM_C1 = 0.01*0.01;   // (K1*L)^2, L = 1
+const double SSIM_C2 = 0.03*0.03;   // (K2*L)^2
+
+double toPsnr(const double mse)
+{
+    return mse > 0.0 ? 10.0*std::log10(1.0 / mse) : std::numeric_limits<double>::infinity();
+}
+}
+
+/**
+ * @brief ImageQuality::ImageQuality
+ * @param pixelsPerDegree
+ * @param e2
+ */
+ImageQuality::ImageQuality(const double pixelsPerDegree, const double e2)
+    : _pixelsPerDegree(pixelsPerDegree)
+    , _e2(e2)
+{
+}
+
+/**
+ * @brief ImageQuality::calcWeights
+ */
+void ImageQuality::calcWeights(const size_t width, const size_t height,
+                               const float gazeX, const float gazeY) const
+{
+    _weights.resize(width*height);
+    const float invPpd = static_cast<float>(1.0 / _pixelsPerDegree);
+    const float e2 = static_cast<float>(_e2);
+#pragma omp parallel for
+    for (int y = 0; y < static_cast<int>(height); ++y)
+    {
+        float *w = _weights.data() + static_cast<size_t>(y)*width;
+        const float dy = (static_cast<float>(y) - gazeY) * invPpd;
+        for (size_t x = 0; x < width; ++x)
+        {
+            const float dx = (static_cast<float>(x) - gazeX) * invPpd;
+            w[x] = e2 / (e2 + std::sqrt(dx*dx + dy*dy));
+        }
+    }
+}
+
+/**
+ * @brief ImageQuality::compare
+ * @return
+ */
+QualityMetrics ImageQuality::compare(const std::vector<float> &reference,
+                                     const std::vector<float> &test,
+                                     const size_t width, const size_t height,
+                                     const float gazeX, const float gazeY) const
+{
+    const size_t n = width*height;
+    if (n == 0 || reference.size() < n*4 || test.size() < n*4)
+        throw std::invalid_argument("Image size does not match for quality comparison.");
+
+    calcWeights(width, height, gazeX, gazeY);
+    _lumRef.resize(n);
+    _lumTest.resize(n);
+
+    // per pixel squared error and luminance (Rec. 709), inner loops are vectorizable
+    double se = 0.0;
+    double wse = 0.0;
+    double wsum = 0.0;
+#pragma omp parallel for reduction(+:se,wse,wsum)
+    for (int y = 0; y < static_cast<int>(height); ++y)
+    {
+        const size_t row = static_cast<size_t>(y)*width;
+        const float *r = reference.data() + row*4;
+        const float *t = test.data() + row*4;
+        const float *w = _weights.data() + row;
+        float rowSe = 0.f;
+        float rowWse = 0.f;
+        float rowW = 0.f;
+        for (size_t x = 0; x < width; ++x)
+        {
+            const float d0 = r[x*4] - t[x*4];
+            const float d1 = r[x*4 + 1] - t[x*4 + 1];
+            const float d2 = r[x*4 + 2] - t[x*4 + 2];
+            const float e = (d0*d0 + d1*d1 + d2*d2) * (1.f/3.f);
+            rowSe += e;
+            rowWse += w[x]*e;
+            rowW += w[x];
+            _lumRef[row + x] = 0.2126f*r[x*4] + 0.7152f*r[x*4 + 1] + 0.0722f*r[x*4 + 2];
+            _lumTest[row + x] = 0.2126f*t[x*4] + 0.7152f*t[x*4 + 1] + 0.0722f*t[x*4 + 2];
+        }
+        se += rowSe;
+        wse += rowWse;
+        wsum += rowW;
+    }
+
+    QualityMetrics m;
+    m.psnr = toPsnr(se / n);
+    m.weightedPsnr = toPsnr(wse / wsum);
+
+    // SSIM with a sliding box window, window sums from summed area tables
+    // of x, y, x^2, y^2 and xy
+    if (width < SSIM_WINDOW || height < SSIM_WINDOW)
+        return m;
+    const size_t sw = width + 1;
+    const size_t plane = sw*(height + 1);
+    _sat.assign(plane*5, 0.0);
+    for (size_t y = 0; y < height; ++y)
+    {
+        double rowSum[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+        for (size_t x = 0; x < width; ++x)
+        {
+            const double a = _lumRef[y*width + x];
+            const double b = _lumTest[y*width + x];
+            rowSum[0] += a;
+            rowSum[1] += b;
+            rowSum[2] += a*a;
+            rowSum[3] += b*b;
+            rowSum[4] += a*b;
+            for (size_t k = 0; k < 5; ++k)
+                _sat[k*plane + (y + 1)*sw + x + 1] = _sat[k*plane + y*sw + x + 1] + rowSum[k];
+        }
+    }
+
+    const double invN = 1.0 / (SSIM_WINDOW*SSIM_WINDOW);
+    const int rows = static_cast<int>(height) - SSIM_WINDOW + 1;
+    const size_t cols = width - SSIM_WINDOW + 1;
+    double ssimSum = 0.0;
+    double wssimSum = 0.0;
+    double wssimNorm = 0.0;
+#pragma omp parallel for reduction(+:ssimSum,wssimSum,wssimNorm)
+    for (int y = 0; y < rows; ++y)
+    {
+        const size_t y0 = static_cast<size_t>(y);
+        const size_t y1 = y0 + SSIM_WINDOW;
+        for (size_t x0 = 0; x0 < cols; ++x0)
+        {
+            const size_t x1 = x0 + SSIM_WINDOW;
+            double s[5];
+            for (size_t k = 0; k < 5; ++k)
+            {
+                const double *p = _sat.data() + k*plane;
+                s[k] = (p[y1*sw + x1] - p[y0*sw + x1] - p[y1*sw + x0] + p[y0*sw + x0]) * invN;
+            }
+            const double varA = s[2] - s[0]*s[0];
+            const double varB = s[3] - s[1]*s[1];
+            const double cov = s[4] - s[0]*s[1];
+            const double ssim = ((2.0*s[0]*s[1] + SSIM_C1) * (2.0*cov + SSIM_C2))
+                              / ((s[0]*s[0] + s[1]*s[1] + SSIM_C1) * (varA + varB + SSIM_C2));
+            const double w = _weights[(y0 + SSIM_WINDOW/2)*width + x0 + SSIM_WINDOW/2];
+            ssimSum += ssim;
+            wssimSum += w*ssim;
+            wssimNorm += w;
+        }
+    }
+    m.ssim = ssimSum / (static_cast<double>(rows)*cols);
+    m.weightedSsim = wssimSum / wssimNorm;
+    return m;
+}
@@ -0,0 +1,79 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Quality of a rendered frame compared to a reference frame.
+ *        Weighted metrics emphasize the fovea according to the eccentricity from the gaze point.
+ */
+struct QualityMetrics
+{
+    double psnr = 0.0;          // in dB, infinity for identical images
+    double ssim = 0.0;          // mean SSIM of the luminance
+    double weightedPsnr = 0.0;  // eccentricity weighted PSNR in dB
+    double weightedSsim = 0.0;  // eccentricity weighted mean SSIM
+};
+
+/**
+ * @brief CPU image quality metrics for comparing foveated frames to full resolution ground truth.
+ *        Pixel weights follow the cortical magnification w(e) = e2 / (e2 + e), e being the
+ *        eccentricity in degrees of visual angle.
+ */
+class ImageQuality
+{
+public:
+    /**
+     * @param pixelsPerDegree Screen pixels per degree of visual angle at the viewing distance.
+     * @param e2 Eccentricity in degrees at which the weight has dropped to one half.
+     */
+    explicit ImageQuality(const double pixelsPerDegree = 40.0, const double e2 = 2.3);
+
+    /**
+     * @brief Compare two RGBA images with values in [0,1], alpha is ignored.
+     * @param reference Ground truth image.
+     * @param test Image to evaluate, same size as the reference.
+     * @param width Image width in pixels.
+     * @param height Image height in pixels.
+     * @param gazeX Horizontal gaze position in pixels.
+     * @param gazeY Vertical gaze position in pixels.
+     * @throws std::invalid_argument if the image sizes do not match.
+     */
+    QualityMetrics compare(const std::vector<float> &reference, const std::vector<float> &test,
+                           const size_t width, const size_t height,
+                           const float gazeX, const float gazeY) const;
+
+private:
+    void calcWeights(const size_t width, const size_t height,
+                     const float gazeX, const float gazeY) const;
+
+    double _pixelsPerDegree;
+    double _e2;
+
+    // scratch buffers, reused between frames of the same size
+    mutable std::vector<float> _weights;
+    mutable std::vector<float> _lumRef;
+    mutable std::vector<float> _lumTest;
+    mutable std::vector<double> _sat;
+};
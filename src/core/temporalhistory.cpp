@@ -0,0 +1,156 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "src/core/temporalhistory.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief TemporalHistory::setParameters
+ * @param parameters
+ */
+void TemporalHistory::setParameters(const Parameters &parameters)
+{
+    if (parameters.depth == 0)
+        throw std::invalid_argument("Temporal history depth must be at least 1.");
+    _params = parameters;
+    _lastFrames = cl::Image2DArray();   // reallocate
+    _frameId = 0;
+}
+
+/**
+ * @brief TemporalHistory::getParameters
+ * @return
+ */
+const TemporalHistory::Parameters &TemporalHistory::getParameters() const
+{
+    return _params;
+}
+
+/**
+ * @brief TemporalHistory::allocate
+ * @param context
+ * @param width
+ * @param height
+ * @param outputFormat
+ */
+void TemporalHistory::allocate(const cl::Context &context, const size_t width,
+                               const size_t height, const cl::ImageFormat &outputFormat)
+{
+    cl::ImageFormat format = outputFormat;
+    if (_params.format == FORMAT_HALF)
+        format.image_channel_data_type = CL_HALF_FLOAT;
+    else if (_params.format == FORMAT_FLOAT)
+        format.image_channel_data_type = CL_FLOAT;
+
+    if (_lastFrames() && _width == width && _height == height
+            && _channelType == format.image_channel_data_type)
+        return;
+
+    _lastFrames = cl::Image2DArray(context, CL_MEM_READ_ONLY, format, getLayerCount(),
+                                   width, height, 0, 0);
+    _thisFrame = cl::Image2D(context, CL_MEM_WRITE_ONLY, format, width, height);
+    if (!_lastViews())
+        _lastViews = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float16)*getLayerCount());
+    else if (_lastViews.getInfo<CL_MEM_SIZE>() < sizeof(cl_float16)*getLayerCount())
+        _lastViews = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float16)*getLayerCount());
+    _width = width;
+    _height = height;
+    _channelType = format.image_channel_data_type;
+    _bytesPerPixel = format.image_channel_data_type == CL_FLOAT ? 16
+                   : (format.image_channel_data_type == CL_HALF_FLOAT ? 8 : 4);
+    _frameId = 0;   // temporal history is invalid
+}
+
+/**
+ * @brief TemporalHistory::reset
+ */
+void TemporalHistory::reset()
+{
+    _frameId = 0;
+}
+
+/**
+ * @brief TemporalHistory::push
+ * @param queue
+ * @param viewMat
+ * @param width
+ * @param height
+ * @param copyEvt
+ */
+void TemporalHistory::push(const cl::CommandQueue &queue, const cl_float16 &viewMat,
+                           const size_t width, const size_t height, cl::Event *copyEvt)
+{
+    const cl_uint slot = _params.mode == ACCUMULATE ? 0 : _frameId % _params.depth;
+    queue.enqueueCopyImage(_thisFrame, _lastFrames, {0,0,0}, {0,0,slot},
+                           {std::min(width, _width), std::min(height, _height), 1},
+                           nullptr, copyEvt);
+    _pushedView = viewMat;
+    queue.enqueueWriteBuffer(_lastViews, CL_FALSE, sizeof(cl_float16)*slot,
+                             sizeof(cl_float16), &_pushedView);
+    _frameId++;
+}
+
+/**
+ * @brief TemporalHistory::getFrameId
+ * @return
+ */
+cl_uint TemporalHistory::getFrameId() const
+{
+    return _frameId;
+}
+
+/**
+ * @brief TemporalHistory::getLayerCount
+ * @return
+ */
+cl_uint TemporalHistory::getLayerCount() const
+{
+    return _params.mode == ACCUMULATE ? 1u : _params.depth;
+}
+
+const cl::Image2DArray &TemporalHistory::lastFrames() const
+{
+    return _lastFrames;
+}
+
+const cl::Image2D &TemporalHistory::thisFrame() const
+{
+    return _thisFrame;
+}
+
+const cl::Buffer &TemporalHistory::lastViews() const
+{
+    return _lastViews;
+}
+
+/**
+ * @brief TemporalHistory::getMemoryUsage
+ * @return
+ */
+size_t TemporalHistory::getMemoryUsage() const
+{
+    if (!_lastFrames())
+        return 0;
+    return _width*_height*_bytesPerPixel*(getLayerCount() + 1)
+            + sizeof(cl_float16)*getLayerCount();
+}
@@ -0,0 +1,115 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "src/oclutil/openclutilities.h"
+
+/**
+ * @brief Device side temporal history of the LBG interpolation.
+ *        In ACCUMULATE mode (default), a single image holds an exponential moving average of
+ *        the previous frames, the interpolation reads one history value per pixel and writes
+ *        the blended result back. Until depth frames are accumulated, all frames are weighted
+ *        equally, afterwards a new frame has weight 1/(depth+1).
+ *        In FRAMES mode, the last depth frames are kept in an image array and averaged.
+ */
+class TemporalHistory
+{
+public:
+    enum Mode
+    {
+          ACCUMULATE = 0
+        , FRAMES
+    };
+
+    enum Format
+    {
+          FORMAT_OUTPUT = 0 // same as the output image
+        , FORMAT_HALF
+        , FORMAT_FLOAT
+    };
+
+    struct Parameters
+    {
+        Mode mode = ACCUMULATE;
+        cl_uint depth = 8;  // frames in the history, effective window in ACCUMULATE mode
+        Format format = FORMAT_OUTPUT;
+    };
+
+    /**
+     * @brief Set mode, depth and format. Invalidates the history, images are reallocated by
+     *        the next call of allocate().
+     * @throws invalid_argument if depth is 0.
+     */
+    void setParameters(const Parameters &parameters);
+    const Parameters &getParameters() const;
+
+    /**
+     * @brief Allocate the history images, reused if size and format did not change.
+     * @param outputFormat Format of the output image, used with FORMAT_OUTPUT.
+     */
+    void allocate(const cl::Context &context, const size_t width, const size_t height,
+                  const cl::ImageFormat &outputFormat);
+
+    /**
+     * @brief Forget all frames, e.g. after a camera change without reprojection.
+     */
+    void reset();
+
+    /**
+     * @brief Add the current frame (written to thisFrame() by the interpolation kernel).
+     * @param viewMat View matrix of the frame, used for reprojection.
+     * @param copyEvt Event of the copy into the history.
+     */
+    void push(const cl::CommandQueue &queue, const cl_float16 &viewMat,
+              const size_t width, const size_t height, cl::Event *copyEvt);
+
+    /**
+     * @brief Number of frames pushed since the last reset.
+     */
+    cl_uint getFrameId() const;
+
+    /**
+     * @brief Number of image layers, 1 in ACCUMULATE mode.
+     */
+    cl_uint getLayerCount() const;
+
+    const cl::Image2DArray &lastFrames() const;
+    const cl::Image2D &thisFrame() const;
+    const cl::Buffer &lastViews() const;
+
+    /**
+     * @brief Device memory of the history images and view matrices in bytes.
+     */
+    size_t getMemoryUsage() const;
+
+private:
+    Parameters _params;
+    cl::Image2DArray _lastFrames;
+    cl::Image2D _thisFrame;
+    cl::Buffer _lastViews;
+    cl_float16 _pushedView;     // host copy of the last view matrix while the write is pending
+    cl_uint _frameId = 0;
+    size_t _width = 0;
+    size_t _height = 0;
+    cl_channel_type _channelType = 0;
+    size_t _bytesPerPixel = 0;
+};
@@ -0,0 +1,204 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/tracer.h"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+const size_t BUFFER_CAPACITY = 1 << 16;     // events per thread and trace
+const uint32_t DEVICE_TID = 0xFFFF;
+
+struct TraceEvent
+{
+    const char *name;
+    const char *category;
+    int64_t start;
+    int64_t duration;
+};
+
+/**
+ * Single producer buffer: only the owning thread appends, the writer reads up to the published
+ * count. The storage is never reallocated while tracing.
+ */
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(uint32_t id) : tid(id), events(BUFFER_CAPACITY) {}
+
+    void append(const TraceEvent &e)
+    {
+        size_t n = count.load(std::memory_order_relaxed);
+        if (n >= events.size())
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events[n] = e;
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    uint32_t tid;
+    std::string name;
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count {0};
+    std::atomic<size_t> dropped {0};
+};
+
+// registry of all thread buffers, only locked on thread registration and on write
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+std::shared_ptr<ThreadBuffer> deviceBuffer;
+std::string traceFileName;
+const auto epoch = std::chrono::steady_clock::now();
+
+ThreadBuffer &localBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer = std::make_shared<ThreadBuffer>(static_cast<uint32_t>(registry.size() + 1));
+        buffer->name = "thread " + std::to_string(buffer->tid);
+        registry.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void writeEscaped(std::ostream &out, const std::string &s)
+{
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+}
+}   // namespace
+
+std::atomic<bool> Tracer::_enabled(false);
+
+/**
+ * @brief Tracer::start
+ * @param fileName
+ */
+void Tracer::start(const std::string &fileName)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    _enabled.store(false);
+    for (auto &b : registry)
+    {
+        b->count.store(0);
+        b->dropped.store(0);
+    }
+    if (!deviceBuffer)
+    {
+        deviceBuffer = std::make_shared<ThreadBuffer>(DEVICE_TID);
+        deviceBuffer->name = "OpenCL device";
+    }
+    deviceBuffer->count.store(0);
+    traceFileName = fileName;
+    _enabled.store(true);
+}
+
+/**
+ * @brief Tracer::stop
+ * @return
+ */
+bool Tracer::stop()
+{
+    _enabled.store(false);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::ofstream out(traceFileName);
+    if (!out.is_open())
+    {
+        std::cerr << "Could not open trace file " << traceFileName << std::endl;
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers = registry;
+    if (deviceBuffer)
+        buffers.push_back(deviceBuffer);
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    size_t dropped = 0;
+    for (auto &b : buffers)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << b->tid << ",\"args\":{\"name\":\"";
+        writeEscaped(out, b->name);
+        out << "\"}}";
+        first = false;
+
+        const size_t n = b->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const TraceEvent &e = b->events[i];
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, e.name);
+            out << "\",\"cat\":\"";
+            writeEscaped(out, e.category);
+            out << "\",\"ph\":\"X\",\"ts\":" << e.start << ",\"dur\":" << e.duration
+                << ",\"pid\":1,\"tid\":" << b->tid << "}";
+        }
+        dropped += b->dropped.load();
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    if (dropped > 0)
+        std::cerr << "Trace buffers were full, " << dropped << " events have been dropped."
+                  << std::endl;
+    std::cout << "Wrote trace to " << traceFileName << std::endl;
+    return true;
+}
+
+void Tracer::setThreadName(const std::string &name)
+{
+    ThreadBuffer &b = localBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    b.name = name;
+}
+
+int64_t Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::addEvent(const char *name, const char *category, int64_t start, int64_t duration)
+{
+    if (!isEnabled())
+        return;
+    localBuffer().append({name, category, start, duration});
+}
+
+void Tracer::addDeviceEvent(const char *name, int64_t start, int64_t duration)
+{
+    // device events are only added from the render thread
+    if (!isEnabled() || !deviceBuffer)
+        return;
+    deviceBuffer->append({name, "device", start, duration});
+}
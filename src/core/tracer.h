@@ -0,0 +1,110 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Lightweight scoped event tracer writing Chrome trace JSON files
+ *        (chrome://tracing, ui.perfetto.dev).
+ *        Every thread records into its own preallocated buffer, recording an event takes no
+ *        lock. Events are dropped if tracing is disabled or a thread buffer is full.
+ */
+class Tracer
+{
+public:
+    /**
+     * @brief Start recording. Events recorded before are discarded.
+     * @param fileName Trace file written by stop().
+     */
+    static void start(const std::string &fileName);
+
+    /**
+     * @brief Stop recording and write all recorded events to the trace file.
+     * @return false if the file could not be written.
+     */
+    static bool stop();
+
+    /**
+     * @brief Check if events are currently recorded.
+     */
+    static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Set the name the calling thread is shown with in the trace.
+     */
+    static void setThreadName(const std::string &name);
+
+    /**
+     * @brief Current time on the trace clock in microseconds.
+     */
+    static int64_t now();
+
+    /**
+     * @brief Record a complete event of the calling thread.
+     * @param name Static string, the pointer is stored.
+     * @param category Static string, the pointer is stored.
+     * @param start Start time in microseconds on the trace clock.
+     * @param duration Duration in microseconds.
+     */
+    static void addEvent(const char *name, const char *category, int64_t start, int64_t duration);
+
+    /**
+     * @brief Record a device event (e.g. an OpenCL command) on the device track.
+     *        Times are in microseconds on the trace clock.
+     */
+    static void addDeviceEvent(const char *name, int64_t start, int64_t duration);
+
+private:
+    static std::atomic<bool> _enabled;
+};
+
+/**
+ * @brief Records a complete event spanning the lifetime of the object.
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, const char *category = "host")
+        : _name(name), _category(category), _start(Tracer::isEnabled() ? Tracer::now() : -1) {}
+
+    ~TraceScope()
+    {
+        if (_start >= 0)
+            Tracer::addEvent(_name, _category, _start, Tracer::now() - _start);
+    }
+
+private:
+    const char *_name;
+    const char *_category;
+    int64_t _start;
+};
+
+#define TRACE_CONCAT_(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+/**
+ * @brief Trace the enclosing scope, name and category have to be string literals.
+ */
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
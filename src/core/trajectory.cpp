@@ -0,0 +1,281 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/core/trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <QFile>
+
+static const double PI = 3.14159265358979323846;
+
+/**
+ * @brief readInteractionFrames
+ * @param fileName
+ * @return
+ */
+QStringList readInteractionFrames(const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly | QFile::Text))
+        throw std::invalid_argument("Invalid file name for interaction log: " + fileName.toStdString());
+
+    QStringList frames;
+    QString lastStamp;
+    QTextStream sequence(&f);
+    QString line;
+    while (sequence.readLineInto(&line))
+    {
+        if (line.trimmed().isEmpty())
+            continue;
+        const QString stamp = line.section(';', 0, 0);
+        if (!frames.empty() && stamp == lastStamp)
+            frames.last() += "\n" + line;
+        else
+            frames.append(line);
+        lastStamp = stamp;
+    }
+    return frames;
+}
+
+/**
+ * @brief TrajectoryGenerator::TrajectoryGenerator
+ * @param seed
+ * @param params
+ */
+TrajectoryGenerator::TrajectoryGenerator(const quint64 seed, const Parameters &params)
+    : _params(params)
+    , _prng(seed)
+    , _state(FIXATION)
+    , _remaining(0.0)
+    , _duration(0.0)
+    , _gaze{0.0, 0.0}
+    , _anchor{0.0, 0.0}
+    , _target{0.0, 0.0}
+    , _velocity{0.0, 0.0}
+    , _drift{0.0, 0.0}
+{
+}
+
+double TrajectoryGenerator::uniform()
+{
+    return _prng.generateDouble();
+}
+
+/**
+ * @brief Standard normal distributed value (Box-Muller).
+ */
+double TrajectoryGenerator::normal()
+{
+    const double u = std::max(uniform(), 1e-12);
+    return std::sqrt(-2.0*std::log(u)) * std::cos(2.0*PI*uniform());
+}
+
+/**
+ * @brief Keep the gaze on the display area.
+ */
+void TrajectoryGenerator::clampGaze()
+{
+    const double hw = 0.5*_params.displayWidth / _params.pixelsPerDegree;
+    const double hh = 0.5*_params.displayHeight / _params.pixelsPerDegree;
+    _gaze[0] = std::min(std::max(_gaze[0], -hw), hw);
+    _gaze[1] = std::min(std::max(_gaze[1], -hh), hh);
+}
+
+/**
+ * @brief Leave the current state: fixations are followed by a saccade or smooth pursuit,
+ *        saccades and pursuit end in a fixation.
+ */
+void TrajectoryGenerator::nextGazeState()
+{
+    const double hw = 0.5*_params.displayWidth / _params.pixelsPerDegree;
+    const double hh = 0.5*_params.displayHeight / _params.pixelsPerDegree;
+
+    if (_state != FIXATION)
+    {
+        // log-normal fixation duration, clamped to physiological limits
+        _state = FIXATION;
+        _remaining = std::min(std::max(_params.fixationMedian * std::exp(0.35*normal()), 80.0), 1000.0);
+        _anchor[0] = _gaze[0];
+        _anchor[1] = _gaze[1];
+        _drift[0] = _drift[1] = 0.0;
+        return;
+    }
+
+    if (uniform() < _params.pursuitProbability)
+    {
+        // pursuit of a target moving with 5-25 deg/s
+        _state = PURSUIT;
+        _remaining = 300.0 + 900.0*uniform();
+        const double speed = (5.0 + 20.0*uniform()) * 1e-3;
+        const double dir = 2.0*PI*uniform();
+        _velocity[0] = speed*std::cos(dir);
+        _velocity[1] = speed*std::sin(dir);
+        return;
+    }
+
+    // gamma(2) distributed amplitude, retry directions that leave the display
+    _state = SACCADE;
+    const double amplitude = std::min(std::max(-0.5*_params.saccadeAmplitude
+                                               * std::log(std::max(uniform()*uniform(), 1e-12)),
+                                               0.5), 40.0);
+    for (int i = 0; i < 10; ++i)
+    {
+        const double dir = 2.0*PI*uniform();
+        _target[0] = _gaze[0] + amplitude*std::cos(dir);
+        _target[1] = _gaze[1] + amplitude*std::sin(dir);
+        if (std::abs(_target[0]) <= hw && std::abs(_target[1]) <= hh)
+            break;
+    }
+    _target[0] = std::min(std::max(_target[0], -hw), hw);
+    _target[1] = std::min(std::max(_target[1], -hh), hh);
+    _anchor[0] = _gaze[0];
+    _anchor[1] = _gaze[1];
+    // main sequence: duration grows linearly with the amplitude
+    _duration = 21.0 + 2.2*std::hypot(_target[0] - _anchor[0], _target[1] - _anchor[1]);
+    _remaining = _duration;
+}
+
+/**
+ * @brief Advance the gaze by dt milliseconds.
+ */
+void TrajectoryGenerator::stepGaze(const double dt)
+{
+    _remaining -= dt;
+    switch (_state)
+    {
+    case FIXATION:
+    {
+        // drift as a mean reverting random walk with a few arc minutes amplitude
+        const double sigma = 0.03 * std::sqrt(dt / 16.0);
+        for (int i = 0; i < 2; ++i)
+        {
+            _drift[i] += -0.05*_drift[i] + sigma*normal();
+            _gaze[i] = _anchor[i] + _drift[i];
+        }
+        break;
+    }
+    case SACCADE:
+    {
+        // minimum jerk position profile
+        const double t = std::min(std::max(1.0 - _remaining / _duration, 0.0), 1.0);
+        const double s = t*t*t*(10.0 - 15.0*t + 6.0*t*t);
+        for (int i = 0; i < 2; ++i)
+            _gaze[i] = _anchor[i] + s*(_target[i] - _anchor[i]);
+        break;
+    }
+    case PURSUIT:
+    {
+        const double hw = 0.5*_params.displayWidth / _params.pixelsPerDegree;
+        const double hh = 0.5*_params.displayHeight / _params.pixelsPerDegree;
+        _gaze[0] += _velocity[0]*dt;
+        _gaze[1] += _velocity[1]*dt;
+        // bounce off the display border
+        if (std::abs(_gaze[0]) > hw)
+            _velocity[0] = -_velocity[0];
+        if (std::abs(_gaze[1]) > hh)
+            _velocity[1] = -_velocity[1];
+        break;
+    }
+    }
+    clampGaze();
+    if (_remaining <= 0.0)
+        nextGazeState();
+}
+
+/**
+ * @brief TrajectoryGenerator::generate
+ * @param frames
+ * @return
+ */
+std::vector<TrajectorySample> TrajectoryGenerator::generate(const size_t frames)
+{
+    std::vector<TrajectorySample> samples(frames);
+    const double dt = 1000.0 / _params.frameRate;
+
+    // random start: orbit direction, phases and a first fixation near the center
+    const double orbitDir = uniform() < 0.5 ? -1.0 : 1.0;
+    const double yaw0 = 360.0*uniform();
+    const double elevationPhase = 2.0*PI*uniform();
+    const double zoomPhase = 2.0*PI*uniform();
+    _state = SACCADE;
+    _gaze[0] = 2.0*normal();
+    _gaze[1] = 2.0*normal();
+    clampGaze();
+    nextGazeState();
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        TrajectorySample &s = samples[i];
+        s.time = static_cast<double>(i)*dt;
+        const double t = s.time * 1e-3;
+
+        const double yaw = yaw0 + orbitDir*_params.orbitSpeed*t;
+        const double pitch = _params.elevation
+                * std::sin(2.0*PI*t / _params.elevationPeriod + elevationPhase);
+        s.camera.setRotation(QQuaternion::fromEulerAngles(static_cast<float>(pitch),
+                                                          static_cast<float>(yaw), 0.f));
+        const double dist = _params.distance
+                + _params.zoom*std::sin(2.0*PI*t / _params.zoomPeriod + zoomPhase);
+        s.camera.setTranslation(QVector3D(0, 0, static_cast<float>(dist)));
+
+        if (i > 0)
+            stepGaze(dt);
+        s.gazeX = static_cast<float>(0.5 + _gaze[0]*_params.pixelsPerDegree / _params.displayWidth);
+        s.gazeY = static_cast<float>(0.5 + _gaze[1]*_params.pixelsPerDegree / _params.displayHeight);
+    }
+    return samples;
+}
+
+/**
+ * @brief TrajectoryGenerator::writeInteractionLog
+ * @param samples
+ * @param out
+ */
+void TrajectoryGenerator::writeInteractionLog(const std::vector<TrajectorySample> &samples,
+                                              QTextStream &out)
+{
+    for (const TrajectorySample &s : samples)
+    {
+        const qint64 ms = qRound64(s.time);
+        out << ms << "; camera; " << s.camera.toString() << "\n";
+        out << ms << "; gaze; " << s.gazeX << " " << s.gazeY << "\n";
+    }
+    out.flush();
+}
+
+/**
+ * @brief TrajectoryGenerator::writeInteractionLog
+ * @param samples
+ * @param fileName
+ */
+void TrajectoryGenerator::writeInteractionLog(const std::vector<TrajectorySample> &samples,
+                                              const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QFile::WriteOnly | QFile::Text))
+        throw std::invalid_argument("Could not open interaction log " + fileName.toStdString());
+    QTextStream out(&f);
+    writeInteractionLog(samples, out);
+}
@@ -0,0 +1,126 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <vector>
+
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "src/core/camera.h"
+
+/**
+ * @brief One frame of a generated trajectory.
+ */
+struct TrajectorySample
+{
+    double time = 0.0;      // in milliseconds since the start
+    Camera camera;
+    float gazeX = 0.5f;     // normalized display coordinates as logged from the eye tracker
+    float gazeY = 0.5f;
+};
+
+/**
+ * @brief Read an interaction log and group all lines with the same time stamp into one frame.
+ * @return One entry per frame, lines separated by '\n'.
+ * @throws std::invalid_argument if the file can not be opened.
+ */
+QStringList readInteractionFrames(const QString &fileName);
+
+/**
+ * @brief Seeded, reproducible camera and gaze trajectories for benchmarks and replays.
+ *        The camera orbits the volume with slowly varying elevation and distance, the gaze
+ *        alternates between fixations (with drift), saccades (main sequence duration and
+ *        minimum jerk profile) and smooth pursuit. Only Qt's random engine and closed form
+ *        distributions are used, so a seed yields the same trajectory on every platform.
+ */
+class TrajectoryGenerator
+{
+public:
+    struct Parameters
+    {
+        double frameRate = 60.0;            // samples per second
+        double pixelsPerDegree = 40.0;      // display pixels per degree of visual angle
+        double displayWidth = 1920.0;       // in pixels
+        double displayHeight = 1080.0;      // in pixels
+
+        double orbitSpeed = 20.0;           // degrees per second around the vertical axis
+        double elevation = 15.0;            // amplitude of the elevation change in degrees
+        double elevationPeriod = 12.0;      // in seconds
+        double distance = 2.0;              // mean camera distance
+        double zoom = 0.5;                  // amplitude of the distance change
+        double zoomPeriod = 17.0;           // in seconds
+
+        double fixationMedian = 250.0;      // median fixation duration in ms
+        double saccadeAmplitude = 7.0;      // mean saccade amplitude in degrees
+        double pursuitProbability = 0.1;    // probability of smooth pursuit after a fixation
+    };
+
+    explicit TrajectoryGenerator(const quint64 seed, const Parameters &params = Parameters());
+
+    /**
+     * @brief Generate the given number of frames, starting at time 0.
+     */
+    std::vector<TrajectorySample> generate(const size_t frames);
+
+    /**
+     * @brief Write samples in the interaction log format, one camera and one gaze line with
+     *        the same time stamp per frame.
+     */
+    static void writeInteractionLog(const std::vector<TrajectorySample> &samples,
+                                    QTextStream &out);
+
+    /**
+     * @brief Write samples to an interaction log file.
+     * @throws std::invalid_argument if the file can not be opened.
+     */
+    static void writeInteractionLog(const std::vector<TrajectorySample> &samples,
+                                    const QString &fileName);
+
+private:
+    enum gaze_state
+    {
+        FIXATION = 0
+      , SACCADE
+      , PURSUIT
+    };
+
+    double uniform();
+    double normal();
+    void nextGazeState();
+    void stepGaze(const double dt);
+    void clampGaze();
+
+    Parameters _params;
+    QRandomGenerator64 _prng;
+
+    gaze_state _state;
+    double _remaining;          // ms left in the current state
+    double _duration;           // ms of the current saccade
+    double _gaze[2];            // current gaze in degrees relative to the display center
+    double _anchor[2];          // fixation center or saccade start
+    double _target[2];          // saccade target
+    double _velocity[2];        // pursuit velocity in degrees per ms
+    double _drift[2];           // fixational drift offset in degrees
+};
@@ -21,13 +21,17 @@
  */
 
 #include "src/core/volumerendercl.h"
+#include "src/core/tracer.h"
 
 #include <functional>
 #include <algorithm>
 #include <numeric>
+#include <cmath>
+#include <limits>
 #include <omp.h>
 
 static const size_t LOCAL_SIZE = 8;    // 8*8=64 is wavefront size or 2*warp size
+static const size_t RATE_TILE_SIZE = LOCAL_SIZE*4;  // variable rate tiles, multiple of the largest lattice step
 
 /**
  * @brief RoundPow2
@@ -52,6 +56,29 @@ static unsigned int RoundPow2(const unsigned int n)
 }
 
 
+/**
+ * @brief Convert a IEEE 754 half precision value to single precision.
+ * @param h half precision bit pattern
+ * @return single precision value
+ */
+static float halfToFloat(const cl_half h)
+{
+    const unsigned int sign = (h >> 15) & 0x1u;
+    const unsigned int exponent = (h >> 10) & 0x1fu;
+    const unsigned int mantissa = h & 0x3ffu;
+
+    float value = 0.f;
+    if (exponent == 0)          // zero or subnormal
+        value = std::ldexp(static_cast<float>(mantissa), -24);
+    else if (exponent == 31)    // inf or NaN
+        value = mantissa ? std::numeric_limits<float>::quiet_NaN()
+                         : std::numeric_limits<float>::infinity();
+    else
+        value = std::ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+    return sign ? -value : value;
+}
+
+
 /**
  * @brief VolumeRenderCL::VolumeRenderCL
  */
@@ -64,7 +91,6 @@ VolumeRenderCL::VolumeRenderCL() :
   , _modelScale{1.0, 1.0, 1.0}
   , _useGL(true)
   , _useImgESS(false)
-  , _frameId(0)
 {
 }
 
@@ -169,7 +195,12 @@ void VolumeRenderCL::initKernel(const std::string fileName, const std::string bu
 {
     try
     {
+#ifdef KERNEL_COUNTERS
+        cl::Program program = buildProgramFromSource(_contextCL, fileName,
+                                                     buildFlags + " -DCOUNTERS");
+#else
         cl::Program program = buildProgramFromSource(_contextCL, fileName, buildFlags);
+#endif
         _raycastKernel = cl::Kernel(program, "volumeRender");
         cl_float16 view = {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
         _raycastKernel.setArg(VIEW, view);
@@ -178,9 +209,8 @@ void VolumeRenderCL::initKernel(const std::string fileName, const std::string bu
         _raycastKernel.setArg(ILLUMINATION, 1);         // illumination on by default
         _raycastKernel.setArg(SHOW_ESS, 0);
         _raycastKernel.setArg(LINEAR, 1);
-        cl_float4 bgColor = {{1.f, 1.f, 1.f, 1.f}};
-        _raycastKernel.setArg(BACKGROUND, bgColor);
-        _raycastKernel.setArg(AO, 0);                   // ambient occlusion off by default
+        _raycastKernel.setArg(BACKGROUND, _background);
+        _raycastKernel.setArg(AO, static_cast<cl_uint>(_useAO));  // off by default
         _raycastKernel.setArg(CONTOURS, 0);             // contour lines off by default
         _raycastKernel.setArg(AERIAL, 0);               // aerial perspective off by defualt
         _raycastKernel.setArg(IMG_ESS, 0);
@@ -191,14 +221,36 @@ void VolumeRenderCL::initKernel(const std::string fileName, const std::string bu
 		{	// init index and sampling agruments with empty buffers / images
 			_place_holder_imap = cl::Image2D(_contextCL, CL_MEM_READ_ONLY, cl::ImageFormat(CL_RGBA, CL_UNORM_INT8), 1, 1);
 			_place_holder_smd = cl::Buffer(_contextCL, CL_MEM_READ_ONLY, 8);
+            _place_holder_vol = cl::Image3D(_contextCL, CL_MEM_READ_ONLY,
+                                            cl::ImageFormat(CL_R, CL_UNORM_INT8), 1, 1, 1);
 		}
 
 		_raycastKernel.setArg(IMAP, _place_holder_imap);
 		_raycastKernel.setArg(SDATA, _place_holder_smd);
+        _raycastKernel.setArg(TFF_PREINT, _place_holder_imap);
+        _raycastKernel.setArg(PRE_INTEGRATED, static_cast<cl_uint>(_usePreIntegration));
+        _raycastKernel.setArg(AO_VOL, _place_holder_vol);
+        _depthMem = cl::Image2D(_contextCL, CL_MEM_READ_WRITE, cl::ImageFormat(CL_R, CL_FLOAT), 1, 1);
+        _raycastKernel.setArg(DEPTH_IMG, _depthMem);
+        _raycastKernel.setArg(LAYER_VIEWPORT, cl_float4{{0.f, 0.f, 1.f, 0.f}});
+        _raycastKernel.setArg(RATE_GROUPS, _place_holder_smd);
+        _raycastKernel.setArg(RATE_COUNT, _place_holder_smd);
+#ifdef KERNEL_COUNTERS
+        std::array<cl_uint, COUNTER_COUNT> zeros;
+        zeros.fill(0);
+        _countersMem = cl::Buffer(_contextCL, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                  sizeof(cl_uint)*zeros.size(), zeros.data());
+        _raycastKernel.setArg(COUNTERS_BUF, _countersMem);
+#endif
 
         _genBricksKernel = cl::Kernel(program, "generateBricks");
         _downsamplingKernel = cl::Kernel(program, "downsampling");
 		_interpolateLBGKernel = cl::Kernel(program, "interpolateLBG");
+        _composeMultiResKernel = cl::Kernel(program, "composeMultiRes");
+        _shadingRateKernel = cl::Kernel(program, "shadingRate");
+        _fillVariableRateKernel = cl::Kernel(program, "fillVariableRate");
+        _preIntegrateKernel = cl::Kernel(program, "preIntegrateTff");
+        _genAoVolumeKernel = cl::Kernel(program, "generateAoVolume");
     }
     catch (cl::Error err)
     {
@@ -223,11 +275,22 @@ void VolumeRenderCL::setMemObjectsRaycast(const size_t t)
 		_raycastKernel.setArg(OUTPUT, _outputMemNoGL);
 
     _raycastKernel.setArg(TFF_PREFIX, _tffPrefixMem);
+    if (_tffPreIntMem())
+        _raycastKernel.setArg(TFF_PREINT, _tffPreIntMem);
+    if (_useAO)
+    {
+        if (!_aoValid || _aoTimestep != t)
+            generateAoVolume(t);
+        _raycastKernel.setArg(AO_VOL, _aoVolMem);
+    }
+    else
+        _raycastKernel.setArg(AO_VOL, _place_holder_vol);
     cl_float3 modelScale = {{_modelScale[0], _modelScale[1], _modelScale[2]}};
     _raycastKernel.setArg(MODEL_SCALE, modelScale);
 
     _raycastKernel.setArg(IN_HIT_IMG, _inputHitMem);
     _raycastKernel.setArg(OUT_HIT_IMG, _outputHitMem);
+    _raycastKernel.setArg(DEPTH_IMG, _depthMem);
 
     if (_imsmLoaded)
     {
@@ -248,25 +311,37 @@ void VolumeRenderCL::setMemObjectsInterpolationLBG(GLuint inTexId, GLuint outTex
 
         _interpolateLBGKernel.setArg(IP_INIMG, _inputMem);      // in Data
 		_interpolateLBGKernel.setArg(IP_OUTIMG, _outputMem);	// out Data
-        _interpolateLBGKernel.setArg(IP_LAST_FRAMES, _lastFramesMem); // last frames
-        _interpolateLBGKernel.setArg(IP_THIS_FRAME, _thisFrameMem);
+        _interpolateLBGKernel.setArg(IP_LAST_FRAMES, _history.lastFrames()); // last frames
+        _interpolateLBGKernel.setArg(IP_THIS_FRAME, _history.thisFrame());
 	}
     else
     {
-		throw std::runtime_error("Add interpolationLBG for NoGL Image Obejcts!");
+        _interpolateLBGKernel.setArg(IP_INIMG, _inputMemNoGL);
+        _interpolateLBGKernel.setArg(IP_OUTIMG, _outputMemNoGL);
+        _interpolateLBGKernel.setArg(IP_LAST_FRAMES, _history.lastFrames());
+        _interpolateLBGKernel.setArg(IP_THIS_FRAME, _history.thisFrame());
 	}
 
     if (_imsmLoaded)
     {
 		_interpolateLBGKernel.setArg(IP_IMAP, _indexMap);
         _interpolateLBGKernel.setArg(IP_SDSAMPLES, static_cast<uint>(_amountOfSamples));
-        _interpolateLBGKernel.setArg(IP_FRAME_ID, _frameId);
+        _interpolateLBGKernel.setArg(IP_FRAME_ID, _history.getFrameId());
         _interpolateLBGKernel.setArg(IP_SDATA, _samplingMapData);
         _interpolateLBGKernel.setArg(IP_ID, _neighborIdMap);
         _interpolateLBGKernel.setArg(IP_WEIGHT, _neighborWeightMap);
-        _interpolateLBGKernel.setArg(IP_FRAME_CNT, _frameIpCnt);
+        _interpolateLBGKernel.setArg(IP_FRAME_CNT, _history.getParameters().depth);
         _interpolateLBGKernel.setArg(IP_VIEW_CHANGED, _viewChanged);
         _interpolateLBGKernel.setArg(IP_GAZE_CHANGED, _gazeChanged);
+        _interpolateLBGKernel.setArg(IP_DEPTH, _depthMem);
+        _interpolateLBGKernel.setArg(IP_VIEW, _viewMat);
+        cl_float3 modelScale = {{_modelScale[0], _modelScale[1], _modelScale[2]}};
+        _interpolateLBGKernel.setArg(IP_MODEL_SCALE, modelScale);
+        _interpolateLBGKernel.setArg(IP_REPROJECT,
+                                     static_cast<cl_uint>(_useReprojection && !_orthoCam));
+        _interpolateLBGKernel.setArg(IP_LAST_VIEWS, _history.lastViews());
+        _interpolateLBGKernel.setArg(IP_ACCUMULATE, static_cast<cl_uint>(
+                                         _history.getParameters().mode == TemporalHistory::ACCUMULATE));
 	}
 
 }
@@ -455,6 +530,7 @@ void VolumeRenderCL::calcScaling()
  */
 void VolumeRenderCL::scaleVolume(const std::valarray<float> scale)
 {
+    ++_parameterVersion;
     _modelScale *= scale;
 }
 
@@ -476,8 +552,11 @@ void VolumeRenderCL::updateView(const std::array<float, 16> viewMat)
     } catch (cl::Error err) {
         logCLerror(err);
     }
+    _viewMat = view;
     _viewChanged = true;
-    _frameId = 0;
+    if (!_useReprojection || _orthoCam)
+        _history.reset();
+    ++_parameterVersion;
 }
 
 
@@ -487,6 +566,7 @@ void VolumeRenderCL::updateView(const std::array<float, 16> viewMat)
  */
 void VolumeRenderCL::updateSamplingRate(const double samplingRate)
 {
+    ++_parameterVersion;
     try{
         _raycastKernel.setArg(SAMPLING_RATE, static_cast<cl_float>(samplingRate));
     } catch (cl::Error err) {
@@ -513,11 +593,13 @@ void VolumeRenderCL::updateOutputTex(const GLuint texId)
  */
 void VolumeRenderCL::updateOutputImg(const size_t width, const size_t height, const GLuint texId)
 {
-    cl::ImageFormat format;
-    format.image_channel_order = CL_RGBA;
-    format.image_channel_data_type = CL_FLOAT;
+    ++_parameterVersion;
+    TRACE_SCOPE("updateOutputImg");
+    cl::ImageFormat format = getImageFormat();
+    // reuse images if neither size nor precision changed
+    const bool reuse = _history.lastFrames()() && _imgPrecision == _allocatedPrecision
+                       && _outputImgSize.at(0) == width && _outputImgSize.at(1) == height;
 
-    _output.resize(width*height*4, 0.f);
     try
     {
         if (_useGL)
@@ -525,15 +607,19 @@ void VolumeRenderCL::updateOutputImg(const size_t width, const size_t height, co
             _outputMem = cl::ImageGL(_contextCL, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, texId);
 //            _outputMemNoGL = cl::Image2D(_contextCL, CL_MEM_WRITE_ONLY, format, width, height);
         }
-        else
+        else if (!reuse)
         {
             _outputMemNoGL = cl::Image2D(_contextCL, CL_MEM_WRITE_ONLY, format, width, height);
             _raycastKernel.setArg(OUTPUT, _outputMemNoGL);
         }
 
-        _lastFramesMem = cl::Image2DArray(_contextCL, CL_MEM_READ_ONLY, format,
-                                       8, width, height, 0, 0);
-        _thisFrameMem = cl::Image2D(_contextCL, CL_MEM_WRITE_ONLY, format, width, height);
+        if (!reuse)
+        {
+            _history.allocate(_contextCL, width, height, format);
+            _outputImgSize = {{width, height}};
+            _allocatedPrecision = _imgPrecision;
+            _history.reset();   // temporal history is invalid
+        }
 
         std::vector<unsigned int> initBuff((width/LOCAL_SIZE+ 1)*(height/LOCAL_SIZE+ 1), 1u);
         format = cl::ImageFormat(CL_R, CL_UNSIGNED_INT8);
@@ -556,10 +642,12 @@ void VolumeRenderCL::updateOutputImg(const size_t width, const size_t height, co
  */
 void VolumeRenderCL::runRaycast(const size_t width, const size_t height, const size_t t)
 {
+    TRACE_SCOPE("runRaycast");
     if (!this->_volLoaded)
         return;
     try // opencl scope
     {
+        beginFrameTiming();
         setMemObjectsRaycast(t);
         cl_uint2 extend = {{static_cast<cl_uint>(width),
                             static_cast<cl_uint>(height)}};
@@ -568,14 +656,16 @@ void VolumeRenderCL::runRaycast(const size_t width, const size_t height, const s
         cl::NDRange globalThreads(width + (LOCAL_SIZE - width % LOCAL_SIZE), height
                                   + (LOCAL_SIZE - height % LOCAL_SIZE));
         cl::NDRange localThreads(LOCAL_SIZE, LOCAL_SIZE);
+        cl::Event acqEvt;
         cl::Event ndrEvt;
+        cl::Event relEvt;
 
         std::vector<cl::Memory> memObj;
         memObj.push_back(_outputMem);
-        _queueCL.enqueueAcquireGLObjects(&memObj);
+        _queueCL.enqueueAcquireGLObjects(&memObj, nullptr, &acqEvt);
         _queueCL.enqueueNDRangeKernel(
                     _raycastKernel, cl::NullRange, globalThreads, localThreads, nullptr, &ndrEvt);
-        _queueCL.enqueueReleaseGLObjects(&memObj);
+        _queueCL.enqueueReleaseGLObjects(&memObj, nullptr, &relEvt);
         _queueCL.finish();    // global sync
 
         if (_useImgESS)
@@ -586,14 +676,10 @@ void VolumeRenderCL::runRaycast(const size_t width, const size_t height, const s
             _inputHitMem = tmp;
         }
 
-#ifdef CL_QUEUE_PROFILING_ENABLE
-        cl_ulong start = 0;
-        cl_ulong end = 0;
-        ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-        ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
-        _lastExecTime = static_cast<double>(end - start)*1e-9;
-//        std::cout << "Kernel time: " << _lastExecTime << std::endl << std::endl;
-#endif
+        addTimingEvent(TIMING_ACQUIRE, acqEvt);
+        addTimingEvent(TIMING_RAYCAST, ndrEvt);
+        addTimingEvent(TIMING_RELEASE, relEvt);
+        endFrameTiming();
     }
     catch (cl::Error err)
     {
@@ -610,12 +696,14 @@ void VolumeRenderCL::runRaycast(const size_t width, const size_t height, const s
  * @param output
  */
 void VolumeRenderCL::runRaycastNoGL(const size_t width, const size_t height, const size_t t,
-                                    std::vector<float> &output)
+                                    std::vector<unsigned char> &output)
 {
+    TRACE_SCOPE("runRaycastNoGL");
     if (!this->_volLoaded)
         return;
     try // opencl scope
     {
+        beginFrameTiming();
         setMemObjectsRaycast(t);
         cl_uint2 extend = {{static_cast<cl_uint>(width),
                             static_cast<cl_uint>(height)}};
@@ -628,25 +716,19 @@ void VolumeRenderCL::runRaycastNoGL(const size_t width, const size_t height, con
 
         _queueCL.enqueueNDRangeKernel(
                     _raycastKernel, cl::NullRange, globalThreads, localThreads, nullptr, &ndrEvt);
-        output.resize(width*height*4);
-        cl::Event readEvt;
-        std::array<size_t, 3> origin = {{0, 0, 0}};
-        std::array<size_t, 3> region = {{width, height, 1}};
-        _queueCL.enqueueReadImage(_outputMemNoGL,
-                                  CL_TRUE,
-                                  origin, region, 0, 0,
-                                  output.data(),
-                                  nullptr, &readEvt);
-        _queueCL.flush();    // global sync
+        output.resize(width*height*getBytesPerPixel());
+        readOutputImg(width, height, output.data());
 
-#ifdef CL_QUEUE_PROFILING_ENABLE
-        cl_ulong start = 0;
-        cl_ulong end = 0;
-        ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-        ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
-        _lastExecTime = static_cast<double>(end - start)*1e-9;
-//        std::cout << "Kernel time: " << _lastExecTime << std::endl << std::endl;
-#endif
+        if (_useImgESS)
+        {
+            // swap hit test buffers
+            cl::Image2D tmp = _outputHitMem;
+            _outputHitMem = _inputHitMem;
+            _inputHitMem = tmp;
+        }
+
+        addTimingEvent(TIMING_RAYCAST, ndrEvt);
+        endFrameTiming();
     }
     catch (cl::Error err)
     {
@@ -654,16 +736,79 @@ void VolumeRenderCL::runRaycastNoGL(const size_t width, const size_t height, con
     }
 }
 
+
+/**
+ * @brief VolumeRenderCL::runRaycastNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastNoGL(const size_t width, const size_t height, const size_t t,
+                                    std::vector<float> &output)
+{
+    if (!this->_volLoaded)
+        return;
+    runRaycastNoGL(width, height, t, _output);
+    output.resize(width*height*4);
+    convertOutput(output);
+}
+
+
+/**
+ * @brief VolumeRenderCL::convertOutput
+ * @param output
+ */
+void VolumeRenderCL::convertOutput(std::vector<float> &output) const
+{
+    if (_imgPrecision == PRECISION_FLOAT)
+        memcpy(output.data(), _output.data(), output.size()*sizeof(float));
+    else if (_imgPrecision == PRECISION_HALF)
+    {
+        const cl_half *h = reinterpret_cast<const cl_half *>(_output.data());
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(output.size()); ++i)
+            output[static_cast<size_t>(i)] = halfToFloat(h[i]);
+    }
+    else
+    {
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(output.size()); ++i)
+            output[static_cast<size_t>(i)] = _output[static_cast<size_t>(i)] / 255.f;
+    }
+}
+
+
+/**
+ * @brief VolumeRenderCL::readOutputImg
+ * @param width
+ * @param height
+ * @param output
+ */
+void VolumeRenderCL::readOutputImg(const size_t width, const size_t height, void *output)
+{
+    TRACE_SCOPE("readOutputImg");
+    cl::Event readEvt;
+    std::array<size_t, 3> origin = {{0, 0, 0}};
+    std::array<size_t, 3> region = {{width, height, 1}};
+    _queueCL.enqueueReadImage(_outputMemNoGL, CL_TRUE, origin, region, 0, 0, output,
+                              nullptr, &readEvt);
+    addTimingEvent(TIMING_READ, readEvt);
+}
+
 void VolumeRenderCL::runRaycastLBG(const size_t width, const size_t height, const size_t t)
 {
+    TRACE_SCOPE("runRaycastLBG");
 	if (!this->_volLoaded || !this->_imsmLoaded)
 		return;
 	try // opencl scope
 	{
+        // frame timing is completed in interpolateLBG
+        beginFrameTiming();
         if (_currentTimestep != t)
         {
             _viewChanged = true;
-            _frameId = 0;
+            _history.reset();
             _currentTimestep = t;
         }
         setMemObjectsRaycast(t);
@@ -685,14 +830,16 @@ void VolumeRenderCL::runRaycastLBG(const size_t width, const size_t height, cons
         size_t wgSize = LOCAL_SIZE*LOCAL_SIZE;
         cl::NDRange globalThreads(total_threads + (wgSize - total_threads % wgSize));
         cl::NDRange localThreads(wgSize);
+		cl::Event acqEvt;
 		cl::Event ndrEvt;
+		cl::Event relEvt;
 
         std::vector<cl::Memory> memObj;
         memObj.push_back(_outputMem);
-        _queueCL.enqueueAcquireGLObjects(&memObj);
+        _queueCL.enqueueAcquireGLObjects(&memObj, nullptr, &acqEvt);
 		_queueCL.enqueueNDRangeKernel(
             _raycastKernel, cl::NullRange, globalThreads, localThreads, nullptr, &ndrEvt);
-        _queueCL.enqueueReleaseGLObjects(&memObj);
+        _queueCL.enqueueReleaseGLObjects(&memObj, nullptr, &relEvt);
         _queueCL.finish();    // global sync
 		if (_useImgESS)
 		{
@@ -702,14 +849,9 @@ void VolumeRenderCL::runRaycastLBG(const size_t width, const size_t height, cons
 			_inputHitMem = tmp;
 		}
 
-#ifdef CL_QUEUE_PROFILING_ENABLE
-		cl_ulong start = 0;
-		cl_ulong end = 0;
-		ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-		ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
-		_lastExecTime = static_cast<double>(end - start)*1e-9;
-		//        std::cout << "Kernel time: " << _lastExecTime << std::endl << std::endl;
-#endif
+        addTimingEvent(TIMING_ACQUIRE, acqEvt);
+        addTimingEvent(TIMING_RAYCAST, ndrEvt);
+        addTimingEvent(TIMING_RELEASE, relEvt);
 	}
 	catch (cl::Error err)
 	{
@@ -717,14 +859,121 @@ void VolumeRenderCL::runRaycastLBG(const size_t width, const size_t height, cons
 	}
 }
 
-void VolumeRenderCL::runRaycastLBGNoGL(const size_t width, const size_t height, const size_t t, std::vector<float>& output)
+/**
+ * @brief VolumeRenderCL::runRaycastLBGNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastLBGNoGL(const size_t width, const size_t height, const size_t t,
+                                       std::vector<unsigned char> &output)
 {
+    TRACE_SCOPE("runRaycastLBGNoGL");
+    if (!this->_volLoaded || !this->_imsmLoaded)
+        return;
+    try // opencl scope
+    {
+        beginFrameTiming();
+        if (_currentTimestep != t)
+        {
+            _viewChanged = true;
+            _history.reset();
+            _currentTimestep = t;
+        }
+
+        // sparse raycast target has the extent of the index map, allocate only on change
+        const size_t idxWidth = static_cast<size_t>(_indexMapExtends.x());
+        const size_t idxHeight = static_cast<size_t>(_indexMapExtends.y());
+        if (!_inputMemNoGL()
+                || _inputMemNoGL.getImageInfo<CL_IMAGE_WIDTH>() != idxWidth
+                || _inputMemNoGL.getImageInfo<CL_IMAGE_HEIGHT>() != idxHeight
+                || _inputMemNoGL.getImageInfo<CL_IMAGE_FORMAT>().image_channel_data_type
+                        != getImageFormat().image_channel_data_type)
+        {
+            _inputMemNoGL = cl::Image2D(_contextCL, CL_MEM_READ_WRITE, getImageFormat(),
+                                        idxWidth, idxHeight);
+        }
+
+        // sparse raycast
+        setMemObjectsRaycast(t);
+        _raycastKernel.setArg(OUTPUT, _inputMemNoGL);
+        cl_uint2 extend = {{static_cast<cl_uint>(width),
+                            static_cast<cl_uint>(height)}};
+        _raycastKernel.setArg(IMAP, extend);
+        _raycastKernel.setArg(SDSAMPLES, static_cast<cl_uint>(_amountOfSamples));
+
+        size_t wgSize = LOCAL_SIZE*LOCAL_SIZE;
+        cl::NDRange globalThreads(_amountOfSamples + (wgSize - _amountOfSamples % wgSize));
+        cl::NDRange localThreads(wgSize);
+        cl::Event ndrEvt;
+        _queueCL.enqueueNDRangeKernel(
+            _raycastKernel, cl::NullRange, globalThreads, localThreads, nullptr, &ndrEvt);
+        _raycastKernel.setArg(OUTPUT, _outputMemNoGL);
+
+        // natural neighbor interpolation and temporal blending
+        setMemObjectsInterpolationLBG(0, 0);
+        // restrict to the part of the output that is covered by the index map
+        size_t ipWidth = std::min(width, idxWidth / 2);
+        size_t ipHeight = std::min(height, idxHeight / 2);
+        size_t w = ipWidth + ((ipWidth % LOCAL_SIZE) > 0 ? LOCAL_SIZE - ipWidth % LOCAL_SIZE : 0);
+        size_t h = ipHeight + ((ipHeight % LOCAL_SIZE) > 0 ? LOCAL_SIZE - ipHeight % LOCAL_SIZE : 0);
+        if (ipWidth < width || ipHeight < height)
+        {
+            // the rest of the read back image shows the background instead of stale pixels
+            cl::Event fillEvt;
+            std::array<size_t, 3> origin = {{0, 0, 0}};
+            std::array<size_t, 3> region = {{width, height, 1}};
+            _queueCL.enqueueFillImage(_outputMemNoGL, _background, origin, region,
+                                      nullptr, &fillEvt);
+            addTimingEvent(TIMING_INTERPOLATE, fillEvt);
+        }
+        cl::Event ipEvt;
+        _queueCL.enqueueNDRangeKernel(_interpolateLBGKernel, cl::NullRange, cl::NDRange(w, h),
+                                      cl::NDRange(LOCAL_SIZE, LOCAL_SIZE), nullptr, &ipEvt);
+        addTimingEvent(TIMING_RAYCAST, ndrEvt);
+        addTimingEvent(TIMING_INTERPOLATE, ipEvt);
+        if (storeHistoryFrame())
+        {
+            cl::Event copyEvt;
+            _history.push(_queueCL, _viewMat, ipWidth, ipHeight, &copyEvt);
+            addTimingEvent(TIMING_COPY, copyEvt);
+        }
+
+        // read back
+        output.resize(width*height*getBytesPerPixel());
+        readOutputImg(width, height, output.data());
+        endFrameTiming();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+    _viewChanged = false;
+    _gazeChanged = false;
+}
 
+/**
+ * @brief VolumeRenderCL::runRaycastLBGNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastLBGNoGL(const size_t width, const size_t height, const size_t t,
+                                       std::vector<float> &output)
+{
+    if (!this->_volLoaded || !this->_imsmLoaded)
+        return;
+    runRaycastLBGNoGL(width, height, t, _output);
+    output.resize(width*height*4);
+    convertOutput(output);
 }
 
 void VolumeRenderCL::interpolateLBG(const size_t width, const size_t height,
                                     GLuint inTexId, GLuint outTexId)
 {
+    TRACE_SCOPE("interpolateLBG");
 	if (!this->_volLoaded || !this->_imsmLoaded)
 		return;
 	try // opencl scope
@@ -740,33 +989,31 @@ void VolumeRenderCL::interpolateLBG(const size_t width, const size_t height,
 
         cl::NDRange globalThreads(w, h);
         cl::NDRange localThreads(LOCAL_SIZE, LOCAL_SIZE);
+		cl::Event acqEvt;
 		cl::Event ndrEvt;
+		cl::Event relEvt;
 
 		std::vector<cl::Memory> memObj;
 		memObj.push_back(_outputMem);
         memObj.push_back(_inputMem);
-		_queueCL.enqueueAcquireGLObjects(&memObj);
+		_queueCL.enqueueAcquireGLObjects(&memObj, nullptr, &acqEvt);
 		_queueCL.enqueueNDRangeKernel(
             _interpolateLBGKernel, cl::NullRange, globalThreads, localThreads, nullptr, &ndrEvt);
+        addTimingEvent(TIMING_ACQUIRE, acqEvt);
+        addTimingEvent(TIMING_INTERPOLATE, ndrEvt);
 
-        if (!_viewChanged && _gazeChanged)
+        if (storeHistoryFrame())
         {
-//            std::cout << "change " << _frameId << std::endl;
-            _queueCL.enqueueCopyImage(_thisFrameMem, _lastFramesMem, {0,0,0}, {0,0,_frameId % _frameIpCnt},
-                                     {width, height, 1});
-            _frameId++;
+            cl::Event copyEvt;
+            _history.push(_queueCL, _viewMat, width, height, &copyEvt);
+            addTimingEvent(TIMING_COPY, copyEvt);
         }
-        _queueCL.enqueueReleaseGLObjects(&memObj);
+        _queueCL.enqueueReleaseGLObjects(&memObj, nullptr, &relEvt);
         _queueCL.finish();    // global sync
 
-#ifdef CL_QUEUE_PROFILING_ENABLE
-		cl_ulong start = 0;
-		cl_ulong end = 0;
-		ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-		ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
-        _lastExecTime = static_cast<double>(end - start)*1e-9;  // ns -> sec
-		//        std::cout << "Kernel time: " << _lastExecTime << std::endl << std::endl;
-#endif
+        addTimingEvent(TIMING_RELEASE, relEvt);
+        // completes the frame started in runRaycastLBG
+        endFrameTiming();
 	}
 	catch (cl::Error err)
 	{
@@ -778,140 +1025,767 @@ void VolumeRenderCL::interpolateLBG(const size_t width, const size_t height,
 
 
 /**
- * @brief VolumeRenderCL::generateBricks
- * @param volumeData
+ * @brief VolumeRenderCL::enqueueRefinementTiles
+ * @param width
+ * @param height
+ * @param t
+ * @return
  */
-void VolumeRenderCL::generateBricks()
+bool VolumeRenderCL::enqueueRefinementTiles(const size_t width, const size_t height, const size_t t)
 {
-    if (!_dr.has_data())
-        return;
-    try
+    const size_t tileSize = LOCAL_SIZE*8;
+    if (_refineVersion != _parameterVersion || _refineTimestep != t
+            || _refineSize.at(0) != width || _refineSize.at(1) != height)
     {
-        // calculate brick size
-        const unsigned int numBricks = 64u;
-        std::array<unsigned int, 3> brickRes = {1u, 1u, 1u};
-        brickRes.at(0) = std::max(1u, RoundPow2(_dr.properties().volume_res.at(0)/numBricks));
-        brickRes.at(1) = std::max(1u, RoundPow2(_dr.properties().volume_res.at(1)/numBricks));
-        brickRes.at(2) = std::max(1u, RoundPow2(_dr.properties().volume_res.at(2)/numBricks));
-//std::cout << brickRes.at(2) << std::endl;
-        std::array<unsigned int, 3> bricksTexSize = {1u, 1u, 1u};
-        bricksTexSize.at(0) = static_cast<unsigned int>(ceil(_dr.properties().volume_res.at(0) /
-                                                             static_cast<double>(brickRes.at(0))));
-        bricksTexSize.at(1) = static_cast<unsigned int>(ceil(_dr.properties().volume_res.at(1) /
-                                                             static_cast<double>(brickRes.at(1))));
-        bricksTexSize.at(2) = static_cast<unsigned int>(ceil(_dr.properties().volume_res.at(2) /
-                                                             static_cast<double>(brickRes.at(2))));
-//std::cout << bricksTexSize.at(2) << std::endl;
-        // set memory object
-        cl::ImageFormat format;
-        format.image_channel_order = CL_RG;  // NOTE: CL_RG for min+max
-
-        if (_dr.properties().format == "UCHAR")
-            format.image_channel_data_type = CL_UNORM_INT8;
-        else if (_dr.properties().format == "USHORT")
-            format.image_channel_data_type = CL_UNORM_INT16;
-        else if (_dr.properties().format == "FLOAT")
-            format.image_channel_data_type = CL_FLOAT;
-        else
-            throw std::invalid_argument("Unknown or invalid volume data format.");
-
-        _bricksMem.clear();
-        for (size_t i = 0; i < _dr.properties().raw_file_names.size(); ++i)
-        {
-            _bricksMem.push_back(cl::Image3D(_contextCL,
-                                             CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS,
-                                             format,
-                                             bricksTexSize.at(0),
-                                             bricksTexSize.at(1),
-                                             bricksTexSize.at(2)));
-            // run aggregation kernel
-            setMemObjectsBrickGen(i);
-            size_t lDim = 4;    // local work group dimension: 4*4*4=64
-            cl::NDRange globalThreads(bricksTexSize.at(0) + (lDim - bricksTexSize.at(0) % lDim),
-                                      bricksTexSize.at(1) + (lDim - bricksTexSize.at(1) % lDim),
-                                      bricksTexSize.at(2) + (lDim - bricksTexSize.at(2) % lDim));
-            cl::NDRange localThreads(lDim, lDim, lDim);
-//            cl::Event ndrEvt;
-            _queueCL.enqueueNDRangeKernel(_genBricksKernel, cl::NullRange, globalThreads,
-                                          localThreads); //, NULL, &ndrEvt);
-            _queueCL.finish();
-//            cl_ulong start = 0;
-//            cl_ulong end = 0;
-//            ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-//            ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
-//            double execTime = static_cast<double>(end - start)*1e-9;
-//            std::cout << "Build up time: " << execTime << std::endl;
-        }
+        // new still image: order the tiles by distance to the gaze point
+        _refineTiles.clear();
+        for (size_t y = 0; y < height; y += tileSize)
+            for (size_t x = 0; x < width; x += tileSize)
+                _refineTiles.push_back({{x, y}});
+        const double gx = _gazePoint.x * width;
+        const double gy = _gazePoint.y * height;
+        const double half = tileSize * 0.5;
+        std::stable_sort(_refineTiles.begin(), _refineTiles.end(),
+                         [&](const std::array<size_t, 2> &a, const std::array<size_t, 2> &b) {
+            const double da = std::pow(a[0] + half - gx, 2) + std::pow(a[1] + half - gy, 2);
+            const double db = std::pow(b[0] + half - gx, 2) + std::pow(b[1] + half - gy, 2);
+            return da < db;
+        });
+        _refineNext = 0;
+        _refineVersion = _parameterVersion;
+        _refineTimestep = t;
+        _refineSize = {{width, height}};
     }
-    catch (cl::Error err)
+    if (_refineNext >= _refineTiles.size())
+        return true;
+
+    // Standard mode rays for the full resolution image, image order ESS is not valid for tiles
+    cl_uint2 extend = {{static_cast<cl_uint>(width), static_cast<cl_uint>(height)}};
+    _raycastKernel.setArg(IMAP, extend);
+    _raycastKernel.setArg(RMODE, 0u);
+    _raycastKernel.setArg(IMG_ESS, 0u);
+    const size_t count = (_refineTiles.size() + _refinePasses - 1) / _refinePasses;
+    const size_t end = std::min(_refineTiles.size(), _refineNext + count);
+    for (; _refineNext < end; ++_refineNext)
     {
-        throw std::runtime_error( "ERROR: " + std::string(err.what()) + "("
-                                  + getCLErrorString(err.err()) + ")");
+        const std::array<size_t, 2> &tile = _refineTiles.at(_refineNext);
+        cl::Event ndrEvt;
+        _queueCL.enqueueNDRangeKernel(_raycastKernel, cl::NDRange(tile[0], tile[1]),
+                                      cl::NDRange(tileSize, tileSize),
+                                      cl::NDRange(LOCAL_SIZE, LOCAL_SIZE), nullptr, &ndrEvt);
+        addTimingEvent(TIMING_RAYCAST, ndrEvt);
     }
+    _raycastKernel.setArg(RMODE, _renderingMode);
+    _raycastKernel.setArg(IMG_ESS, static_cast<cl_uint>(_useImgESS));
+    return _refineNext >= _refineTiles.size();
 }
 
 /**
- * @brief VolumeRenderCL::volDataToCLmem
- * @param volumeData
+ * @brief VolumeRenderCL::refineLBG
+ * @param width
+ * @param height
+ * @param t
+ * @param outTexId
+ * @return
  */
-void VolumeRenderCL::volDataToCLmem(const std::vector<std::vector<char>> &volumeData)
+bool VolumeRenderCL::refineLBG(const size_t width, const size_t height, const size_t t,
+                               GLuint outTexId)
 {
-    if (!_dr.has_data())
-        return;
-    try
+    TRACE_SCOPE("refineLBG");
+    if (!this->_volLoaded)
+        return true;
+    bool complete = true;
+    try // opencl scope
     {
-        cl::ImageFormat format;
-        format.image_channel_order = CL_R;
-        unsigned int formatMultiplier = 1;
-
-        if (_dr.properties().format == "UCHAR")
-            format.image_channel_data_type = CL_UNORM_INT8;
-        else if (_dr.properties().format == "USHORT")
-        {
-            format.image_channel_data_type = CL_UNORM_INT16;
-            formatMultiplier = 2;
-        }
-        else if (_dr.properties().format == "FLOAT")
-        {
-            format.image_channel_data_type = CL_FLOAT;
-            formatMultiplier = 4;
-        }
-        else
-            throw std::invalid_argument("Unknown or invalid volume data format.");
+        beginFrameTiming();
+        updateOutputTex(outTexId);
+        setMemObjectsRaycast(t);
+        cl::Event acqEvt;
+        cl::Event relEvt;
+        std::vector<cl::Memory> memObj;
+        memObj.push_back(_outputMem);
+        _queueCL.enqueueAcquireGLObjects(&memObj, nullptr, &acqEvt);
+        complete = enqueueRefinementTiles(width, height, t);
+        _queueCL.enqueueReleaseGLObjects(&memObj, nullptr, &relEvt);
+        _queueCL.finish();    // global sync
 
-        _volumesMem.clear();
-        for (const auto &v : volumeData)
-        {
-            if(_dr.properties().volume_res[0]*_dr.properties().volume_res[1]*
-                     _dr.properties().volume_res[2]*formatMultiplier > v.size())
-            {
-                _dr.clearData();
-                throw std::runtime_error("Volume size does not match size specified in dat file.");
-            }
-            _volumesMem.push_back(cl::Image3D(_contextCL,
-                                              CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                              format,
-                                              _dr.properties().volume_res[0],
-                                              _dr.properties().volume_res[1],
-                                              _dr.properties().volume_res[2],
-                                              0, 0,
-                                              const_cast<char*>(v.data())));
-        }
+        addTimingEvent(TIMING_ACQUIRE, acqEvt);
+        addTimingEvent(TIMING_RELEASE, relEvt);
+        endFrameTiming();
     }
     catch (cl::Error err)
     {
-        throw std::runtime_error( "ERROR: " + std::string(err.what()) + "("
-                                  + getCLErrorString(err.err()) + ")");
+        logCLerror(err);
     }
+    return complete;
 }
 
 /**
- * @brief VolumeRenderCL::loadVolumeData
- * @param fileName
- */
-size_t VolumeRenderCL::loadVolumeData(const std::string fileName)
-{
-    this->_volLoaded = false;
+ * @brief VolumeRenderCL::refineLBGNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ * @return
+ */
+bool VolumeRenderCL::refineLBGNoGL(const size_t width, const size_t height, const size_t t,
+                                   std::vector<unsigned char> &output)
+{
+    TRACE_SCOPE("refineLBGNoGL");
+    if (!this->_volLoaded)
+        return true;
+    bool complete = true;
+    try // opencl scope
+    {
+        beginFrameTiming();
+        setMemObjectsRaycast(t);
+        complete = enqueueRefinementTiles(width, height, t);
+        output.resize(width*height*getBytesPerPixel());
+        readOutputImg(width, height, output.data());
+        endFrameTiming();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+    return complete;
+}
+
+/**
+ * @brief VolumeRenderCL::setRefinementPasses
+ * @param passes
+ */
+void VolumeRenderCL::setRefinementPasses(const unsigned int passes)
+{
+    _refinePasses = std::max(passes, 1u);
+}
+
+/**
+ * @brief VolumeRenderCL::getRefinementPasses
+ * @return
+ */
+unsigned int VolumeRenderCL::getRefinementPasses() const
+{
+    return _refinePasses;
+}
+
+/**
+ * @brief VolumeRenderCL::getRefinementProgress
+ * @return
+ */
+float VolumeRenderCL::getRefinementProgress() const
+{
+    if (_refineTiles.empty() || _refineVersion != _parameterVersion)
+        return 0.f;
+    return static_cast<float>(_refineNext) / static_cast<float>(_refineTiles.size());
+}
+
+
+/**
+ * @brief VolumeRenderCL::enqueueMultiRes
+ * @param width
+ * @param height
+ * @param output
+ */
+void VolumeRenderCL::enqueueMultiRes(const size_t width, const size_t height,
+                                     const cl::Image &output)
+{
+    const size_t layers = _multiRes.layers;
+    const float foveaRadius = _multiRes.foveaRadius * std::max(width, height);
+    const float gx = _gazePoint.s[0] * width;
+    const float gy = _gazePoint.s[1] * height;
+    const cl::ImageFormat format = getImageFormat();
+    // layer rays run in full resolution image coordinates, image order ESS is not valid for layers
+    cl_uint2 extend = {{static_cast<cl_uint>(width), static_cast<cl_uint>(height)}};
+    _raycastKernel.setArg(IMAP, extend);
+    _raycastKernel.setArg(RMODE, 2u);
+    _raycastKernel.setArg(IMG_ESS, 0u);
+
+    std::array<cl_float4, 3> viewports;
+    size_t pixelSize = 1;
+    float radius = foveaRadius;
+    _multiResRays = 0;
+    for (size_t i = 0; i < layers; ++i)
+    {
+        // the periphery covers the whole image, the other layers a square around the gaze point
+        const bool periphery = i + 1 == layers;
+        const size_t extentX = periphery ? width : std::min(width, static_cast<size_t>(std::ceil(2.f*radius)));
+        const size_t extentY = periphery ? height : std::min(height, static_cast<size_t>(std::ceil(2.f*radius)));
+        const size_t layerWidth = (extentX + pixelSize - 1) / pixelSize;
+        const size_t layerHeight = (extentY + pixelSize - 1) / pixelSize;
+        // shift layers inwards at the image border, the disc around the gaze stays covered
+        const float maxX = std::max(0.f, static_cast<float>(width) - layerWidth*pixelSize);
+        const float maxY = std::max(0.f, static_cast<float>(height) - layerHeight*pixelSize);
+        const float originX = periphery ? 0.f
+                                        : std::min(maxX, std::max(0.f, gx - layerWidth*pixelSize*0.5f));
+        const float originY = periphery ? 0.f
+                                        : std::min(maxY, std::max(0.f, gy - layerHeight*pixelSize*0.5f));
+
+        cl::Image2D &layer = _multiResLayers.at(i);
+        if (!layer()
+                || layer.getImageInfo<CL_IMAGE_WIDTH>() != layerWidth
+                || layer.getImageInfo<CL_IMAGE_HEIGHT>() != layerHeight
+                || layer.getImageInfo<CL_IMAGE_FORMAT>().image_channel_data_type
+                        != format.image_channel_data_type)
+        {
+            layer = cl::Image2D(_contextCL, CL_MEM_READ_WRITE, format, layerWidth, layerHeight);
+        }
+
+        // step size grows towards the periphery as for LBG sampling
+        const float stepFactor = 0.5f * static_cast<float>(i) / static_cast<float>(layers - 1);
+        _raycastKernel.setArg(OUTPUT, layer);
+        _raycastKernel.setArg(LAYER_VIEWPORT, cl_float4{{originX, originY,
+                                                         static_cast<float>(pixelSize), stepFactor}});
+        cl::NDRange globalThreads(layerWidth + (LOCAL_SIZE - layerWidth % LOCAL_SIZE),
+                                  layerHeight + (LOCAL_SIZE - layerHeight % LOCAL_SIZE));
+        cl::Event ndrEvt;
+        _queueCL.enqueueNDRangeKernel(_raycastKernel, cl::NullRange, globalThreads,
+                                      cl::NDRange(LOCAL_SIZE, LOCAL_SIZE), nullptr, &ndrEvt);
+        addTimingEvent(TIMING_RAYCAST, ndrEvt);
+
+        const cl_float4 viewport = {{originX, originY, static_cast<float>(pixelSize),
+                                     periphery ? 0.f : radius}};
+        viewports.at(i) = viewport;
+        _multiResRays += layerWidth * layerHeight;
+        pixelSize *= _multiRes.scale;
+        radius *= _multiRes.scale;
+    }
+    _raycastKernel.setArg(OUTPUT, output);
+    _raycastKernel.setArg(RMODE, _renderingMode >= 2u ? 0u : _renderingMode);
+    _raycastKernel.setArg(IMG_ESS, static_cast<cl_uint>(_useImgESS));
+
+    // upsample and blend the layers, a missing middle layer is replaced by the periphery
+    const size_t middle = layers > 2 ? 1 : layers - 1;
+    _composeMultiResKernel.setArg(MR_FOVEA, _multiResLayers.at(0));
+    _composeMultiResKernel.setArg(MR_MIDDLE, _multiResLayers.at(middle));
+    _composeMultiResKernel.setArg(MR_PERIPHERY, _multiResLayers.at(layers - 1));
+    _composeMultiResKernel.setArg(MR_OUTIMG, output);
+    _composeMultiResKernel.setArg(MR_FOVEA_VIEWPORT, viewports.at(0));
+    _composeMultiResKernel.setArg(MR_MIDDLE_VIEWPORT, viewports.at(middle));
+    _composeMultiResKernel.setArg(MR_PERIPHERY_VIEWPORT, viewports.at(layers - 1));
+    _composeMultiResKernel.setArg(MR_GPOINT, cl_float2{{gx, gy}});
+    _composeMultiResKernel.setArg(MR_LAYERS, static_cast<cl_uint>(layers));
+    _composeMultiResKernel.setArg(MR_BLEND, _multiRes.blend * foveaRadius);
+    cl::NDRange globalThreads(width + (LOCAL_SIZE - width % LOCAL_SIZE),
+                              height + (LOCAL_SIZE - height % LOCAL_SIZE));
+    cl::Event composeEvt;
+    _queueCL.enqueueNDRangeKernel(_composeMultiResKernel, cl::NullRange, globalThreads,
+                                  cl::NDRange(LOCAL_SIZE, LOCAL_SIZE), nullptr, &composeEvt);
+    addTimingEvent(TIMING_INTERPOLATE, composeEvt);
+}
+
+/**
+ * @brief VolumeRenderCL::runRaycastMultiRes
+ * @param width
+ * @param height
+ * @param t
+ */
+void VolumeRenderCL::runRaycastMultiRes(const size_t width, const size_t height, const size_t t)
+{
+    TRACE_SCOPE("runRaycastMultiRes");
+    if (!this->_volLoaded)
+        return;
+    try // opencl scope
+    {
+        beginFrameTiming();
+        setMemObjectsRaycast(t);
+        cl::Event acqEvt;
+        cl::Event relEvt;
+        std::vector<cl::Memory> memObj;
+        memObj.push_back(_outputMem);
+        _queueCL.enqueueAcquireGLObjects(&memObj, nullptr, &acqEvt);
+        enqueueMultiRes(width, height, _outputMem);
+        _queueCL.enqueueReleaseGLObjects(&memObj, nullptr, &relEvt);
+        _queueCL.finish();    // global sync
+
+        addTimingEvent(TIMING_ACQUIRE, acqEvt);
+        addTimingEvent(TIMING_RELEASE, relEvt);
+        endFrameTiming();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::runRaycastMultiResNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastMultiResNoGL(const size_t width, const size_t height,
+                                            const size_t t, std::vector<unsigned char> &output)
+{
+    TRACE_SCOPE("runRaycastMultiResNoGL");
+    if (!this->_volLoaded)
+        return;
+    try // opencl scope
+    {
+        beginFrameTiming();
+        setMemObjectsRaycast(t);
+        enqueueMultiRes(width, height, _outputMemNoGL);
+        output.resize(width*height*getBytesPerPixel());
+        readOutputImg(width, height, output.data());
+        endFrameTiming();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::runRaycastMultiResNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastMultiResNoGL(const size_t width, const size_t height,
+                                            const size_t t, std::vector<float> &output)
+{
+    if (!this->_volLoaded)
+        return;
+    runRaycastMultiResNoGL(width, height, t, _output);
+    output.resize(width*height*4);
+    convertOutput(output);
+}
+
+/**
+ * @brief VolumeRenderCL::setMultiResParameters
+ * @param parameters
+ */
+void VolumeRenderCL::setMultiResParameters(const MultiResParameters &parameters)
+{
+    if (parameters.layers < 2 || parameters.layers > _multiResLayers.size())
+        throw std::invalid_argument("Multi-resolution rendering needs 2 or 3 layers.");
+    if (parameters.scale < 2)
+        throw std::invalid_argument("Multi-resolution layer scale has to be at least 2.");
+    if (parameters.foveaRadius <= 0.f || parameters.foveaRadius > 1.f)
+        throw std::invalid_argument("Multi-resolution fovea radius has to be in (0,1].");
+    ++_parameterVersion;
+    _multiRes = parameters;
+}
+
+/**
+ * @brief VolumeRenderCL::getMultiResParameters
+ * @return
+ */
+const VolumeRenderCL::MultiResParameters &VolumeRenderCL::getMultiResParameters() const
+{
+    return _multiRes;
+}
+
+/**
+ * @brief VolumeRenderCL::getMultiResRayCount
+ * @return
+ */
+size_t VolumeRenderCL::getMultiResRayCount() const
+{
+    return _multiResRays;
+}
+
+
+/**
+ * @brief VolumeRenderCL::enqueueVariableRate
+ * @param width
+ * @param height
+ * @param output
+ */
+void VolumeRenderCL::enqueueVariableRate(const size_t width, const size_t height,
+                                         const cl::Image &output)
+{
+    const auto allocate = [this](cl::Image2D &img, const cl::ImageFormat &format,
+                                 const size_t w, const size_t h) {
+        if (!img() || img.getImageInfo<CL_IMAGE_WIDTH>() != w
+                || img.getImageInfo<CL_IMAGE_HEIGHT>() != h
+                || img.getImageInfo<CL_IMAGE_FORMAT>().image_channel_data_type
+                        != format.image_channel_data_type)
+            img = cl::Image2D(_contextCL, CL_MEM_READ_WRITE, format, w, h);
+    };
+    const size_t prepassWidth = (width + LOCAL_SIZE - 1) / LOCAL_SIZE;
+    const size_t prepassHeight = (height + LOCAL_SIZE - 1) / LOCAL_SIZE;
+    const size_t tilesX = (width + RATE_TILE_SIZE - 1) / RATE_TILE_SIZE;
+    const size_t tilesY = (height + RATE_TILE_SIZE - 1) / RATE_TILE_SIZE;
+    allocate(_ratePrepassMem, getImageFormat(), prepassWidth, prepassHeight);
+    allocate(_rateMem, cl::ImageFormat(CL_R, CL_UNSIGNED_INT8), tilesX, tilesY);
+    allocate(_rateLatticeMem, getImageFormat(), width, height);
+    const cl_float2 gaze = {{_gazePoint.s[0] * width, _gazePoint.s[1] * height}};
+
+    // pre-pass: one Standard ray per LOCAL_SIZE x LOCAL_SIZE pixels with the multi-resolution rays
+    cl_uint2 extend = {{static_cast<cl_uint>(width), static_cast<cl_uint>(height)}};
+    _raycastKernel.setArg(IMAP, extend);
+    _raycastKernel.setArg(IMG_ESS, 0u);
+    _raycastKernel.setArg(RMODE, 2u);
+    _raycastKernel.setArg(OUTPUT, _ratePrepassMem);
+    _raycastKernel.setArg(LAYER_VIEWPORT, cl_float4{{0.f, 0.f, static_cast<float>(LOCAL_SIZE), 0.5f}});
+    cl::Event prepassEvt;
+    _queueCL.enqueueNDRangeKernel(_raycastKernel, cl::NullRange,
+                                  cl::NDRange(prepassWidth + (LOCAL_SIZE - prepassWidth % LOCAL_SIZE),
+                                              prepassHeight + (LOCAL_SIZE - prepassHeight % LOCAL_SIZE)),
+                                  cl::NDRange(LOCAL_SIZE, LOCAL_SIZE), nullptr, &prepassEvt);
+    addTimingEvent(TIMING_RAYCAST, prepassEvt);
+
+    // shading rate per tile, each tile appends the work groups of its lattice to _rateGroupsMem
+    const size_t tileBlocks = RATE_TILE_SIZE / LOCAL_SIZE;
+    const size_t maxGroups = tilesX * tilesY * tileBlocks*tileBlocks;     // all tiles at full rate
+    if (!_rateGroupsMem() || _rateGroupsMem.getInfo<CL_MEM_SIZE>() < maxGroups * sizeof(cl_uint4))
+        _rateGroupsMem = cl::Buffer(_contextCL, CL_MEM_READ_WRITE, maxGroups * sizeof(cl_uint4));
+    if (!_rateGroupCountMem())
+        _rateGroupCountMem = cl::Buffer(_contextCL, CL_MEM_READ_WRITE, sizeof(cl_uint));
+    _queueCL.enqueueFillBuffer(_rateGroupCountMem, 0u, 0, sizeof(cl_uint));
+    _shadingRateKernel.setArg(SR_PREPASS, _ratePrepassMem);
+    _shadingRateKernel.setArg(SR_RATE, _rateMem);
+    _shadingRateKernel.setArg(SR_TILE_SAMPLES, static_cast<cl_uint>(tileBlocks));
+    _shadingRateKernel.setArg(SR_GPOINT, gaze);
+    _shadingRateKernel.setArg(SR_FOVEA, _variableRate.foveaRadius
+                                        * static_cast<float>(std::max(width, height)));
+    _shadingRateKernel.setArg(SR_THRESHOLD, _variableRate.threshold);
+    _shadingRateKernel.setArg(SR_TILE_SIZE, static_cast<cl_uint>(RATE_TILE_SIZE));
+    _shadingRateKernel.setArg(SR_IMG_SIZE, extend);
+    _shadingRateKernel.setArg(SR_GROUPS, _rateGroupsMem);
+    _shadingRateKernel.setArg(SR_GROUP_COUNT, _rateGroupCountMem);
+    cl::Event rateEvt;
+    _queueCL.enqueueNDRangeKernel(_shadingRateKernel, cl::NullRange, cl::NDRange(tilesX, tilesY),
+                                  cl::NullRange, nullptr, &rateEvt);
+    addTimingEvent(TIMING_RAYCAST, rateEvt);
+
+    // main pass into the lattice image, dispatched for the upper bound of work groups,
+    // groups beyond the count built by the shading rate kernel exit early
+    const size_t wgSize = LOCAL_SIZE*LOCAL_SIZE;
+    _raycastKernel.setArg(RMODE, 3u);
+    _raycastKernel.setArg(OUTPUT, _rateLatticeMem);
+    _raycastKernel.setArg(RATE_GROUPS, _rateGroupsMem);
+    _raycastKernel.setArg(RATE_COUNT, _rateGroupCountMem);
+    cl::Event ndrEvt;
+    _queueCL.enqueueNDRangeKernel(_raycastKernel, cl::NullRange,
+                                  cl::NDRange(maxGroups * wgSize), cl::NDRange(wgSize),
+                                  nullptr, &ndrEvt);
+    addTimingEvent(TIMING_RAYCAST, ndrEvt);
+
+    // ray count statistics only, the frame's final sync makes the value available
+    _ratePrepassRays = prepassWidth * prepassHeight;
+    cl::Event readEvt;
+    _queueCL.enqueueReadBuffer(_rateGroupCountMem, CL_FALSE, 0, sizeof(cl_uint), &_rateGroupCount,
+                               nullptr, &readEvt);
+    addTimingEvent(TIMING_READ, readEvt);
+
+    _raycastKernel.setArg(OUTPUT, output);
+    _raycastKernel.setArg(RMODE, _renderingMode >= 2u ? 0u : _renderingMode);
+    _raycastKernel.setArg(IMG_ESS, static_cast<cl_uint>(_useImgESS));
+
+    // fill the pixels between the lattice samples
+    _fillVariableRateKernel.setArg(VR_LATTICE, _rateLatticeMem);
+    _fillVariableRateKernel.setArg(VR_RATE, _rateMem);
+    _fillVariableRateKernel.setArg(VR_OUTIMG, output);
+    _fillVariableRateKernel.setArg(VR_TILE_SIZE, static_cast<cl_uint>(RATE_TILE_SIZE));
+    cl::Event fillEvt;
+    _queueCL.enqueueNDRangeKernel(_fillVariableRateKernel, cl::NullRange,
+                                  cl::NDRange(width + (LOCAL_SIZE - width % LOCAL_SIZE),
+                                              height + (LOCAL_SIZE - height % LOCAL_SIZE)),
+                                  cl::NDRange(LOCAL_SIZE, LOCAL_SIZE), nullptr, &fillEvt);
+    addTimingEvent(TIMING_INTERPOLATE, fillEvt);
+}
+
+/**
+ * @brief VolumeRenderCL::runRaycastVariableRate
+ * @param width
+ * @param height
+ * @param t
+ */
+void VolumeRenderCL::runRaycastVariableRate(const size_t width, const size_t height,
+                                            const size_t t)
+{
+    TRACE_SCOPE("runRaycastVariableRate");
+    if (!this->_volLoaded)
+        return;
+    try // opencl scope
+    {
+        beginFrameTiming();
+        setMemObjectsRaycast(t);
+        cl::Event acqEvt;
+        cl::Event relEvt;
+        std::vector<cl::Memory> memObj;
+        memObj.push_back(_outputMem);
+        _queueCL.enqueueAcquireGLObjects(&memObj, nullptr, &acqEvt);
+        enqueueVariableRate(width, height, _outputMem);
+        _queueCL.enqueueReleaseGLObjects(&memObj, nullptr, &relEvt);
+        _queueCL.finish();    // global sync
+
+        addTimingEvent(TIMING_ACQUIRE, acqEvt);
+        addTimingEvent(TIMING_RELEASE, relEvt);
+        endFrameTiming();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::runRaycastVariableRateNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastVariableRateNoGL(const size_t width, const size_t height,
+                                                const size_t t, std::vector<unsigned char> &output)
+{
+    TRACE_SCOPE("runRaycastVariableRateNoGL");
+    if (!this->_volLoaded)
+        return;
+    try // opencl scope
+    {
+        beginFrameTiming();
+        setMemObjectsRaycast(t);
+        enqueueVariableRate(width, height, _outputMemNoGL);
+        output.resize(width*height*getBytesPerPixel());
+        readOutputImg(width, height, output.data());
+        endFrameTiming();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::runRaycastVariableRateNoGL
+ * @param width
+ * @param height
+ * @param t
+ * @param output
+ */
+void VolumeRenderCL::runRaycastVariableRateNoGL(const size_t width, const size_t height,
+                                                const size_t t, std::vector<float> &output)
+{
+    if (!this->_volLoaded)
+        return;
+    runRaycastVariableRateNoGL(width, height, t, _output);
+    output.resize(width*height*4);
+    convertOutput(output);
+}
+
+/**
+ * @brief VolumeRenderCL::setVariableRateParameters
+ * @param parameters
+ */
+void VolumeRenderCL::setVariableRateParameters(const VariableRateParameters &parameters)
+{
+    if (parameters.foveaRadius < 0.f)
+        throw std::invalid_argument("Variable rate fovea radius must not be negative.");
+    if (parameters.threshold <= 0.f)
+        throw std::invalid_argument("Variable rate threshold has to be positive.");
+    ++_parameterVersion;
+    _variableRate = parameters;
+}
+
+/**
+ * @brief VolumeRenderCL::getVariableRateParameters
+ * @return
+ */
+const VolumeRenderCL::VariableRateParameters &VolumeRenderCL::getVariableRateParameters() const
+{
+    return _variableRate;
+}
+
+/**
+ * @brief VolumeRenderCL::getVariableRateRayCount
+ * @return
+ */
+size_t VolumeRenderCL::getVariableRateRayCount() const
+{
+    return _ratePrepassRays + static_cast<size_t>(_rateGroupCount) * LOCAL_SIZE*LOCAL_SIZE;
+}
+
+
+/**
+ * @brief VolumeRenderCL::generateBricks
+ * @param volumeData
+ */
+void VolumeRenderCL::generateBricks()
+{
+    TRACE_SCOPE("generateBricks");
+    if (!_dr.has_data())
+        return;
+    try
+    {
+        // calculate brick size
+        const unsigned int numBricks = 64u;
+        std::array<unsigned int, 3> brickRes = {1u, 1u, 1u};
+        brickRes.at(0) = std::max(1u, RoundPow2(_dr.properties().volume_res.at(0)/numBricks));
+        brickRes.at(1) = std::max(1u, RoundPow2(_dr.properties().volume_res.at(1)/numBricks));
+        brickRes.at(2) = std::max(1u, RoundPow2(_dr.properties().volume_res.at(2)/numBricks));
+//std::cout << brickRes.at(2) << std::endl;
+        std::array<unsigned int, 3> bricksTexSize = {1u, 1u, 1u};
+        bricksTexSize.at(0) = static_cast<unsigned int>(ceil(_dr.properties().volume_res.at(0) /
+                                                             static_cast<double>(brickRes.at(0))));
+        bricksTexSize.at(1) = static_cast<unsigned int>(ceil(_dr.properties().volume_res.at(1) /
+                                                             static_cast<double>(brickRes.at(1))));
+        bricksTexSize.at(2) = static_cast<unsigned int>(ceil(_dr.properties().volume_res.at(2) /
+                                                             static_cast<double>(brickRes.at(2))));
+//std::cout << bricksTexSize.at(2) << std::endl;
+        // set memory object
+        cl::ImageFormat format;
+        format.image_channel_order = CL_RG;  // NOTE: CL_RG for min+max
+
+        if (_dr.properties().format == "UCHAR")
+            format.image_channel_data_type = CL_UNORM_INT8;
+        else if (_dr.properties().format == "USHORT")
+            format.image_channel_data_type = CL_UNORM_INT16;
+        else if (_dr.properties().format == "FLOAT")
+            format.image_channel_data_type = CL_FLOAT;
+        else
+            throw std::invalid_argument("Unknown or invalid volume data format.");
+
+        _bricksMem.clear();
+        for (size_t i = 0; i < _dr.properties().raw_file_names.size(); ++i)
+        {
+            _bricksMem.push_back(cl::Image3D(_contextCL,
+                                             CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS,
+                                             format,
+                                             bricksTexSize.at(0),
+                                             bricksTexSize.at(1),
+                                             bricksTexSize.at(2)));
+            // run aggregation kernel
+            setMemObjectsBrickGen(i);
+            size_t lDim = 4;    // local work group dimension: 4*4*4=64
+            cl::NDRange globalThreads(bricksTexSize.at(0) + (lDim - bricksTexSize.at(0) % lDim),
+                                      bricksTexSize.at(1) + (lDim - bricksTexSize.at(1) % lDim),
+                                      bricksTexSize.at(2) + (lDim - bricksTexSize.at(2) % lDim));
+            cl::NDRange localThreads(lDim, lDim, lDim);
+//            cl::Event ndrEvt;
+            _queueCL.enqueueNDRangeKernel(_genBricksKernel, cl::NullRange, globalThreads,
+                                          localThreads); //, NULL, &ndrEvt);
+            _queueCL.finish();
+//            cl_ulong start = 0;
+//            cl_ulong end = 0;
+//            ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+//            ndrEvt.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+//            double execTime = static_cast<double>(end - start)*1e-9;
+//            std::cout << "Build up time: " << execTime << std::endl;
+        }
+    }
+    catch (cl::Error err)
+    {
+        throw std::runtime_error( "ERROR: " + std::string(err.what()) + "("
+                                  + getCLErrorString(err.err()) + ")");
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::generateAoVolume
+ * @param t
+ */
+void VolumeRenderCL::generateAoVolume(const size_t t)
+{
+    TRACE_SCOPE("generateAoVolume");
+    if (!_dr.has_data() || !_tffMem())
+        return;
+    try
+    {
+        // reduce resolution to at most 128 cells per axis
+        const double maxAoRes = 128.0;
+        const std::array<size_t, 4> volRes = _dr.properties().volume_res;
+        double factor = std::max(1.0, std::max(volRes.at(0), std::max(volRes.at(1), volRes.at(2)))
+                                      / maxAoRes);
+        std::array<size_t, 3> aoRes = {1u, 1u, 1u};
+        for (size_t i = 0; i < aoRes.size(); ++i)
+            aoRes.at(i) = std::max(static_cast<size_t>(1u),
+                                   static_cast<size_t>(ceil(volRes.at(i) / factor)));
+
+        _aoVolMem = cl::Image3D(_contextCL, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS,
+                                cl::ImageFormat(CL_R, CL_UNORM_INT8),
+                                aoRes.at(0), aoRes.at(1), aoRes.at(2));
+        _genAoVolumeKernel.setArg(0, _volumesMem.at(t));
+        _genAoVolumeKernel.setArg(1, _tffMem);
+        _genAoVolumeKernel.setArg(2, _aoVolMem);
+
+        size_t lDim = 4;    // local work group dimension: 4*4*4=64
+        cl::NDRange globalThreads(aoRes.at(0) + (lDim - aoRes.at(0) % lDim),
+                                  aoRes.at(1) + (lDim - aoRes.at(1) % lDim),
+                                  aoRes.at(2) + (lDim - aoRes.at(2) % lDim));
+        cl::NDRange localThreads(lDim, lDim, lDim);
+        _queueCL.enqueueNDRangeKernel(_genAoVolumeKernel, cl::NullRange, globalThreads,
+                                      localThreads);
+        _queueCL.finish();
+        _aoValid = true;
+        _aoTimestep = t;
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::volDataToCLmem
+ * @param volumeData
+ */
+void VolumeRenderCL::volDataToCLmem(const std::vector<std::vector<char>> &volumeData)
+{
+    if (!_dr.has_data())
+        return;
+    _aoValid = false;
+    try
+    {
+        cl::ImageFormat format;
+        format.image_channel_order = CL_R;
+        unsigned int formatMultiplier = 1;
+
+        if (_dr.properties().format == "UCHAR")
+            format.image_channel_data_type = CL_UNORM_INT8;
+        else if (_dr.properties().format == "USHORT")
+        {
+            format.image_channel_data_type = CL_UNORM_INT16;
+            formatMultiplier = 2;
+        }
+        else if (_dr.properties().format == "FLOAT")
+        {
+            format.image_channel_data_type = CL_FLOAT;
+            formatMultiplier = 4;
+        }
+        else
+            throw std::invalid_argument("Unknown or invalid volume data format.");
+
+        _volumesMem.clear();
+        for (const auto &v : volumeData)
+        {
+            if(_dr.properties().volume_res[0]*_dr.properties().volume_res[1]*
+                     _dr.properties().volume_res[2]*formatMultiplier > v.size())
+            {
+                _dr.clearData();
+                throw std::runtime_error("Volume size does not match size specified in dat file.");
+            }
+            _volumesMem.push_back(cl::Image3D(_contextCL,
+                                              CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                              format,
+                                              _dr.properties().volume_res[0],
+                                              _dr.properties().volume_res[1],
+                                              _dr.properties().volume_res[2],
+                                              0, 0,
+                                              const_cast<char*>(v.data())));
+        }
+    }
+    catch (cl::Error err)
+    {
+        throw std::runtime_error( "ERROR: " + std::string(err.what()) + "("
+                                  + getCLErrorString(err.err()) + ")");
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::loadVolumeData
+ * @param fileName
+ */
+size_t VolumeRenderCL::loadVolumeData(const std::string fileName)
+{
+    ++_parameterVersion;
+    TRACE_SCOPE("loadVolumeData");
+    this->_volLoaded = false;
     std::cout << "Loading volume data defined in " << fileName << std::endl;
     try
     {
@@ -952,6 +1826,8 @@ void VolumeRenderCL::loadIndexAndSamplingMap(const std::string &fileNameIndexMap
                                              const QString &fileNameNeighborIndex,
                                              const QString &fileNameNeighborWeights)
 {
+    ++_parameterVersion;
+    TRACE_SCOPE("loadIndexAndSamplingMap");
 	cl_int err;
 	
 	cl::ImageFormat im_format;
@@ -965,6 +1841,8 @@ void VolumeRenderCL::loadIndexAndSamplingMap(const std::string &fileNameIndexMap
 		// std::cout << "width: " << im.width() << std::endl;
         _indexMap = cl::Image2D(_contextCL, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, im_format, im.width(), im.height(), 0, im.bits());
         _indexMapExtends = { im.width(), im.height() };
+        _depthMem = cl::Image2D(_contextCL, CL_MEM_READ_WRITE, cl::ImageFormat(CL_R, CL_FLOAT),
+                                im.width(), im.height());
 	}
 	catch (cl::Error e) {
 		throw std::runtime_error(std::string("Failed to create cl::Image2D for index map. Error: ").append(std::to_string(e.err())).c_str());
@@ -1122,6 +2000,8 @@ const std::array<size_t, 4> VolumeRenderCL::getResolution() const
  */
 void VolumeRenderCL::setTransferFunction(std::vector<unsigned char> &tff)
 {
+    ++_parameterVersion;
+    TRACE_SCOPE("setTransferFunction");
     if (!_dr.has_data())
         return;
     try
@@ -1133,7 +2013,9 @@ void VolumeRenderCL::setTransferFunction(std::vector<unsigned char> &tff)
         cl_mem_flags flags = CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR;
         // divide size by 4 because of RGBA channels
         _tffMem = cl::Image1D(_contextCL, flags, format, tff.size() / 4, tff.data());
+        generatePreIntegrationTable(tff);
         generateBricks();
+        _aoValid = false;   // regenerated with the next frame if AO is in use
 
         std::vector<unsigned int> prefixSum;
         // copy only alpha values (every fourth element)
@@ -1149,12 +2031,78 @@ void VolumeRenderCL::setTransferFunction(std::vector<unsigned char> &tff)
 }
 
 
+/**
+ * @brief VolumeRenderCL::generatePreIntegrationTable
+ * @param tff
+ */
+void VolumeRenderCL::generatePreIntegrationTable(const std::vector<unsigned char> &tff)
+{
+    TRACE_SCOPE("generatePreIntegrationTable");
+    const size_t tffSize = tff.size() / 4;
+    if (tffSize == 0)
+        return;
+    try
+    {
+        // cumulative integral of the opacity weighted colors and the opacity, trapezoidal rule
+        // matches the linear interpolation of the transfer function between its texels
+        const auto weighted = [&tff](const size_t texel, const size_t channel) {
+            const float alpha = tff.at(texel*4 + 3) / 255.f;
+            return channel == 3 ? alpha : tff.at(texel*4 + channel) / 255.f * alpha;
+        };
+        std::vector<cl_float4> integral(tffSize);
+        integral.at(0) = {{0.f, 0.f, 0.f, 0.f}};
+        for (size_t i = 1; i < tffSize; ++i)
+            for (size_t c = 0; c < 4; ++c)
+                integral.at(i).s[c] = integral.at(i - 1).s[c]
+                        + 0.5f * (weighted(i - 1, c) + weighted(i, c));
+
+        cl::ImageFormat format;
+        format.image_channel_order = CL_RGBA;
+        format.image_channel_data_type = CL_FLOAT;  // avoid banding of small averaged opacities
+
+        cl::Image1D integralMem(_contextCL, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, format,
+                                tffSize, integral.data());
+        _tffPreIntMem = cl::Image2D(_contextCL, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS,
+                                    format, tffSize, tffSize);
+        _preIntegrateKernel.setArg(0, _tffMem);
+        _preIntegrateKernel.setArg(1, integralMem);
+        _preIntegrateKernel.setArg(2, _tffPreIntMem);
+
+        size_t globalSize = tffSize + (tffSize % LOCAL_SIZE > 0 ? LOCAL_SIZE - tffSize % LOCAL_SIZE : 0);
+        cl::NDRange globalThreads(globalSize, globalSize);
+        cl::NDRange localThreads(LOCAL_SIZE, LOCAL_SIZE);
+        _queueCL.enqueueNDRangeKernel(_preIntegrateKernel, cl::NullRange, globalThreads,
+                                      localThreads);
+        _queueCL.finish();
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+
+/**
+ * @brief VolumeRenderCL::setPreIntegration
+ * @param preIntegration
+ */
+void VolumeRenderCL::setPreIntegration(const bool preIntegration)
+{
+    ++_parameterVersion;
+    try {
+        _raycastKernel.setArg(PRE_INTEGRATED, static_cast<cl_uint>(preIntegration));
+        _usePreIntegration = preIntegration;
+    } catch (cl::Error err) { logCLerror(err); }
+}
+
+
 /**
  * @brief VolumeRenderCL::setTffPrefixSum
  * @param tffPrefixSum
  */
 void VolumeRenderCL::setTffPrefixSum(std::vector<unsigned int> &tffPrefixSum)
 {
+    ++_parameterVersion;
     if (!_dr.has_data())
         return;
     try
@@ -1179,12 +2127,48 @@ void VolumeRenderCL::setTffPrefixSum(std::vector<unsigned int> &tffPrefixSum)
  */
 void VolumeRenderCL::setCamOrtho(const bool setCamOrtho)
 {
+    ++_parameterVersion;
     if (!this->hasData())
         return;
 
     try {
         _raycastKernel.setArg(ORTHO, static_cast<cl_uint>(setCamOrtho));
     } catch (cl::Error err) { logCLerror(err); }
+    _orthoCam = setCamOrtho;
+    _history.reset();
+}
+
+/**
+ * @brief VolumeRenderCL::setReprojection
+ * @param reprojection
+ */
+void VolumeRenderCL::setReprojection(const bool reprojection)
+{
+    ++_parameterVersion;
+    _useReprojection = reprojection;
+    _history.reset();
+}
+
+/**
+ * @brief VolumeRenderCL::getReprojection
+ * @return
+ */
+bool VolumeRenderCL::getReprojection() const
+{
+    return _useReprojection;
+}
+
+/**
+ * @brief VolumeRenderCL::storeHistoryFrame
+ * @return true if the current LBG frame is added to the temporal history. Without
+ *         reprojection, only frames of a still camera with a new gaze point are stored, with
+ *         reprojection also frames after camera motion.
+ */
+bool VolumeRenderCL::storeHistoryFrame() const
+{
+    if (_useReprojection && !_orthoCam)
+        return _gazeChanged || _viewChanged;
+    return _gazeChanged && !_viewChanged;
 }
 
 /**
@@ -1193,6 +2177,7 @@ void VolumeRenderCL::setCamOrtho(const bool setCamOrtho)
  */
 void VolumeRenderCL::setIllumination(const unsigned int illum)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(ILLUMINATION, static_cast<cl_uint>(illum));
     } catch (cl::Error err) { logCLerror(err); }
@@ -1205,8 +2190,10 @@ void VolumeRenderCL::setIllumination(const unsigned int illum)
  */
 void VolumeRenderCL::setAmbientOcclusion(const bool ao)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(AO, static_cast<cl_uint>(ao));
+        _useAO = ao;
     } catch (cl::Error err) { logCLerror(err); }
 }
 
@@ -1217,6 +2204,7 @@ void VolumeRenderCL::setAmbientOcclusion(const bool ao)
  */
 void VolumeRenderCL::setShowESS(const bool showESS)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(SHOW_ESS, static_cast<cl_uint>(showESS));
     } catch (cl::Error err) { logCLerror(err); }
@@ -1229,6 +2217,7 @@ void VolumeRenderCL::setShowESS(const bool showESS)
  */
 void VolumeRenderCL::setLinearInterpolation(const bool linearSampling)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(LINEAR, static_cast<cl_uint>(linearSampling));
     } catch (cl::Error err) { logCLerror(err); }
@@ -1240,6 +2229,7 @@ void VolumeRenderCL::setLinearInterpolation(const bool linearSampling)
  */
 void VolumeRenderCL::setContours(const bool contours)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(CONTOURS, static_cast<cl_uint>(contours));
     } catch (cl::Error err) { logCLerror(err); }
@@ -1251,6 +2241,7 @@ void VolumeRenderCL::setContours(const bool contours)
  */
 void VolumeRenderCL::setAerial(const bool aerial)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(AERIAL, static_cast<cl_uint>(aerial));
     } catch (cl::Error err) { logCLerror(err); }
@@ -1262,6 +2253,7 @@ void VolumeRenderCL::setAerial(const bool aerial)
  */
 void VolumeRenderCL::setImgEss(const bool useEss)
 {
+    ++_parameterVersion;
     try {
         _raycastKernel.setArg(IMG_ESS,  static_cast<cl_uint>(useEss));
         _useImgESS = useEss;
@@ -1274,6 +2266,7 @@ void VolumeRenderCL::setImgEss(const bool useEss)
  */
 void VolumeRenderCL::setObjEss(const bool useEss)
 {
+    ++_parameterVersion;
     std::string ess = useEss ? "-DESS" : "";
 #ifdef _WIN32
     initKernel("kernels//volumeraycast.cl", "-DCL_STD=CL1.2 " + ess);
@@ -1293,14 +2286,16 @@ void VolumeRenderCL::setObjEss(const bool useEss)
  */
 void VolumeRenderCL::setBackground(const std::array<float, 4> color)
 {
-    cl_float3 bgColor = {{color[0], color[1], color[2], color[3]}};
+    ++_parameterVersion;
+    _background = {{color[0], color[1], color[2], color[3]}};
     try {
-        _raycastKernel.setArg(BACKGROUND, bgColor);
+        _raycastKernel.setArg(BACKGROUND, _background);
     } catch (cl::Error err) { logCLerror(err); }
 }
 
 void VolumeRenderCL::setGazePoint(QPoint gaze_point)
 {
+    ++_parameterVersion;
 	cl_float2 gpf = { static_cast<cl_float>(gaze_point.x()), static_cast<cl_float>(gaze_point.y()) };
     try {
         _raycastKernel.setArg(GPOINT, gpf);
@@ -1318,11 +2313,62 @@ void VolumeRenderCL::setGazePoint(cl_float2 gaze_point)
         {
             _gazeChanged = true;
             _gazePoint = gaze_point;
+            ++_parameterVersion;
         }
     } catch (cl::Error err) { logCLerror(err); }
 }
 
 
+/**
+ * @brief VolumeRenderCL::setImagePrecision
+ * @param precision
+ */
+void VolumeRenderCL::setImagePrecision(const image_precision precision)
+{
+    ++_parameterVersion;
+    _imgPrecision = precision;
+}
+
+/**
+ * @brief VolumeRenderCL::getImagePrecision
+ * @return
+ */
+VolumeRenderCL::image_precision VolumeRenderCL::getImagePrecision() const
+{
+    return _imgPrecision;
+}
+
+/**
+ * @brief VolumeRenderCL::getBytesPerPixel
+ * @return
+ */
+size_t VolumeRenderCL::getBytesPerPixel() const
+{
+    switch (_imgPrecision)
+    {
+    case PRECISION_FLOAT: return 4*sizeof(cl_float);
+    case PRECISION_HALF: return 4*sizeof(cl_half);
+    default: return 4*sizeof(cl_uchar);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::getImageFormat
+ * @return
+ */
+cl::ImageFormat VolumeRenderCL::getImageFormat() const
+{
+    cl::ImageFormat format;
+    format.image_channel_order = CL_RGBA;
+    switch (_imgPrecision)
+    {
+    case PRECISION_FLOAT: format.image_channel_data_type = CL_FLOAT; break;
+    case PRECISION_HALF: format.image_channel_data_type = CL_HALF_FLOAT; break;
+    default: format.image_channel_data_type = CL_UNORM_INT8; break;
+    }
+    return format;
+}
+
 /**
  * @brief VolumeRenderCL::getLastExecTime
  * @return
@@ -1332,18 +2378,140 @@ double VolumeRenderCL::getLastExecTime() const
     return _lastExecTime;
 }
 
+/**
+ * @brief VolumeRenderCL::getLastFrameTiming
+ * @return
+ */
+FrameTiming VolumeRenderCL::getLastFrameTiming() const
+{
+    return _timingHistory.last();
+}
+
+/**
+ * @brief VolumeRenderCL::getTimingHistory
+ * @return
+ */
+const FrameTimingHistory &VolumeRenderCL::getTimingHistory() const
+{
+    return _timingHistory;
+}
+
+/**
+ * @brief VolumeRenderCL::clearTimingHistory
+ */
+void VolumeRenderCL::clearTimingHistory()
+{
+    _timingHistory.clear();
+}
+
+/**
+ * @brief VolumeRenderCL::beginFrameTiming
+ */
+void VolumeRenderCL::beginFrameTiming()
+{
+    _timingEvents.clear();
+    _lastFrameStart = _frameStart;
+    _frameStart = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief VolumeRenderCL::addTimingEvent
+ * @param id
+ * @param evt
+ */
+void VolumeRenderCL::addTimingEvent(const timing_id id, const cl::Event &evt)
+{
+    _timingEvents.push_back(std::make_pair(id, evt));
+}
+
+/**
+ * @brief VolumeRenderCL::endFrameTiming
+ */
+void VolumeRenderCL::endFrameTiming()
+{
+    FrameTiming timing;
+#ifdef CL_QUEUE_PROFILING_ENABLE
+    cl_ulong first = std::numeric_limits<cl_ulong>::max();
+    cl_ulong last = 0;
+    for (auto &e : _timingEvents)
+    {
+        cl_ulong start = 0;
+        cl_ulong end = 0;
+        e.second.wait();
+        e.second.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+        e.second.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+        const double duration = static_cast<double>(end - start)*1e-9;  // ns -> sec
+        timing.values.at(e.first) += duration;
+        timing.values.at(TIMING_DEVICE) += duration;
+        first = std::min(first, start);
+        last = std::max(last, end);
+    }
+    if (!_timingEvents.empty())
+        timing.values.at(TIMING_GAP) = std::max(0.0, static_cast<double>(last - first)*1e-9
+                                                     - timing.values.at(TIMING_DEVICE));
+
+    if (Tracer::isEnabled() && !_timingEvents.empty())
+    {
+        // OpenCL 1.2 has no host/device clock correlation: align the end of the last command
+        // with the current host time, all events have completed at this point
+        const int64_t offset = Tracer::now() - static_cast<int64_t>(last / 1000);
+        for (auto &e : _timingEvents)
+        {
+            cl_ulong start = 0;
+            cl_ulong end = 0;
+            e.second.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+            e.second.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+            Tracer::addDeviceEvent(timingName(e.first), static_cast<int64_t>(start / 1000) + offset,
+                                   static_cast<int64_t>((end - start) / 1000));
+        }
+    }
+#endif
+#ifdef KERNEL_COUNTERS
+    // read and reset the work counters of this frame
+    std::array<cl_uint, COUNTER_COUNT> counters;
+    _queueCL.enqueueReadBuffer(_countersMem, CL_TRUE, 0, sizeof(cl_uint)*counters.size(),
+                               counters.data());
+    for (size_t i = 0; i < counters.size(); ++i)
+        timing.counters.at(i) = counters.at(i);
+    counters.fill(0);
+    _queueCL.enqueueWriteBuffer(_countersMem, CL_TRUE, 0, sizeof(cl_uint)*counters.size(),
+                                counters.data());
+#endif
+    const auto now = std::chrono::steady_clock::now();
+    timing.values.at(TIMING_HOST) = std::chrono::duration<double>(now - _frameStart).count();
+    if (_lastFrameStart.time_since_epoch().count() > 0)
+        timing.values.at(TIMING_INTERVAL) =
+                std::chrono::duration<double>(_frameStart - _lastFrameStart).count();
+
+    // compute stages only, comparable between standard and LBG rendering
+    _lastExecTime = timing.values.at(TIMING_RAYCAST) + timing.values.at(TIMING_INTERPOLATE)
+                    + timing.values.at(TIMING_COPY);
+    _timingHistory.push(timing);
+    _timingEvents.clear();
+}
+
 void VolumeRenderCL::updateRenderingParameters(unsigned int renderingMethod)
 {
+    ++_parameterVersion;
 	switch (renderingMethod) {
 	case 1:
 		// LBG-Sampling
-		_raycastKernel.setArg(RMODE, 1u);
+		_renderingMode = 1u;
+		break;
+	case 2:
+		// Multi-resolution, rays of the layers are set up per pass in enqueueMultiRes
+		_renderingMode = 2u;
+		break;
+	case 3:
+		// Variable rate, rays are set up per pass in enqueueVariableRate
+		_renderingMode = 3u;
 		break;
 	default:
 		// Standard
-		_raycastKernel.setArg(RMODE, 0u);
+		_renderingMode = 0u;
 		break;
 	}
+	_raycastKernel.setArg(RMODE, _renderingMode >= 2u ? 0u : _renderingMode);
 }
 
 
@@ -1407,6 +2575,131 @@ const std::string & VolumeRenderCL::getCurrentDeviceName() const
     return _currentDevice;
 }
 
+/**
+ * @brief VolumeRenderCL::getDeviceMemoryUsage
+ * @return
+ */
+size_t VolumeRenderCL::getDeviceMemoryUsage() const
+{
+    size_t bytes = 0;
+    const auto add = [&bytes](const cl::Memory &mem) {
+        if (mem() != nullptr)
+            bytes += mem.getInfo<CL_MEM_SIZE>();
+    };
+    try
+    {
+        for (const auto &mem : _volumesMem)
+            add(mem);
+        for (const auto &mem : _bricksMem)
+            add(mem);
+        for (const auto &mem : _volMipmapsMem)
+            add(mem);
+        for (const cl::Memory &mem : {cl::Memory(_outputMem), cl::Memory(_inputMem),
+                                      cl::Memory(_tffMem), cl::Memory(_tffPrefixMem),
+                                      cl::Memory(_tffPreIntMem), cl::Memory(_aoVolMem),
+                                      cl::Memory(_outputMemNoGL), cl::Memory(_inputMemNoGL),
+                                      cl::Memory(_outputHitMem), cl::Memory(_inputHitMem),
+                                      cl::Memory(_samplingMapData), cl::Memory(_indexMap),
+                                      cl::Memory(_history.lastFrames()),
+                                      cl::Memory(_history.thisFrame()),
+                                      cl::Memory(_history.lastViews()),
+                                      cl::Memory(_multiResLayers.at(0)),
+                                      cl::Memory(_multiResLayers.at(1)),
+                                      cl::Memory(_multiResLayers.at(2)),
+                                      cl::Memory(_ratePrepassMem), cl::Memory(_rateMem),
+                                      cl::Memory(_rateLatticeMem), cl::Memory(_rateGroupsMem),
+                                      cl::Memory(_rateGroupCountMem),
+                                      cl::Memory(_neighborIdMap), cl::Memory(_neighborWeightMap)})
+            add(mem);
+    }
+    catch (cl::Error err) { logCLerror(err); }
+    return bytes;
+}
+
+/**
+ * @brief VolumeRenderCL::getDeviceMemorySize
+ * @return
+ */
+size_t VolumeRenderCL::getDeviceMemorySize() const
+{
+    if (_contextCL() == nullptr)
+        return 0;
+    try
+    {
+        const std::vector<cl::Device> devices = _contextCL.getInfo<CL_CONTEXT_DEVICES>();
+        if (!devices.empty())
+            return devices.front().getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+    }
+    catch (cl::Error err) { logCLerror(err); }
+    return 0;
+}
+
+/**
+ * @brief VolumeRenderCL::getGazePoint
+ * @return
+ */
+cl_float2 VolumeRenderCL::getGazePoint() const
+{
+    return _gazePoint;
+}
+
+/**
+ * @brief VolumeRenderCL::getLbgSampleCount
+ * @return
+ */
+size_t VolumeRenderCL::getLbgSampleCount() const
+{
+    return _imsmLoaded ? _amountOfSamples : 0;
+}
+
+/**
+ * @brief VolumeRenderCL::getFrameBlendCount
+ * @return
+ */
+cl_uint VolumeRenderCL::getFrameBlendCount() const
+{
+    return _history.getParameters().depth;
+}
+
+/**
+ * @brief VolumeRenderCL::setTemporalHistory
+ * @param parameters
+ */
+void VolumeRenderCL::setTemporalHistory(const TemporalHistory::Parameters &parameters)
+{
+    ++_parameterVersion;
+    _history.setParameters(parameters);
+    if (_contextCL() == nullptr || _outputImgSize.at(0) == 0)
+        return;
+    try
+    {
+        _history.allocate(_contextCL, _outputImgSize.at(0), _outputImgSize.at(1),
+                          getImageFormat());
+    }
+    catch (cl::Error err)
+    {
+        logCLerror(err);
+    }
+}
+
+/**
+ * @brief VolumeRenderCL::getTemporalHistory
+ * @return
+ */
+const TemporalHistory &VolumeRenderCL::getTemporalHistory() const
+{
+    return _history;
+}
+
+/**
+ * @brief VolumeRenderCL::getParameterVersion
+ * @return
+ */
+uint64_t VolumeRenderCL::getParameterVersion() const
+{
+    return _parameterVersion;
+}
+
 /**
  * @brief VolumeRenderCL::generateMipmaps
  * @param levelCnt
@@ -31,8 +31,11 @@
 #include "src/oclutil/openclutilities.h"
 
 #include "src/io/datrawreader.h"
+#include "src/core/frametiming.h"
+#include "src/core/temporalhistory.h"
 
 #include <valarray>
+#include <chrono>
 
 /**
  * @brief The volume renderer class based on OpenCL.
@@ -69,6 +72,16 @@ public:
 		, SDSAMPLES		 // amount of samples						cl_uint
         , IMAP			 // Index map extends						cl_uint2    // image2d_t
 		, SDATA			 // Sampling map buffer						(buffer)
+        , TFF_PREINT     // pre-integrated transfer function table  image2d_t
+        , PRE_INTEGRATED // use pre-integrated classification      cl_uint (bool)
+        , AO_VOL         // precomputed ambient occlusion volume    image3d_t
+        , DEPTH_IMG      // representative depth of LBG samples     image2d_t (FLOAT)
+        , LAYER_VIEWPORT // multi-resolution layer viewport         cl_float4
+        , RATE_GROUPS    // variable rate work group blocks         (buffer)
+        , RATE_COUNT     // valid entries of RATE_GROUPS            (buffer)
+#ifdef KERNEL_COUNTERS
+        , COUNTERS_BUF   // kernel work counters                    (buffer)
+#endif
         , MIP_1
         , MIP_2
         , MIP_3
@@ -91,8 +104,74 @@ public:
         , IP_FRAME_CNT
         , IP_VIEW_CHANGED
         , IP_GAZE_CHANGED
+        , IP_DEPTH          // representative depth of the samples
+        , IP_VIEW           // current view matrix
+        , IP_LAST_VIEWS     // view matrices of the frames in IP_LAST_FRAMES
+        , IP_MODEL_SCALE
+        , IP_REPROJECT      // reproject the last frames instead of discarding them on camera motion
+        , IP_ACCUMULATE     // IP_LAST_FRAMES is a single accumulation layer (TemporalHistory)
 	};
 
+    enum mr_kernel_arg
+    {
+          MR_FOVEA = 0
+        , MR_MIDDLE
+        , MR_PERIPHERY
+        , MR_OUTIMG
+        , MR_FOVEA_VIEWPORT     // origin, pixel size and disc radius in output pixels
+        , MR_MIDDLE_VIEWPORT
+        , MR_PERIPHERY_VIEWPORT
+        , MR_GPOINT             // gaze point in output pixels
+        , MR_LAYERS
+        , MR_BLEND              // width of the layer transitions in output pixels
+    };
+
+    enum sr_kernel_arg
+    {
+          SR_PREPASS = 0
+        , SR_RATE
+        , SR_TILE_SAMPLES       // pre-pass samples per tile side
+        , SR_GPOINT             // gaze point in output pixels
+        , SR_FOVEA              // fovea radius in output pixels
+        , SR_THRESHOLD
+        , SR_TILE_SIZE
+        , SR_IMG_SIZE           // output image size in pixels
+        , SR_GROUPS             // work groups of the main pass, appended per tile
+        , SR_GROUP_COUNT
+    };
+
+    enum vr_kernel_arg
+    {
+          VR_LATTICE = 0
+        , VR_RATE
+        , VR_OUTIMG
+        , VR_TILE_SIZE
+    };
+
+    /**
+     * @brief Layers of the multi-resolution foveated rendering mode.
+     *        Layer i has a pixel size of scale^i output pixels, the last layer covers the whole
+     *        image, the others a square around the gaze point.
+     */
+    struct MultiResParameters
+    {
+        cl_uint layers = 3;         // 2 or 3
+        cl_uint scale = 2;          // resolution factor between subsequent layers
+        float foveaRadius = 0.15f;  // radius of the full resolution layer, fraction of the larger image side
+        float blend = 0.25f;        // width of the layer transitions, fraction of the fovea radius
+    };
+
+    /**
+     * @brief Shading rate control of the variable rate rendering mode.
+     *        Every tile of 32x32 pixels traces all, every 4th or every 16th pixel depending on
+     *        the luminance deviation of a low resolution pre-pass and the distance to the gaze.
+     */
+    struct VariableRateParameters
+    {
+        float foveaRadius = 0.1f;   // full rate radius around the gaze, fraction of the larger image side
+        float threshold = 0.02f;    // luminance deviation of a tile that needs full rate
+    };
+
     // mipmap down-scaling metric
     enum scaling_metric
     {
@@ -102,6 +181,14 @@ public:
         DENSITY,
     };
 
+    // precision of the intermediate and output images
+    enum image_precision
+    {
+        PRECISION_UNORM8 = 0,   // RGBA8, uchar4 readback
+        PRECISION_HALF,         // RGBA16F, half4 readback
+        PRECISION_FLOAT,        // RGBA32F, float4 readback
+    };
+
     /**
      * @brief Ctor
      */
@@ -165,6 +252,17 @@ public:
      void runRaycastNoGL(const size_t width, const size_t height, const size_t t,
                          std::vector<float> &output);
 
+     /**
+      * @brief Run the OpenCL volume raycasting kernel without OpenGL context sharing and read
+      *        back the output image in its native precision (see setImagePrecision).
+      * @param width The image width in pixels, used as one dimension of the global thread size.
+      * @param height The image height in pixels, used as one dimension of the global thread size.
+      * @param t time series id, defaults to 0 if no time series
+      * @param output raw RGBA pixel data of the frame, getBytesPerPixel() bytes per pixel
+      */
+     void runRaycastNoGL(const size_t width, const size_t height, const size_t t,
+                         std::vector<unsigned char> &output);
+
 	 /**
 	 * @brief Runs the Raycast but sets the kernel parameters to perform lbg-sampling.
 	 * @param width The image width in pixels, used to determine the section of the lbg sampling texture 
@@ -178,7 +276,9 @@ public:
      void runRaycastLBG(const size_t width, const size_t height, const size_t t);
 
 	 /**
-	  * @brief Run the actual OpenCL volume raycasting kernel without OpenGL context shring.
+	  * @brief Run the complete LBG pipeline without OpenGL context sharing: sparse raycast,
+	   natural neighbor interpolation, temporal blending and read back of the result.
+	   Pixels outside of the part covered by the index map are set to the background color.
 	  * @param width The image width in pixels, used to determine the section of the lbg sampling texture 
 	   and also the size of the output texture.
 	   Has to be less or equal the one third of the width of the lbg sampling texture.
@@ -186,7 +286,17 @@ public:
 	   and also the size of the output texture.
 	   Has to be less or equal the one third of the height of the lbg sampling texture.
 	  * @param t time series id, defaults to 0 if no time series
-	  * @param pixel color output data of the frame
+	  * @param output raw RGBA pixel data of the frame, getBytesPerPixel() bytes per pixel
+	  */
+	 void runRaycastLBGNoGL(const size_t width, const size_t height, const size_t t,
+		 std::vector<unsigned char> &output);
+
+	 /**
+	  * @brief Run the complete LBG pipeline without OpenGL context sharing.
+	  * @param width The image width in pixels.
+	  * @param height The image height in pixels.
+	  * @param t time series id, defaults to 0 if no time series
+	  * @param output pixel color output data of the frame
 	  */
 	 void runRaycastLBGNoGL(const size_t width, const size_t height, const size_t t,
 		 std::vector<float> &output);
@@ -196,6 +306,114 @@ public:
 	 */
 	 void interpolateLBG(const size_t width, const size_t height, GLuint inTexId, GLuint outTexId);
 
+	 /**
+	  * @brief Progressive refinement of a still LBG frame. Raycasts the next tiles of the full
+	   resolution image in Standard mode into the output texture, nearest to the gaze point first,
+	   so the image converges to Standard quality after getRefinementPasses() calls.
+	   Refinement starts over if a parameter, the time step or the size changed.
+	  * @param width The image width in pixels.
+	  * @param height The image height in pixels.
+	  * @param t time series id, defaults to 0 if no time series
+	  * @param outTexId Texture holding the interpolated LBG frame.
+	  * @return true if the whole image has been refined.
+	  */
+	 bool refineLBG(const size_t width, const size_t height, const size_t t, GLuint outTexId);
+
+	 /**
+	  * @brief Progressive refinement of a still LBG frame without OpenGL context sharing,
+	   see refineLBG. The output of the last runRaycastLBGNoGL is refined and read back.
+	  * @param output raw RGBA pixel data of the frame, getBytesPerPixel() bytes per pixel
+	  * @return true if the whole image has been refined.
+	  */
+	 bool refineLBGNoGL(const size_t width, const size_t height, const size_t t,
+		 std::vector<unsigned char> &output);
+
+	 /**
+	  * @brief Set the number of refinement calls until the image is complete.
+	  */
+	 void setRefinementPasses(const unsigned int passes);
+	 unsigned int getRefinementPasses() const;
+
+	 /**
+	  * @brief Get the refined fraction of the current image in [0,1].
+	  */
+	 float getRefinementProgress() const;
+
+    /**
+     * @brief Multi-resolution foveated rendering: raycast the layers around the gaze point
+     *        (see MultiResParameters) with Standard rays and compose them into the output
+     *        texture. Needs no precomputed maps and works for any image size.
+     * @param width The image width in pixels.
+     * @param height The image height in pixels.
+     * @param t time series id, defaults to 0 if no time series
+     */
+    void runRaycastMultiRes(const size_t width, const size_t height, const size_t t = 0);
+
+    /**
+     * @brief Multi-resolution foveated rendering without OpenGL context sharing, see
+     *        runRaycastMultiRes.
+     * @param output raw RGBA pixel data of the frame, getBytesPerPixel() bytes per pixel
+     */
+    void runRaycastMultiResNoGL(const size_t width, const size_t height, const size_t t,
+                                std::vector<unsigned char> &output);
+
+    /**
+     * @brief Multi-resolution foveated rendering without OpenGL context sharing.
+     * @param output pixel color output data of the frame
+     */
+    void runRaycastMultiResNoGL(const size_t width, const size_t height, const size_t t,
+                                std::vector<float> &output);
+
+    /**
+     * @brief Set the layer configuration of the multi-resolution mode.
+     * @throws invalid_argument if layers is not 2 or 3, scale is less than 2 or the fovea
+     *         radius is not in (0,1].
+     */
+    void setMultiResParameters(const MultiResParameters &parameters);
+    const MultiResParameters &getMultiResParameters() const;
+
+    /**
+     * @brief Get the number of rays of the last multi-resolution frame.
+     */
+    size_t getMultiResRayCount() const;
+
+    /**
+     * @brief Variable rate raycasting: estimate a shading rate per tile from a low resolution
+     *        pre-pass, trace the selected pixels and fill in the rest with edge-aware
+     *        interpolation (see VariableRateParameters).
+     * @param width The image width in pixels.
+     * @param height The image height in pixels.
+     * @param t time series id, defaults to 0 if no time series
+     */
+    void runRaycastVariableRate(const size_t width, const size_t height, const size_t t = 0);
+
+    /**
+     * @brief Variable rate raycasting without OpenGL context sharing, see
+     *        runRaycastVariableRate.
+     * @param output raw RGBA pixel data of the frame, getBytesPerPixel() bytes per pixel
+     */
+    void runRaycastVariableRateNoGL(const size_t width, const size_t height, const size_t t,
+                                    std::vector<unsigned char> &output);
+
+    /**
+     * @brief Variable rate raycasting without OpenGL context sharing.
+     * @param output pixel color output data of the frame
+     */
+    void runRaycastVariableRateNoGL(const size_t width, const size_t height, const size_t t,
+                                    std::vector<float> &output);
+
+    /**
+     * @brief Set the shading rate control of the variable rate mode.
+     * @throws invalid_argument if the fovea radius is negative or the threshold not positive.
+     */
+    void setVariableRateParameters(const VariableRateParameters &parameters);
+    const VariableRateParameters &getVariableRateParameters() const;
+
+    /**
+     * @brief Get the number of rays of the last variable rate frame, including the pre-pass.
+     */
+    size_t getVariableRateRayCount() const;
+
     /**
      * @brief Load volume data from a given .dat file name.
      * @param fileName The full path to the volume data file.
@@ -234,6 +452,12 @@ public:
      */
     void setTransferFunction(std::vector<unsigned char> &tff);
 
+    /**
+     * @brief Use the pre-integrated transfer function table to classify ray segments.
+     * @param preIntegration
+     */
+    void setPreIntegration(const bool preIntegration);
+
     /**
      * @brief Set the prefix sum of the transfer function.
      * @param tffPrefixSum The prefix sum as vector of unsigned ints.
@@ -261,6 +485,16 @@ public:
      * @param setCamOrtho
      */
     void setCamOrtho(const bool setCamOrtho);
+
+    /**
+     * @brief Reproject the LBG temporal history to the current view instead of discarding it
+     *        when the camera moves. Previous frames are clamped to the color range of the
+     *        current natural neighbors to reject disocclusions. Not used with an orthographic
+     *        camera.
+     * @param reprojection
+     */
+    void setReprojection(const bool reprojection);
+    bool getReprojection() const;
     /**
      * @brief Set show illumination kernel paramter.
      * @param illum
@@ -314,11 +548,44 @@ public:
 	void setGazePoint(cl_float2 gaze_point);
 
     /**
-     * @brief Get the execution time of the last kernel run.
+     * @brief Set the precision of output and intermediate images. Takes effect with the next
+     *        call of updateOutputImg.
+     * @param precision
+     */
+    void setImagePrecision(const image_precision precision);
+
+    /**
+     * @brief Get the precision of output and intermediate images.
+     */
+    image_precision getImagePrecision() const;
+
+    /**
+     * @brief Get the size of one output image pixel in bytes for the current precision.
+     */
+    size_t getBytesPerPixel() const;
+
+    /**
+     * @brief Get the execution time of the last frame, i.e. the sum of raycasting,
+     *        interpolation and history copy on the device.
      * @return The kernel runtime in seconds.
      */
     double getLastExecTime() const;
 
+    /**
+     * @brief Get the per stage timing record of the last completed frame.
+     */
+    FrameTiming getLastFrameTiming() const;
+
+    /**
+     * @brief Get the history of the most recent frame timings.
+     */
+    const FrameTimingHistory &getTimingHistory() const;
+
+    /**
+     * @brief Remove all frames from the timing history.
+     */
+    void clearTimingHistory();
+
 	/*
 	Updates the parameters of the raycast kernel according to the rendering method.
 	*/
@@ -345,6 +612,48 @@ public:
      */
     const std::string & getCurrentDeviceName() const;
 
+    /**
+     * @brief Get the size of all memory objects allocated by the renderer.
+     *        Only queries object info on the host, does not synchronize with the device.
+     * @return Allocated device memory in bytes.
+     */
+    size_t getDeviceMemoryUsage() const;
+
+    /**
+     * @brief Get the global memory size of the current device in bytes.
+     */
+    size_t getDeviceMemorySize() const;
+
+    /**
+     * @brief Get the current gaze point in normalized image coordinates.
+     */
+    cl_float2 getGazePoint() const;
+
+    /**
+     * @brief Get the number of samples in the loaded LBG sampling map, 0 if none is loaded.
+     */
+    size_t getLbgSampleCount() const;
+
+    /**
+     * @brief Get the number of previous frames used for LBG temporal blending.
+     */
+    cl_uint getFrameBlendCount() const;
+
+    /**
+     * @brief Set mode (moving average or frame array), depth and format of the LBG temporal
+     *        history. The history is cleared.
+     * @throws invalid_argument if the depth is 0.
+     */
+    void setTemporalHistory(const TemporalHistory::Parameters &parameters);
+    const TemporalHistory &getTemporalHistory() const;
+
+    /**
+     * @brief Get a counter that changes whenever a parameter influencing the rendered image
+     *        changes (view, transfer function, volume, gaze point, shading options, ...).
+     *        The time step is passed per frame and not covered.
+     */
+    uint64_t getParameterVersion() const;
+
     /**
      * @brief setAmbientOcclusion
      * @param ao
@@ -367,13 +676,58 @@ public:
      */
     void generateMipmaps(size_t levelCnt);
 
-private:
     /**
      * @brief Generate coarse grained volume bricks that can be used for ESS.
-     * @param volumeData
+     *        Called on volume load, public for benchmarking.
      */
     void generateBricks();
 
+private:
+
+    /**
+     * @brief Get the OpenCL image format of output and intermediate images.
+     */
+    cl::ImageFormat getImageFormat() const;
+
+    /**
+     * @brief Read the no-GL output image to host memory.
+     * @param width The image width in pixels.
+     * @param height The image height in pixels.
+     * @param output Host pointer with at least width*height*getBytesPerPixel() bytes.
+     */
+    void readOutputImg(const size_t width, const size_t height, void *output);
+
+    /**
+     * @brief Start recording the timing of a new frame.
+     */
+    void beginFrameTiming();
+
+    /**
+     * @brief Add a profiling event of one stage to the current frame.
+     *        Durations of several events of the same stage are accumulated.
+     */
+    void addTimingEvent(const timing_id id, const cl::Event &evt);
+
+    /**
+     * @brief Finish the current frame: query all profiling events, update the last execution
+     *        time and add the record to the timing history. Waits for the events to complete.
+     */
+    void endFrameTiming();
+
+    /**
+     * @brief Generate the reduced resolution ambient occlusion volume for a timestep,
+     *        based on the current transfer function.
+     * @param t Timestep of the volume data.
+     */
+    void generateAoVolume(const size_t t);
+
+    /**
+     * @brief Generate the 2D pre-integration table of the current transfer function from its
+     *        cumulative integral.
+     * @param tff RGBA values of the 1D transfer function.
+     */
+    void generatePreIntegrationTable(const std::vector<unsigned char> &tff);
+
     /**
      * @brief Downsample a volume data set.
      */
@@ -434,9 +788,39 @@ private:
 
 	/**
 	 * @brief Set OpenCL memory objects for interpolateLBG Kernel.
+	 * @param inTexId Input texture, ignored if OpenGL context sharing is not used.
+	 * @param outTexId Output texture, ignored if OpenGL context sharing is not used.
 	 */
 	void setMemObjectsInterpolationLBG(GLuint inTexId, GLuint outTexId);
 
+    /**
+     * @brief Enqueue the next refinement tiles with the current output image.
+     * @return true if all tiles have been enqueued.
+     */
+    bool enqueueRefinementTiles(const size_t width, const size_t height, const size_t t);
+
+    /**
+     * @brief Place the multi-resolution layers around the gaze point, reallocate their images
+     *        on size or format changes and enqueue the layer raycasts and the composition into
+     *        output. Raycast arguments have to be set before.
+     */
+    void enqueueMultiRes(const size_t width, const size_t height, const cl::Image &output);
+
+    /**
+     * @brief Enqueue pre-pass and shading rate estimation, read back the rates to build the
+     *        work groups of the main pass, then enqueue the main pass and the fill into output.
+     *        Raycast arguments have to be set before.
+     */
+    void enqueueVariableRate(const size_t width, const size_t height, const cl::Image &output);
+
+    bool storeHistoryFrame() const;
+
+    /**
+     * @brief Convert the native precision staging buffer _output to single precision.
+     * @param output converted pixel data
+     */
+    void convertOutput(std::vector<float> &output) const;
+
     /**
      * @brief Set OpenCL memory objects for brick generation kernel.
      * @param t number of volume timesteps.
@@ -465,7 +849,12 @@ private:
     cl::Kernel _raycastKernel;
     cl::Kernel _genBricksKernel;
     cl::Kernel _downsamplingKernel;
+    cl::Kernel _preIntegrateKernel;
+    cl::Kernel _genAoVolumeKernel;
 	cl::Kernel _interpolateLBGKernel;
+    cl::Kernel _composeMultiResKernel;
+    cl::Kernel _shadingRateKernel;
+    cl::Kernel _fillVariableRateKernel;
 
     std::vector<cl::Image3D> _volumesMem;
     std::vector<cl::Image3D> _bricksMem;
@@ -473,15 +862,25 @@ private:
 	cl::ImageGL _inputMem;	// Image Object to hold temporary Images like pre interpolation for LBG
     cl::Image1D _tffMem;
     cl::Image1D _tffPrefixMem;
+    cl::Image2D _tffPreIntMem;
+    cl::Image3D _aoVolMem;
+    cl::Image3D _place_holder_vol;
     cl::Image2D _outputMemNoGL;
+    cl::Image2D _inputMemNoGL;  // sparse LBG raycast result without GL context sharing
     cl::Image2D _outputHitMem;
     cl::Image2D _inputHitMem;
 	cl::Buffer _place_holder_smd;
 	cl::Image2D _place_holder_imap;
 	cl::Buffer _samplingMapData; // The width of the sample map defines the total number of work items to be started for lbg sampling raycast
 	cl::Image2D _indexMap;
-    cl::Image2DArray _lastFramesMem;
-    cl::Image2D _thisFrameMem;
+    TemporalHistory _history;   // LBG temporal blending
+    cl::Image2D _depthMem;      // representative depth per LBG sample, extent of the index map
+    std::array<cl::Image2D, 3> _multiResLayers;    // fovea, middle, periphery
+    cl::Image2D _ratePrepassMem;    // one ray per LOCAL_SIZE x LOCAL_SIZE pixels
+    cl::Image2D _rateMem;           // lattice step per tile
+    cl::Image2D _rateLatticeMem;    // traced pixels of the variable rate pass
+    cl::Buffer _rateGroupsMem;      // block origin and lattice step per work group, built on the device
+    cl::Buffer _rateGroupCountMem;
     cl::Buffer _neighborIdMap;
     cl::Buffer _neighborWeightMap;
     std::vector<cl::Image3D> _volMipmapsMem;
@@ -495,15 +894,49 @@ private:
     std::valarray<float> _modelScale;
     bool _useGL = true;
     bool _useImgESS = false;
+    bool _usePreIntegration = false;
+    image_precision _imgPrecision = PRECISION_UNORM8;
+    image_precision _allocatedPrecision = PRECISION_UNORM8;
+    std::array<size_t, 2> _outputImgSize = {{0, 0}};   // size of allocated output images
+    bool _useAO = false;
+    bool _aoValid = false;      // AO volume is up to date w.r.t. transfer function and data
+    size_t _aoTimestep = 0;
     std::string _currentDevice;
-    cl_uint _frameId = 0;
-    cl_uint _frameIpCnt = 8;    // max 8
     cl_uint _viewChanged = false;
     cl_uint _gazeChanged = false;
     cl_float2 _gazePoint = {{0,0}};
+    cl_float4 _background = {{1.f, 1.f, 1.f, 1.f}};     // host copy of the BACKGROUND argument
     size_t _currentTimestep = 0;
-
-    std::vector<float> _output;
+    uint64_t _parameterVersion = 0;
+    cl_uint _renderingMode = 0;
+    cl_float16 _viewMat = {{0}};
+    bool _orthoCam = false;
+    bool _useReprojection = false;
+
+    // progressive refinement of still LBG frames
+    std::vector<std::array<size_t, 2>> _refineTiles;   // tile origins, nearest to the gaze first
+    size_t _refineNext = 0;
+    uint64_t _refineVersion = UINT64_MAX;
+    size_t _refineTimestep = 0;
+    std::array<size_t, 2> _refineSize = {{0, 0}};
+    unsigned int _refinePasses = 16;
+
+    MultiResParameters _multiRes;
+    size_t _multiResRays = 0;
+
+    VariableRateParameters _variableRate;
+    size_t _ratePrepassRays = 0;
+    cl_uint _rateGroupCount = 0;            // read back without blocking, valid after the frame
+
+    std::vector<unsigned char> _output;    // host staging buffer for output image readback
+
+    FrameTimingHistory _timingHistory;
+    std::vector<std::pair<timing_id, cl::Event>> _timingEvents;   // events of the current frame
+    std::chrono::steady_clock::time_point _frameStart;
+    std::chrono::steady_clock::time_point _lastFrameStart;
+#ifdef KERNEL_COUNTERS
+    cl::Buffer _countersMem;    // COUNTER_COUNT uints, reset after every frame
+#endif
 
     DatRawReader _dr;
 };
@@ -0,0 +1,174 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/gaze/gazebuffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @brief gazeClock
+ * @return
+ */
+int64_t gazeClock()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief GazeBuffer::GazeBuffer
+ * @param capacity
+ */
+GazeBuffer::GazeBuffer(size_t capacity)
+    : _head(0)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    _slots.reset(new Slot[size]);
+    _mask = size - 1;
+}
+
+/**
+ * @brief GazeBuffer::push
+ * @param sample
+ */
+void GazeBuffer::push(const GazeSample &sample)
+{
+    const uint64_t head = _head.load(std::memory_order_relaxed);
+    Slot &slot = _slots[head & _mask];
+    const uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time.store(sample.time, std::memory_order_relaxed);
+    slot.deviceTime.store(sample.deviceTime, std::memory_order_relaxed);
+    slot.captureTime.store(sample.captureTime, std::memory_order_relaxed);
+    slot.x.store(sample.x, std::memory_order_relaxed);
+    slot.y.store(sample.y, std::memory_order_relaxed);
+    slot.valid.store(sample.valid, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+    _head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Copy one slot, fails if the producer wrote to it in the meantime.
+ * @param index Absolute sample index.
+ * @param sample
+ * @return
+ */
+bool GazeBuffer::read(const uint64_t index, GazeSample &sample) const
+{
+    const Slot &slot = _slots[index & _mask];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1u)
+        return false;
+    sample.time = slot.time.load(std::memory_order_relaxed);
+    sample.deviceTime = slot.deviceTime.load(std::memory_order_relaxed);
+    sample.captureTime = slot.captureTime.load(std::memory_order_relaxed);
+    sample.x = slot.x.load(std::memory_order_relaxed);
+    sample.y = slot.y.load(std::memory_order_relaxed);
+    sample.valid = slot.valid.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq)
+        return false;
+    // the slot may already hold a newer sample than the requested one
+    return _head.load(std::memory_order_acquire) - index <= _mask + 1;
+}
+
+/**
+ * @brief GazeBuffer::latest
+ * @param sample
+ * @return
+ */
+bool GazeBuffer::latest(GazeSample &sample) const
+{
+    const uint64_t head = _head.load(std::memory_order_acquire);
+    if (head == 0)
+        return false;
+    // retry with the new head if the producer wrapped around meanwhile
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint64_t index = _head.load(std::memory_order_acquire) - 1;
+        if (read(index, sample))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief GazeBuffer::latestValid
+ * @param sample
+ * @return
+ */
+bool GazeBuffer::latestValid(GazeSample &sample) const
+{
+    const uint64_t head = _head.load(std::memory_order_acquire);
+    const uint64_t count = std::min<uint64_t>(head, _mask + 1);
+    for (uint64_t i = 1; i <= count; ++i)
+    {
+        GazeSample s;
+        if (read(head - i, s) && s.valid)
+        {
+            sample = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief GazeBuffer::history
+ * @param samples
+ * @param count
+ * @param since
+ */
+void GazeBuffer::history(std::vector<GazeSample> &samples, const size_t count,
+                         const int64_t since) const
+{
+    samples.clear();
+    const uint64_t head = _head.load(std::memory_order_acquire);
+    const uint64_t n = std::min<uint64_t>({head, _mask + 1, count});
+    for (uint64_t i = head - n; i < head; ++i)
+    {
+        GazeSample s;
+        if (read(i, s) && s.time > since)
+            samples.push_back(s);
+    }
+}
+
+/**
+ * @brief GazeBuffer::pushed
+ * @return
+ */
+uint64_t GazeBuffer::pushed() const
+{
+    return _head.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief GazeBuffer::clear
+ */
+void GazeBuffer::clear()
+{
+    _head.store(0, std::memory_order_release);
+}
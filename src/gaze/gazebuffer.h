@@ -0,0 +1,120 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A single gaze sample in normalized display coordinates.
+ */
+struct GazeSample
+{
+    int64_t time = 0;       // host receive time in microseconds, see gazeClock()
+    int64_t deviceTime = 0; // time stamp of the tracker in microseconds, 0 if unknown
+    int64_t captureTime = 0;// capture time in gazeClock() microseconds, 0 if unknown
+    float x = 0.f;          // [0,1] from left to right
+    float y = 0.f;          // [0,1] from top to bottom
+    bool valid = false;
+};
+
+/**
+ * @brief Monotonic clock used for all gaze time stamps.
+ * @return Microseconds since an arbitrary, fixed point in time.
+ */
+int64_t gazeClock();
+
+/**
+ * @brief Lock-free single producer, single consumer ring buffer of gaze samples.
+ *        The producer (e.g. the eye tracker callback thread) never blocks and overwrites the
+ *        oldest samples if the consumer falls behind. Every slot is guarded by a sequence
+ *        counter, so the consumer (the render loop) never sees a partially written sample.
+ *        Samples that were overwritten while being read are skipped.
+ */
+class GazeBuffer
+{
+public:
+    /**
+     * @brief Create a ring buffer.
+     * @param capacity Number of samples, rounded up to the next power of two.
+     */
+    explicit GazeBuffer(size_t capacity = 512);
+
+    GazeBuffer(const GazeBuffer &) = delete;
+    GazeBuffer &operator=(const GazeBuffer &) = delete;
+
+    /**
+     * @brief Add a sample. Must only be called from the producer thread.
+     */
+    void push(const GazeSample &sample);
+
+    /**
+     * @brief Get the most recent sample.
+     * @return false if no sample has been pushed yet.
+     */
+    bool latest(GazeSample &sample) const;
+
+    /**
+     * @brief Get the most recent valid sample.
+     * @return false if none of the buffered samples is valid.
+     */
+    bool latestValid(GazeSample &sample) const;
+
+    /**
+     * @brief Get the most recent samples in chronological order, oldest first.
+     * @param samples Output, cleared before copying.
+     * @param count Maximum number of samples.
+     * @param since Only samples with a receive time larger than this are returned.
+     */
+    void history(std::vector<GazeSample> &samples, const size_t count,
+                 const int64_t since = INT64_MIN) const;
+
+    /**
+     * @brief Total number of samples pushed since construction or the last clear().
+     */
+    uint64_t pushed() const;
+
+    /**
+     * @brief Drop all samples. Must only be called while no producer is active.
+     */
+    void clear();
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> seq{0};   // odd while being written
+        std::atomic<int64_t> time{0};
+        std::atomic<int64_t> deviceTime{0};
+        std::atomic<int64_t> captureTime{0};
+        std::atomic<float> x{0.f};
+        std::atomic<float> y{0.f};
+        std::atomic<bool> valid{false};
+    };
+
+    bool read(const uint64_t index, GazeSample &sample) const;
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+    std::atomic<uint64_t> _head;    // number of pushed samples, written by the producer only
+};
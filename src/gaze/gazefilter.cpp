@@ -0,0 +1,269 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/gaze/gazefilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double PI = 3.14159265358979323846;
+
+/**
+ * @brief OneEuroFilter::OneEuroFilter
+ * @param minCutoff
+ * @param beta
+ * @param derivativeCutoff
+ */
+OneEuroFilter::OneEuroFilter(const double minCutoff, const double beta,
+                             const double derivativeCutoff)
+    : _minCutoff(minCutoff)
+    , _beta(beta)
+    , _derivativeCutoff(derivativeCutoff)
+{
+}
+
+/**
+ * @brief Smoothing factor of an exponential filter with the given cutoff frequency.
+ */
+double OneEuroFilter::alpha(const double cutoff, const double dt)
+{
+    const double tau = 1.0 / (2.0 * PI * cutoff);
+    return 1.0 / (1.0 + tau / dt);
+}
+
+/**
+ * @brief OneEuroFilter::filter
+ * @param value
+ * @param dt
+ * @return
+ */
+double OneEuroFilter::filter(const double value, const double dt)
+{
+    if (!_initialized || dt <= 0.0)
+    {
+        if (!_initialized)
+            _value = value;
+        _initialized = true;
+        return _value;
+    }
+    const double derivative = (value - _value) / dt;
+    const double ad = alpha(_derivativeCutoff, dt);
+    _derivative = ad * derivative + (1.0 - ad) * _derivative;
+    const double cutoff = _minCutoff + _beta * std::abs(_derivative);
+    const double a = alpha(cutoff, dt);
+    _value = a * value + (1.0 - a) * _value;
+    return _value;
+}
+
+void OneEuroFilter::reset()
+{
+    _initialized = false;
+    _derivative = 0.0;
+}
+
+/**
+ * @brief GazeFilter::GazeFilter
+ */
+GazeFilter::GazeFilter()
+    : GazeFilter(Parameters())
+{
+}
+
+/**
+ * @brief GazeFilter::GazeFilter
+ * @param params
+ */
+GazeFilter::GazeFilter(const Parameters &params)
+{
+    setParameters(params);
+}
+
+void GazeFilter::setParameters(const Parameters &params)
+{
+    _params = params;
+    _filterX = OneEuroFilter(params.minCutoff, params.beta);
+    _filterY = OneEuroFilter(params.minCutoff, params.beta);
+    reset();
+}
+
+const GazeFilter::Parameters &GazeFilter::getParameters() const
+{
+    return _params;
+}
+
+void GazeFilter::reset()
+{
+    _filterX.reset();
+    _filterY.reset();
+    _lastTime = INT64_MIN;
+    _filtered = GazeSample();
+    _window.clear();
+    _isFixation = false;
+}
+
+GazeSample GazeFilter::filtered() const
+{
+    return _filtered;
+}
+
+bool GazeFilter::isFixation() const
+{
+    return _isFixation;
+}
+
+/**
+ * @brief GazeFilter::fixation
+ * @return
+ */
+GazeSample GazeFilter::fixation() const
+{
+    GazeSample s = _filtered;
+    s.x = static_cast<float>(_fixation.x * _params.pixelsPerDegree / _params.displayWidth);
+    s.y = static_cast<float>(_fixation.y * _params.pixelsPerDegree / _params.displayHeight);
+    return s;
+}
+
+/**
+ * @brief GazeFilter::process
+ * @param sample
+ * @return
+ */
+GazeSample GazeFilter::process(const GazeSample &sample)
+{
+    if (!sample.valid || sample.time <= _lastTime)
+        return _filtered;
+
+    const double dt = _lastTime == INT64_MIN ? 0.0 : (sample.time - _lastTime) * 1e-6;
+    _lastTime = sample.time;
+    // filter in degrees, so the parameters do not depend on the display
+    Point p;
+    p.time = sample.time;
+    p.x = _filterX.filter(sample.x * _params.displayWidth / _params.pixelsPerDegree, dt);
+    p.y = _filterY.filter(sample.y * _params.displayHeight / _params.pixelsPerDegree, dt);
+    classify(p);
+
+    _filtered = sample;
+    _filtered.x = static_cast<float>(p.x * _params.pixelsPerDegree / _params.displayWidth);
+    _filtered.y = static_cast<float>(p.y * _params.pixelsPerDegree / _params.displayHeight);
+    return _filtered;
+}
+
+/**
+ * @brief GazeFilter::update
+ * @param history
+ * @return
+ */
+bool GazeFilter::update(const std::vector<GazeSample> &history)
+{
+    const int64_t last = _lastTime;
+    for (const GazeSample &s : history)
+        process(s);
+    return _lastTime != last;
+}
+
+/**
+ * @brief Sum of the extents of the current window in x and y, in degrees.
+ */
+double GazeFilter::dispersion() const
+{
+    if (_window.empty())
+        return 0.0;
+    const auto x = std::minmax_element(_window.begin(), _window.end(),
+                                       [](const Point &a, const Point &b) { return a.x < b.x; });
+    const auto y = std::minmax_element(_window.begin(), _window.end(),
+                                       [](const Point &a, const Point &b) { return a.y < b.y; });
+    return (x.second->x - x.first->x) + (y.second->y - y.first->y);
+}
+
+GazeFilter::Point GazeFilter::centroid() const
+{
+    Point c = {_window.empty() ? 0 : _window.back().time, 0.0, 0.0};
+    for (const Point &p : _window)
+    {
+        c.x += p.x;
+        c.y += p.y;
+    }
+    if (!_window.empty())
+    {
+        c.x /= _window.size();
+        c.y /= _window.size();
+    }
+    return c;
+}
+
+/**
+ * @brief Update the fixation state with a new filtered point.
+ */
+void GazeFilter::classify(const Point &p)
+{
+    const int64_t minDuration = static_cast<int64_t>(_params.minFixationDuration * 1e3);
+
+    // leaving the fixation area ends a fixation regardless of the method
+    if (_isFixation && std::hypot(p.x - _fixation.x, p.y - _fixation.y) > _params.dispersionThreshold)
+    {
+        _isFixation = false;
+        _window.clear();
+    }
+
+    if (_params.method == IVT)
+    {
+        if (!_window.empty())
+        {
+            const Point &prev = _window.back();
+            const double dt = std::max<int64_t>(p.time - prev.time, 1) * 1e-6;
+            if (std::hypot(p.x - prev.x, p.y - prev.y) / dt > _params.velocityThreshold)
+            {
+                _isFixation = false;
+                _window.clear();
+            }
+        }
+        _window.push_back(p);
+        if (!_isFixation && _window.back().time - _window.front().time >= minDuration)
+        {
+            _isFixation = true;
+            _fixation = centroid();
+        }
+        // the window is only needed until the fixation is established
+        if (_isFixation)
+            _window.erase(_window.begin(), _window.end() - 1);
+    }
+    else
+    {
+        _window.push_back(p);
+        if (_isFixation)
+        {
+            _window.erase(_window.begin(), _window.end() - 1);
+            return;
+        }
+        // shrink the window from the front until it is compact or too short
+        while (_window.back().time - _window.front().time >= minDuration)
+        {
+            if (dispersion() <= _params.dispersionThreshold)
+            {
+                _isFixation = true;
+                _fixation = centroid();
+                break;
+            }
+            _window.pop_front();
+        }
+    }
+}
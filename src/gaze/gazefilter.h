@@ -0,0 +1,146 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <deque>
+
+#include "src/gaze/gazebuffer.h"
+
+/**
+ * @brief One euro filter of a scalar signal (Casiez et al. 2012): a low pass filter whose
+ *        cutoff frequency increases with the speed of the signal, so tracker noise during
+ *        fixations is removed without adding much lag to fast movements.
+ */
+class OneEuroFilter
+{
+public:
+    OneEuroFilter(const double minCutoff = 1.0, const double beta = 0.01,
+                  const double derivativeCutoff = 1.0);
+
+    /**
+     * @brief Filter the next value.
+     * @param value Raw value.
+     * @param dt Time since the previous value in seconds.
+     * @return Filtered value.
+     */
+    double filter(const double value, const double dt);
+
+    void reset();
+
+private:
+    static double alpha(const double cutoff, const double dt);
+
+    double _minCutoff;
+    double _beta;
+    double _derivativeCutoff;
+    bool _initialized = false;
+    double _value = 0.0;
+    double _derivative = 0.0;
+};
+
+/**
+ * @brief Filters gaze samples and classifies them into fixations and saccades.
+ *        Positions are smoothed with a one euro filter in degrees visual angle. Fixations are
+ *        detected with a velocity threshold (I-VT) or a dispersion threshold (I-DT) and have to
+ *        last for a minimum duration. While a fixation lasts, its position (the centroid of the
+ *        samples that established it) stays constant, so the renderer can keep its image.
+ */
+class GazeFilter
+{
+public:
+    enum Method
+    {
+          IVT = 0   // velocity threshold identification
+        , IDT       // dispersion threshold identification
+    };
+
+    struct Parameters
+    {
+        bool enabled = false;
+        Method method = IVT;
+        double pixelsPerDegree = 40.0;      // display resolution in pixels per degree visual angle
+        double displayWidth = 1920.0;       // pixels
+        double displayHeight = 1080.0;      // pixels
+        double minCutoff = 1.0;             // Hz, one euro filter cutoff at rest
+        double beta = 0.01;                 // one euro filter speed coefficient, per degree
+        double velocityThreshold = 30.0;    // deg/s, I-VT
+        double dispersionThreshold = 1.0;   // deg, I-DT and maximum drift of a fixation
+        double minFixationDuration = 100.0; // ms
+    };
+
+    GazeFilter();
+    explicit GazeFilter(const Parameters &params);
+
+    void setParameters(const Parameters &params);
+    const Parameters &getParameters() const;
+
+    /**
+     * @brief Filter and classify the next sample. Samples must be passed in chronological
+     *        order, invalid samples are ignored.
+     * @return The filtered sample.
+     */
+    GazeSample process(const GazeSample &sample);
+
+    /**
+     * @brief Process all samples of a history that are newer than the last processed one.
+     * @return false if there was no new valid sample.
+     */
+    bool update(const std::vector<GazeSample> &history);
+
+    /**
+     * @brief Most recent filtered sample.
+     */
+    GazeSample filtered() const;
+
+    /**
+     * @brief True while the gaze is in a fixation.
+     */
+    bool isFixation() const;
+
+    /**
+     * @brief Position of the current fixation, only meaningful while isFixation() is true.
+     */
+    GazeSample fixation() const;
+
+    void reset();
+
+private:
+    struct Point
+    {
+        int64_t time;
+        double x;   // degrees
+        double y;   // degrees
+    };
+
+    double dispersion() const;
+    Point centroid() const;
+    void classify(const Point &p);
+
+    Parameters _params;
+    OneEuroFilter _filterX;
+    OneEuroFilter _filterY;
+    int64_t _lastTime = INT64_MIN;
+    GazeSample _filtered;
+    std::deque<Point> _window;      // samples of the current (candidate) fixation
+    bool _isFixation = false;
+    Point _fixation = {0, 0.0, 0.0};
+};
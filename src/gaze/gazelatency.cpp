@@ -0,0 +1,201 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "src/gaze/gazelatency.h"
+
+#include <algorithm>
+#include <sstream>
+
+static const char * const STAGE_NAMES[STAGE_COUNT] =
+{
+    "capture", "receive", "gaze", "render", "draw", "present"
+};
+
+const char *latencyStageName(const latency_stage stage)
+{
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "";
+}
+
+/**
+ * @brief FrameLatency::interval
+ * @param from
+ * @param to
+ * @return
+ */
+double FrameLatency::interval(const latency_stage from, const latency_stage to) const
+{
+    if (stamps.at(from) == 0 || stamps.at(to) == 0)
+        return 0.0;
+    return (stamps.at(to) - stamps.at(from)) * 1e-6;
+}
+
+/**
+ * @brief FrameLatency::duration
+ * @param stage
+ * @return
+ */
+double FrameLatency::duration(const latency_stage stage) const
+{
+    if (stage == STAGE_CAPTURE || stage >= STAGE_COUNT || stamps.at(stage) == 0)
+        return 0.0;
+    // e.g. headless frames are presented without a draw stage
+    int previous = stage - 1;
+    while (previous > STAGE_CAPTURE && stamps.at(previous) == 0)
+        --previous;
+    return interval(static_cast<latency_stage>(previous), stage);
+}
+
+double FrameLatency::total() const
+{
+    return interval(STAGE_CAPTURE, STAGE_PRESENT);
+}
+
+/**
+ * @brief LatencyRecorder::LatencyRecorder
+ * @param capacity
+ */
+LatencyRecorder::LatencyRecorder(const size_t capacity)
+    : _frames(std::max(capacity, static_cast<size_t>(1)))
+    , _next(0)
+    , _count(0)
+    , _started(false)
+{
+}
+
+/**
+ * @brief LatencyRecorder::begin
+ * @param sample
+ */
+void LatencyRecorder::begin(const GazeSample &sample)
+{
+    _current = FrameLatency();
+    _current.stamps.at(STAGE_RECEIVE) = sample.time;
+    _current.stamps.at(STAGE_CAPTURE) = sample.captureTime != 0 ? sample.captureTime
+                                                                : sample.time;
+    _current.stamps.at(STAGE_GAZE) = gazeClock();
+    _started = sample.time != 0;
+}
+
+/**
+ * @brief LatencyRecorder::stamp
+ * @param stage
+ */
+void LatencyRecorder::stamp(const latency_stage stage)
+{
+    if (_started && stage < STAGE_COUNT)
+        _current.stamps.at(stage) = gazeClock();
+}
+
+/**
+ * @brief LatencyRecorder::present
+ * @return
+ */
+bool LatencyRecorder::present()
+{
+    if (!_started)
+        return false;
+    _current.stamps.at(STAGE_PRESENT) = gazeClock();
+    _frames.at(_next) = _current;
+    _next = (_next + 1) % _frames.size();
+    _count = std::min(_count + 1, _frames.size());
+    _started = false;
+    return true;
+}
+
+void LatencyRecorder::cancel()
+{
+    _started = false;
+}
+
+void LatencyRecorder::clear()
+{
+    _next = 0;
+    _count = 0;
+    _started = false;
+}
+
+size_t LatencyRecorder::size() const
+{
+    return _count;
+}
+
+FrameLatency LatencyRecorder::last() const
+{
+    if (_count == 0)
+        return FrameLatency();
+    return _frames.at((_next + _frames.size() - 1) % _frames.size());
+}
+
+/**
+ * @brief LatencyRecorder::getStats Stages that were not stamped in a frame, e.g. the draw
+ *        stage of a headless frame, are skipped.
+ * @param from
+ * @param to
+ * @return
+ */
+TimingStats LatencyRecorder::getStats(const latency_stage from, const latency_stage to) const
+{
+    std::vector<double> v;
+    v.reserve(_count);
+    for (size_t i = 0; i < _count; ++i)
+    {
+        const FrameLatency &f = _frames.at(i);
+        if (f.stamps.at(from) != 0 && f.stamps.at(to) != 0)
+            v.push_back(f.interval(from, to));
+    }
+    return calcTimingStats(v);
+}
+
+/**
+ * @brief LatencyRecorder::getStageStats
+ * @param stage
+ * @return
+ */
+TimingStats LatencyRecorder::getStageStats(const latency_stage stage) const
+{
+    std::vector<double> v;
+    v.reserve(_count);
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (stage < STAGE_COUNT && _frames.at(i).stamps.at(stage) != 0)
+            v.push_back(_frames.at(i).duration(stage));
+    }
+    return calcTimingStats(v);
+}
+
+/**
+ * @brief LatencyRecorder::toString
+ * @return
+ */
+std::string LatencyRecorder::toString() const
+{
+    std::ostringstream ss;
+    ss << "frames " << _count;
+    const TimingStats total = getStats(STAGE_CAPTURE, STAGE_PRESENT);
+    ss << "; total " << total.min << " " << total.mean << " " << total.p95 << " " << total.p99;
+    for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+    {
+        const TimingStats s = getStageStats(static_cast<latency_stage>(i));
+        ss << "; " << latencyStageName(static_cast<latency_stage>(i)) << " " << s.min << " "
+           << s.mean << " " << s.p95 << " " << s.p99;
+    }
+    return ss.str();
+}
@@ -0,0 +1,151 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/core/frametiming.h"
+#include "src/gaze/gazebuffer.h"
+
+/**
+ * @brief Stages of the gaze-to-photon path of a frame, in the order they are passed.
+ */
+enum latency_stage
+{
+      STAGE_CAPTURE = 0     // gaze sample captured by the eye tracker, receive time if unknown
+    , STAGE_RECEIVE         // gaze sample received by the host
+    , STAGE_GAZE            // gaze point read by the render loop
+    , STAGE_RENDER          // raycasting finished on the device
+    , STAGE_DRAW            // frame and overlays drawn into the back buffer
+    , STAGE_PRESENT         // buffers swapped (GUI) or frame read back (headless)
+    , STAGE_COUNT
+};
+
+/**
+ * @brief Get a short, human readable name of a stage.
+ */
+const char *latencyStageName(const latency_stage stage);
+
+/**
+ * @brief Time stamps of a single frame along the gaze-to-photon path.
+ */
+struct FrameLatency
+{
+    FrameLatency() { stamps.fill(0); }
+
+    /**
+     * @brief Time from one stage to another in seconds, 0 if either was not recorded.
+     */
+    double interval(const latency_stage from, const latency_stage to) const;
+
+    /**
+     * @brief Time spent in a stage, from the previous recorded stage to this one in seconds.
+     *        0 for the capture stage and stages that were not recorded.
+     */
+    double duration(const latency_stage stage) const;
+
+    /**
+     * @brief Time from the capture of the gaze sample to the presentation in seconds.
+     */
+    double total() const;
+
+    std::array<int64_t, STAGE_COUNT> stamps;    // gazeClock() microseconds, 0 if not recorded
+};
+
+/**
+ * @brief Records the gaze-to-photon latency of the most recent frames. A frame is started
+ *        with the gaze sample it uses, the following stages are stamped by the render loop
+ *        and the frame is recorded when it is presented. Frames without a gaze sample are
+ *        not recorded, the display's own latency after the buffer swap is not included.
+ */
+class LatencyRecorder
+{
+public:
+    explicit LatencyRecorder(const size_t capacity = 512);
+
+    /**
+     * @brief Start a frame with the newest measured gaze sample it uses. Stamps capture,
+     *        receive and gaze stages, replaces a started frame that was not presented.
+     */
+    void begin(const GazeSample &sample);
+
+    /**
+     * @brief Stamp a stage of the started frame with the current time. Ignored if no frame
+     *        has been started.
+     */
+    void stamp(const latency_stage stage);
+
+    /**
+     * @brief Stamp the present stage and record the started frame.
+     * @return false if no frame has been started.
+     */
+    bool present();
+
+    /**
+     * @brief Drop the started frame without recording it.
+     */
+    void cancel();
+
+    /**
+     * @brief Remove all recorded frames.
+     */
+    void clear();
+
+    /**
+     * @brief Number of recorded frames.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Get the most recently presented frame. Returns an empty record if no frame has
+     *        been recorded.
+     */
+    FrameLatency last() const;
+
+    /**
+     * @brief Get min, mean, 95th and 99th percentile of the time between two stages in seconds
+     *        over all recorded frames.
+     */
+    TimingStats getStats(const latency_stage from, const latency_stage to) const;
+
+    /**
+     * @brief Get min, mean, 95th and 99th percentile of the duration of a stage in seconds
+     *        over all recorded frames that passed it.
+     */
+    TimingStats getStageStats(const latency_stage stage) const;
+
+    /**
+     * @brief Get the statistics of the total latency and of every stage as a single line,
+     *        e.g. for logging.
+     */
+    std::string toString() const;
+
+private:
+    std::vector<FrameLatency> _frames;
+    size_t _next;
+    size_t _count;
+    FrameLatency _current;
+    bool _started;
+};
@@ -0,0 +1,241 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/gaze/gazepredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief GazePredictor::GazePredictor
+ */
+GazePredictor::GazePredictor()
+    : GazePredictor(Parameters())
+{
+}
+
+/**
+ * @brief GazePredictor::GazePredictor
+ * @param params
+ */
+GazePredictor::GazePredictor(const Parameters &params)
+    : _params(params)
+{
+}
+
+void GazePredictor::setParameters(const Parameters &params)
+{
+    _params = params;
+}
+
+const GazePredictor::Parameters &GazePredictor::getParameters() const
+{
+    return _params;
+}
+
+bool GazePredictor::inSaccade() const
+{
+    return _inSaccade;
+}
+
+GazePredictor::Stats GazePredictor::getStats() const
+{
+    return _stats;
+}
+
+void GazePredictor::resetStats()
+{
+    _stats = Stats();
+    _pending.clear();
+}
+
+/**
+ * @brief Convert a distance in normalized display coordinates to degrees visual angle.
+ */
+double GazePredictor::toDegrees(const float dx, const float dy) const
+{
+    return std::hypot(dx*_params.displayWidth, dy*_params.displayHeight) / _params.pixelsPerDegree;
+}
+
+/**
+ * @brief GazePredictor::predict
+ * @param history
+ * @param target
+ * @return
+ */
+GazeSample GazePredictor::predict(const std::vector<GazeSample> &history, const int64_t target)
+{
+    std::vector<GazeSample> valid;
+    valid.reserve(history.size());
+    std::copy_if(history.begin(), history.end(), std::back_inserter(valid),
+                 [](const GazeSample &s) { return s.valid; });
+    if (valid.empty())
+        return GazeSample();
+
+    const GazeSample last = valid.back();
+    GazeSample prediction = last;
+    prediction.time = target;
+    if (!_params.enabled || valid.size() < 2)
+        return prediction;
+
+    // least squares velocity over the most recent samples, in normalized units per second
+    const int64_t windowStart = last.time - static_cast<int64_t>(_params.velocityWindow*1000.0);
+    size_t first = valid.size() - 2;
+    while (first > 0 && valid.at(first - 1).time >= windowStart)
+        --first;
+    double mt = 0.0, mx = 0.0, my = 0.0;
+    const double n = static_cast<double>(valid.size() - first);
+    for (size_t i = first; i < valid.size(); ++i)
+    {
+        mt += (valid.at(i).time - last.time) * 1e-6;
+        mx += valid.at(i).x;
+        my += valid.at(i).y;
+    }
+    mt /= n; mx /= n; my /= n;
+    double stt = 0.0, stx = 0.0, sty = 0.0;
+    for (size_t i = first; i < valid.size(); ++i)
+    {
+        const double t = (valid.at(i).time - last.time) * 1e-6 - mt;
+        stt += t*t;
+        stx += t*(valid.at(i).x - mx);
+        sty += t*(valid.at(i).y - my);
+    }
+    const double vx = stt > 0.0 ? stx / stt : 0.0;
+    const double vy = stt > 0.0 ? sty / stt : 0.0;
+    const double speed = toDegrees(static_cast<float>(vx), static_cast<float>(vy));
+    const double horizon = std::min(std::max(0.0, (target - last.time) * 1e-6),
+                                    _params.maxHorizon * 1e-3);
+
+    if (speed > _params.saccadeVelocity)
+    {
+        if (!_inSaccade)
+        {
+            // onset: walk back to the last sample before the eye started to accelerate
+            size_t start = valid.size() - 1;
+            while (start > 0)
+            {
+                const GazeSample &a = valid.at(start - 1);
+                const GazeSample &b = valid.at(start);
+                const double dt = std::max<int64_t>(b.time - a.time, 1) * 1e-6;
+                if (toDegrees(b.x - a.x, b.y - a.y) / dt < _params.saccadeVelocity / 3.0)
+                    break;
+                --start;
+            }
+            _saccadeStart = valid.at(start == valid.size() - 1 ? first : start);
+            _saccadePeak = 0.0;
+            _inSaccade = true;
+        }
+        _saccadePeak = std::max(_saccadePeak, speed);
+
+        // main sequence: a minimum jerk saccade of amplitude A and duration D = a + b*A peaks
+        // at 1.875 A/D, solved for A. While the eye still accelerates this is a lower bound.
+        const double a = _params.durationIntercept * 1e-3;
+        const double b = _params.durationSlope * 1e-3;
+        const double peak = std::min(_saccadePeak, 0.95 * 1.875 / b);
+        const double travelled = toDegrees(last.x - _saccadeStart.x, last.y - _saccadeStart.y);
+        const double amplitude = std::max(a*peak / (1.875 - b*peak), travelled);
+        const double duration = (a + b*amplitude) * 1e6;     // us
+
+        double dx = (last.x - _saccadeStart.x) * _params.displayWidth;
+        double dy = (last.y - _saccadeStart.y) * _params.displayHeight;
+        if (travelled <= 0.0)
+        {
+            dx = vx * _params.displayWidth;
+            dy = vy * _params.displayHeight;
+        }
+        const double len = std::hypot(dx, dy);
+        if (len > 0.0)
+        {
+            const double tau = std::min(std::max((last.time + horizon*1e6 - _saccadeStart.time)
+                                                 / duration, 0.0), 1.0);
+            const double s = amplitude * _params.pixelsPerDegree
+                    * tau*tau*tau*(10.0 - 15.0*tau + 6.0*tau*tau);
+            prediction.x = static_cast<float>(_saccadeStart.x + s*dx/len / _params.displayWidth);
+            prediction.y = static_cast<float>(_saccadeStart.y + s*dy/len / _params.displayHeight);
+        }
+    }
+    else
+    {
+        _inSaccade = false;
+        if (speed > _params.pursuitVelocity)
+        {
+            prediction.x = static_cast<float>(last.x + vx*horizon);
+            prediction.y = static_cast<float>(last.y + vy*horizon);
+        }
+    }
+    prediction.x = std::min(std::max(prediction.x, 0.f), 1.f);
+    prediction.y = std::min(std::max(prediction.y, 0.f), 1.f);
+
+    // remember for evaluation against the measured gaze
+    Evaluation e;
+    e.time = last.time;
+    e.target = last.time + static_cast<int64_t>(horizon*1e6);
+    e.predicted[0] = prediction.x;
+    e.predicted[1] = prediction.y;
+    e.raw[0] = last.x;
+    e.raw[1] = last.y;
+    _pending.push_back(e);
+    while (_pending.size() > 256)
+        _pending.pop_front();
+    return prediction;
+}
+
+/**
+ * @brief GazePredictor::evaluate
+ * @param history
+ * @param report
+ */
+void GazePredictor::evaluate(const std::vector<GazeSample> &history,
+                             const std::function<void(const Evaluation &)> &report)
+{
+    std::vector<GazeSample> valid;
+    std::copy_if(history.begin(), history.end(), std::back_inserter(valid),
+                 [](const GazeSample &s) { return s.valid; });
+    if (valid.size() < 2)
+        return;
+
+    while (!_pending.empty() && _pending.front().target <= valid.back().time)
+    {
+        Evaluation e = _pending.front();
+        _pending.pop_front();
+        const auto next = std::lower_bound(valid.begin(), valid.end(), e.target,
+                                           [](const GazeSample &s, const int64_t t) {
+            return s.time < t;
+        });
+        if (next == valid.begin())
+            continue;   // target older than the history
+        const GazeSample &a = *(next - 1);
+        const GazeSample &b = *next;
+        const double w = b.time > a.time ? static_cast<double>(e.target - a.time) / (b.time - a.time)
+                                         : 1.0;
+        e.actual[0] = static_cast<float>(a.x + w*(b.x - a.x));
+        e.actual[1] = static_cast<float>(a.y + w*(b.y - a.y));
+        e.predictedError = toDegrees(e.predicted[0] - e.actual[0], e.predicted[1] - e.actual[1]);
+        e.rawError = toDegrees(e.raw[0] - e.actual[0], e.raw[1] - e.actual[1]);
+
+        _stats.count++;
+        _stats.predictedError += (e.predictedError - _stats.predictedError) / _stats.count;
+        _stats.rawError += (e.rawError - _stats.rawError) / _stats.count;
+        if (report)
+            report(e);
+    }
+}
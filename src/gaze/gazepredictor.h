@@ -0,0 +1,120 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "src/gaze/gazebuffer.h"
+
+/**
+ * @brief Predicts the gaze position at the expected display time of a frame to hide the
+ *        latency of the foveated pipeline.
+ *        Fixations keep the last position, smooth pursuit is extrapolated linearly. Saccades are
+ *        detected by a velocity threshold, their amplitude is estimated from the peak velocity
+ *        with the main sequence (linear duration, minimum jerk velocity profile) and the position
+ *        follows that profile towards the predicted landing point.
+ *        Predictions are later compared to the gaze actually measured at their target time.
+ */
+class GazePredictor
+{
+public:
+    struct Parameters
+    {
+        bool enabled = false;               // without prediction the latest sample is used
+        double pixelsPerDegree = 40.0;      // display resolution in pixels per degree visual angle
+        double displayWidth = 1920.0;       // pixels
+        double displayHeight = 1080.0;      // pixels
+        double saccadeVelocity = 75.0;      // deg/s, saccade onset threshold
+        double pursuitVelocity = 5.0;       // deg/s, slower movement is treated as fixation
+        double velocityWindow = 10.0;       // ms of samples used to estimate the velocity
+        double maxHorizon = 60.0;           // ms, predictions are clamped to this horizon
+        double durationIntercept = 21.0;    // ms, main sequence saccade duration at 0 deg
+        double durationSlope = 2.2;         // ms/deg, main sequence duration increase
+    };
+
+    /**
+     * @brief A prediction compared to the gaze measured at its target time.
+     */
+    struct Evaluation
+    {
+        int64_t time = 0;       // time the prediction was made [us]
+        int64_t target = 0;     // predicted display time [us]
+        float predicted[2] = {0.f, 0.f};
+        float raw[2] = {0.f, 0.f};      // latest sample when predicting, i.e. without prediction
+        float actual[2] = {0.f, 0.f};
+        double predictedError = 0.0;    // degrees
+        double rawError = 0.0;          // degrees
+    };
+
+    /**
+     * @brief Mean errors of all evaluated predictions in degrees.
+     */
+    struct Stats
+    {
+        uint64_t count = 0;
+        double predictedError = 0.0;
+        double rawError = 0.0;
+    };
+
+    GazePredictor();
+    explicit GazePredictor(const Parameters &params);
+
+    void setParameters(const Parameters &params);
+    const Parameters &getParameters() const;
+
+    /**
+     * @brief Predict the gaze position at a given time.
+     * @param history Recent samples in chronological order, see GazeBuffer::history.
+     * @param target Expected display time in gazeClock() microseconds.
+     * @return The predicted sample with time set to target. Invalid if the history does not
+     *         contain a valid sample. Without prediction enabled, the latest valid sample.
+     */
+    GazeSample predict(const std::vector<GazeSample> &history, const int64_t target);
+
+    /**
+     * @brief Compare pending predictions whose target time is covered by the history to the
+     *        actual gaze, interpolated linearly between the enclosing samples.
+     * @param report Called for every evaluated prediction, e.g. for logging.
+     */
+    void evaluate(const std::vector<GazeSample> &history,
+                  const std::function<void(const Evaluation &)> &report = nullptr);
+
+    /**
+     * @brief True if the last prediction was made during a saccade.
+     */
+    bool inSaccade() const;
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    double toDegrees(const float dx, const float dy) const;
+
+    Parameters _params;
+    bool _inSaccade = false;
+    GazeSample _saccadeStart;
+    double _saccadePeak = 0.0;
+    std::deque<Evaluation> _pending;
+    Stats _stats;
+};
@@ -0,0 +1,121 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/gaze/gazeprocessor.h"
+
+GazeFilter &GazeProcessor::filter()
+{
+    return _filter;
+}
+
+const GazeFilter &GazeProcessor::filter() const
+{
+    return _filter;
+}
+
+GazePredictor &GazeProcessor::predictor()
+{
+    return _predictor;
+}
+
+const GazePredictor &GazeProcessor::predictor() const
+{
+    return _predictor;
+}
+
+void GazeProcessor::setDisplayLatency(const double latency)
+{
+    _displayLatency = latency;
+}
+
+double GazeProcessor::getDisplayLatency() const
+{
+    return _displayLatency;
+}
+
+/**
+ * @brief GazeProcessor::setDisplaySize
+ * @param width
+ * @param height
+ */
+void GazeProcessor::setDisplaySize(const double width, const double height)
+{
+    GazeFilter::Parameters filterParams = _filter.getParameters();
+    filterParams.displayWidth = width;
+    filterParams.displayHeight = height;
+    _filter.setParameters(filterParams);
+    GazePredictor::Parameters predictorParams = _predictor.getParameters();
+    predictorParams.displayWidth = width;
+    predictorParams.displayHeight = height;
+    _predictor.setParameters(predictorParams);
+}
+
+/**
+ * @brief GazeProcessor::process
+ * @param buffer
+ * @param frameTime
+ * @param sample
+ * @param report
+ * @return
+ */
+bool GazeProcessor::process(const GazeBuffer &buffer, const double frameTime, GazeSample &sample,
+                            const std::function<void(const GazePredictor::Evaluation &)> &report)
+{
+    GazeSample latest;
+    if (!buffer.latestValid(latest))
+        return false;
+    sample = latest;
+    _input = latest;
+
+    buffer.history(_history, 128);
+    if (_filter.getParameters().enabled)
+    {
+        _filter.update(_history);
+        sample = _filter.isFixation() ? _filter.fixation() : _filter.filtered();
+    }
+    if (_predictor.getParameters().enabled)
+    {
+        _predictor.evaluate(_history, report);
+        const int64_t displayTime = gazeClock()
+                + static_cast<int64_t>((frameTime*1e3 + _displayLatency) * 1e3);
+        const GazeSample predicted = _predictor.predict(_history, displayTime);
+        if (predicted.valid && !(_filter.getParameters().enabled && _filter.isFixation()))
+            sample = predicted;
+    }
+    return true;
+}
+
+const GazeSample &GazeProcessor::lastInput() const
+{
+    return _input;
+}
+
+/**
+ * @brief GazeProcessor::reset
+ */
+void GazeProcessor::reset()
+{
+    _input = GazeSample();
+    _filter.reset();
+    _predictor.resetStats();
+    _history.clear();
+}
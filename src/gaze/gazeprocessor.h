@@ -0,0 +1,86 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "src/gaze/gazebuffer.h"
+#include "src/gaze/gazefilter.h"
+#include "src/gaze/gazepredictor.h"
+
+/**
+ * @brief Gaze processing shared by the GUI and the command line renderer: reads the samples
+ *        received since the last frame from a GazeBuffer, filters and classifies them and
+ *        predicts the gaze at the expected display time of the next frame.
+ */
+class GazeProcessor
+{
+public:
+    GazeFilter &filter();
+    const GazeFilter &filter() const;
+    GazePredictor &predictor();
+    const GazePredictor &predictor() const;
+
+    /**
+     * @brief Set the time from the end of a frame until it is visible.
+     * @param latency Latency in milliseconds.
+     */
+    void setDisplayLatency(const double latency);
+    double getDisplayLatency() const;
+
+    /**
+     * @brief Set the display size used by filter and predictor to convert to degrees.
+     */
+    void setDisplaySize(const double width, const double height);
+
+    /**
+     * @brief Get the gaze point for the next frame. During a fixation its position is kept,
+     *        otherwise the gaze is predicted to now + frameTime + display latency, or the
+     *        filtered or latest valid sample is used if filter or prediction are disabled.
+     * @param buffer Samples of the gaze source.
+     * @param frameTime Expected duration of the frame in seconds, e.g. the last frame time.
+     * @param sample Output gaze sample.
+     * @param report Called for every earlier prediction compared to the measured gaze.
+     * @return false if the buffer does not contain a valid sample.
+     */
+    bool process(const GazeBuffer &buffer, const double frameTime, GazeSample &sample,
+                 const std::function<void(const GazePredictor::Evaluation &)> &report = nullptr);
+
+    /**
+     * @brief Get the newest measured sample the last processed gaze point is based on,
+     *        e.g. to measure the latency from its capture to the display of the frame.
+     */
+    const GazeSample &lastInput() const;
+
+    /**
+     * @brief Forget all samples, e.g. when the gaze source is restarted.
+     */
+    void reset();
+
+private:
+    GazeSample _input;
+    std::vector<GazeSample> _history;
+    GazeFilter _filter;
+    GazePredictor _predictor;
+    double _displayLatency = 16.0;
+};
@@ -0,0 +1,299 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "src/gaze/gazesource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QUdpSocket>
+
+/**
+ * @brief GazeSource::GazeSource
+ * @param buffer
+ */
+GazeSource::GazeSource(GazeBuffer &buffer)
+    : _buffer(buffer)
+{
+}
+
+GazeSource::~GazeSource()
+{
+}
+
+
+/**
+ * @brief MouseGazeSource::MouseGazeSource
+ * @param buffer
+ */
+MouseGazeSource::MouseGazeSource(GazeBuffer &buffer)
+    : GazeSource(buffer)
+{
+}
+
+bool MouseGazeSource::start()
+{
+    _running = true;
+    return true;
+}
+
+void MouseGazeSource::stop()
+{
+    _running = false;
+}
+
+bool MouseGazeSource::isRunning() const
+{
+    return _running;
+}
+
+QString MouseGazeSource::name() const
+{
+    return QString("mouse");
+}
+
+/**
+ * @brief MouseGazeSource::setPosition
+ * @param x
+ * @param y
+ */
+void MouseGazeSource::setPosition(const float x, const float y)
+{
+    if (!_running)
+        return;
+    GazeSample sample;
+    sample.time = gazeClock();
+    sample.x = x;
+    sample.y = y;
+    sample.valid = true;
+    _buffer.push(sample);
+}
+
+
+/**
+ * @brief ReplayGazeSource::ReplayGazeSource
+ * @param buffer
+ * @param source
+ * @param loop
+ */
+ReplayGazeSource::ReplayGazeSource(GazeBuffer &buffer, const QString &source, const bool loop)
+    : GazeSource(buffer)
+    , _source(source)
+    , _loop(loop)
+    , _running(false)
+{
+}
+
+ReplayGazeSource::~ReplayGazeSource()
+{
+    stop();
+}
+
+/**
+ * @brief ReplayGazeSource::start
+ * @return
+ */
+bool ReplayGazeSource::start()
+{
+    stop();
+    if (_source.startsWith("udp:"))
+    {
+        bool ok = false;
+        const uint port = _source.mid(4).toUInt(&ok);
+        if (!ok || port == 0 || port > 65535)
+        {
+            std::cerr << "Invalid gaze source port: " << _source.toStdString() << std::endl;
+            return false;
+        }
+        _running = true;
+        _thread = std::thread(&ReplayGazeSource::receiveLoop, this, static_cast<quint16>(port));
+        return true;
+    }
+
+    try
+    {
+        _samples = readGazeLog(_source);
+    }
+    catch (std::invalid_argument e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    if (_samples.empty())
+    {
+        std::cerr << "No gaze samples in " << _source.toStdString() << std::endl;
+        return false;
+    }
+    _running = true;
+    _thread = std::thread(&ReplayGazeSource::replayLoop, this);
+    return true;
+}
+
+/**
+ * @brief ReplayGazeSource::stop
+ */
+void ReplayGazeSource::stop()
+{
+    _running = false;
+    if (_thread.joinable())
+        _thread.join();
+}
+
+/**
+ * @brief ReplayGazeSource::isRunning
+ * @return false after a replay without loop reached the end of the file.
+ */
+bool ReplayGazeSource::isRunning() const
+{
+    return _running;
+}
+
+QString ReplayGazeSource::name() const
+{
+    return _source;
+}
+
+/**
+ * @brief ReplayGazeSource::parseSample
+ * @param line
+ * @param sample
+ * @return
+ */
+bool ReplayGazeSource::parseSample(const QString &line, GazeSample &sample)
+{
+    const QStringList fields = line.split(';');
+    QString position = fields.first();
+    if (fields.size() >= 3)
+    {
+        if (fields.at(1).trimmed() != "gaze")
+            return false;
+        bool ok = false;
+        const double ms = fields.at(0).trimmed().toDouble(&ok);
+        if (!ok)
+            return false;
+        sample.deviceTime = static_cast<int64_t>(ms * 1e3);
+        position = fields.at(2);
+    }
+    else if (fields.size() != 1)
+        return false;
+
+    const QStringList xy = position.simplified().split(' ');
+    if (xy.size() != 2)
+        return false;
+    bool okX = false;
+    bool okY = false;
+    sample.x = xy.at(0).toFloat(&okX);
+    sample.y = xy.at(1).toFloat(&okY);
+    sample.valid = okX && okY;
+    return sample.valid;
+}
+
+/**
+ * @brief ReplayGazeSource::readGazeLog
+ * @param fileName
+ * @return
+ */
+std::vector<GazeSample> ReplayGazeSource::readGazeLog(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        throw std::invalid_argument("Could not open gaze log " + fileName.toStdString());
+
+    std::vector<GazeSample> samples;
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine();
+        GazeSample sample;
+        if (line.split(';').size() >= 3 && parseSample(line, sample))
+            samples.push_back(sample);
+    }
+    return samples;
+}
+
+/**
+ * @brief ReplayGazeSource::replayLoop Push the samples with the same relative timing as in the
+ *        log. Waits are split into short steps so stop() returns quickly.
+ *        The scheduled time of a sample is its capture time, so scheduling delays show up as
+ *        tracker latency like the transport delay of a real eye tracker.
+ */
+void ReplayGazeSource::replayLoop()
+{
+    using clock = std::chrono::steady_clock;
+    const auto step = std::chrono::milliseconds(10);
+
+    do
+    {
+        const clock::time_point begin = clock::now();
+        const int64_t first = _samples.front().deviceTime;
+        for (const GazeSample &s : _samples)
+        {
+            const clock::time_point due = begin + std::chrono::microseconds(s.deviceTime - first);
+            while (_running && clock::now() < due)
+                std::this_thread::sleep_until(std::min(due, clock::now() + step));
+            if (!_running)
+                return;
+            GazeSample sample = s;
+            sample.time = gazeClock();
+            sample.captureTime = sample.time - std::chrono::duration_cast<std::chrono::microseconds>(
+                        clock::now() - due).count();
+            _buffer.push(sample);
+        }
+    } while (_loop && _running);
+    _running = false;
+}
+
+/**
+ * @brief ReplayGazeSource::receiveLoop Receive samples over UDP until stop() is called.
+ * @param port
+ */
+void ReplayGazeSource::receiveLoop(const quint16 port)
+{
+    QUdpSocket socket;
+    if (!socket.bind(QHostAddress::Any, port))
+    {
+        std::cerr << "Could not bind gaze source to port " << port << ": "
+                  << socket.errorString().toStdString() << std::endl;
+        _running = false;
+        return;
+    }
+
+    while (_running)
+    {
+        if (!socket.waitForReadyRead(10))
+            continue;
+        while (socket.hasPendingDatagrams())
+        {
+            QByteArray datagram(static_cast<int>(socket.pendingDatagramSize()), 0);
+            socket.readDatagram(datagram.data(), datagram.size());
+            GazeSample sample;
+            if (!parseSample(QString::fromUtf8(datagram).trimmed(), sample))
+                continue;
+            sample.time = gazeClock();
+            _buffer.push(sample);
+        }
+    }
+}
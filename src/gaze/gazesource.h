@@ -0,0 +1,133 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <QString>
+
+#include "src/gaze/gazebuffer.h"
+
+/**
+ * @brief Interface of gaze backends. A source pushes samples into a GazeBuffer from its own
+ *        thread (or the thread calling it), the render loop reads them from the buffer.
+ */
+class GazeSource
+{
+public:
+    explicit GazeSource(GazeBuffer &buffer);
+    virtual ~GazeSource();
+
+    GazeSource(const GazeSource &) = delete;
+    GazeSource &operator=(const GazeSource &) = delete;
+
+    /**
+     * @brief Start pushing samples.
+     * @return false if the source is not available.
+     */
+    virtual bool start() = 0;
+
+    /**
+     * @brief Stop pushing samples, no sample is pushed after this returns.
+     */
+    virtual void stop() = 0;
+
+    virtual bool isRunning() const = 0;
+
+    /**
+     * @brief Short name of the backend for messages.
+     */
+    virtual QString name() const = 0;
+
+protected:
+    GazeBuffer &_buffer;
+};
+
+/**
+ * @brief Uses the mouse cursor as gaze point. Positions are pushed by the GUI thread.
+ */
+class MouseGazeSource : public GazeSource
+{
+public:
+    explicit MouseGazeSource(GazeBuffer &buffer);
+
+    bool start() override;
+    void stop() override;
+    bool isRunning() const override;
+    QString name() const override;
+
+    /**
+     * @brief Push a cursor position in normalized widget coordinates if the source is running.
+     */
+    void setPosition(const float x, const float y);
+
+private:
+    bool _running = false;
+};
+
+/**
+ * @brief Replays recorded gaze samples at their original time stamps, or receives samples
+ *        over UDP, on a separate thread.
+ *        Files use the interaction log format, only lines "<ms>; gaze; <x> <y>" are used.
+ *        For "udp:<port>", every datagram holds one sample as "<x> <y>" or in the log format,
+ *        it is pushed when received.
+ */
+class ReplayGazeSource : public GazeSource
+{
+public:
+    /**
+     * @brief Create a replay source.
+     * @param source Interaction log file name or "udp:<port>".
+     * @param loop Restart a file replay at the end.
+     */
+    ReplayGazeSource(GazeBuffer &buffer, const QString &source, const bool loop = false);
+    ~ReplayGazeSource() override;
+
+    bool start() override;
+    void stop() override;
+    bool isRunning() const override;
+    QString name() const override;
+
+    /**
+     * @brief Read the gaze samples of an interaction log. Sample times are in microseconds.
+     * @throws invalid_argument if the file can not be opened.
+     */
+    static std::vector<GazeSample> readGazeLog(const QString &fileName);
+
+    /**
+     * @brief Parse a single gaze sample, "<x> <y>" or "<ms>; gaze; <x> <y>".
+     * @return false if the line does not contain a gaze sample.
+     */
+    static bool parseSample(const QString &line, GazeSample &sample);
+
+private:
+    void replayLoop();
+    void receiveLoop(const quint16 port);
+
+    QString _source;
+    bool _loop;
+    std::vector<GazeSample> _samples;
+    std::thread _thread;
+    std::atomic<bool> _running;
+};
@@ -0,0 +1,122 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "src/gaze/tobiigazesource.h"
+
+#include <iostream>
+
+/**
+ * @brief TobiiGazeSource::TobiiGazeSource
+ * @param buffer
+ */
+TobiiGazeSource::TobiiGazeSource(GazeBuffer &buffer)
+    : GazeSource(buffer)
+{
+}
+
+TobiiGazeSource::~TobiiGazeSource()
+{
+    stop();
+}
+
+/**
+ * @brief TobiiGazeSource::start Subscribe to the gaze data of the selected eye tracker.
+ * @return false if no eye tracker is selected or the subscription failed.
+ */
+bool TobiiGazeSource::start()
+{
+    if (_eyetracker == nullptr)
+        return false;
+    if (_subscribed)
+        return true;
+    // map the system time stamps of the samples to gazeClock() for latency measurements
+    int64_t systemTime = 0;
+    if (tobii_research_get_system_time_stamp(&systemTime) == TOBII_RESEARCH_STATUS_OK)
+        _clockOffset = gazeClock() - systemTime;
+    else
+        _clockOffset = 0;
+    const TobiiResearchStatus status = tobii_research_subscribe_to_gaze_data(
+                _eyetracker, &TobiiGazeSource::gazeDataCallback, this);
+    if (status != TOBII_RESEARCH_STATUS_OK)
+    {
+        std::cerr << "Could not subscribe to eyetracker data: " << status << std::endl;
+        return false;
+    }
+    _subscribed = true;
+    return true;
+}
+
+/**
+ * @brief TobiiGazeSource::stop
+ */
+void TobiiGazeSource::stop()
+{
+    if (!_subscribed)
+        return;
+    const TobiiResearchStatus status = tobii_research_unsubscribe_from_gaze_data(
+                _eyetracker, &TobiiGazeSource::gazeDataCallback);
+    if (status != TOBII_RESEARCH_STATUS_OK)
+        std::cerr << "Could not unsubscribe from eyetracker data: " << status << std::endl;
+    _subscribed = false;
+}
+
+bool TobiiGazeSource::isRunning() const
+{
+    return _subscribed;
+}
+
+QString TobiiGazeSource::name() const
+{
+    return QString("tobii");
+}
+
+/**
+ * @brief TobiiGazeSource::setEyetracker Select the eye tracker, stops a running subscription.
+ * @param eyetracker
+ */
+void TobiiGazeSource::setEyetracker(TobiiResearchEyeTracker *eyetracker)
+{
+    stop();
+    _eyetracker = eyetracker;
+}
+
+TobiiResearchEyeTracker *TobiiGazeSource::getEyetracker() const
+{
+    return _eyetracker;
+}
+
+/**
+ * @brief Called from the thread of the Tobii SDK for every gaze sample, pushes the right eye
+ *        gaze point into the ring buffer of the source passed as user data.
+ */
+void TobiiGazeSource::gazeDataCallback(TobiiResearchGazeData *gaze_data, void *user_data)
+{
+    TobiiGazeSource *source = static_cast<TobiiGazeSource*>(user_data);
+    GazeSample sample;
+    sample.time = gazeClock();
+    sample.deviceTime = gaze_data->system_time_stamp;
+    if (source->_clockOffset != 0)
+        sample.captureTime = gaze_data->system_time_stamp + source->_clockOffset;
+    sample.x = gaze_data->right_eye.gaze_point.position_on_display_area.x;
+    sample.y = gaze_data->right_eye.gaze_point.position_on_display_area.y;
+    sample.valid = gaze_data->right_eye.gaze_point.validity == TOBII_RESEARCH_VALIDITY_VALID;
+    source->_buffer.push(sample);
+}
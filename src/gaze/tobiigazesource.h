@@ -0,0 +1,53 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <inc/TOBIIRESEARCH/tobii_research.h>
+#include <inc/TOBIIRESEARCH/tobii_research_eyetracker.h>
+#include <inc/TOBIIRESEARCH/tobii_research_streams.h>
+
+#include "src/gaze/gazesource.h"
+
+/**
+ * @brief Gaze samples of a Tobii eye tracker, pushed from the thread of the Tobii SDK.
+ */
+class TobiiGazeSource : public GazeSource
+{
+public:
+    explicit TobiiGazeSource(GazeBuffer &buffer);
+    ~TobiiGazeSource() override;
+
+    bool start() override;
+    void stop() override;
+    bool isRunning() const override;
+    QString name() const override;
+
+    void setEyetracker(TobiiResearchEyeTracker *eyetracker);
+    TobiiResearchEyeTracker *getEyetracker() const;
+
+private:
+    static void gazeDataCallback(TobiiResearchGazeData *gaze_data, void *user_data);
+
+    TobiiResearchEyeTracker *_eyetracker = nullptr;
+    bool _subscribed = false;
+    int64_t _clockOffset = 0;   // gazeClock() minus the Tobii system clock in microseconds
+};
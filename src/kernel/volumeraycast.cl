@@ -23,6 +23,16 @@
 #pragma OPENCL EXTENSION cl_khr_3d_image_writes : enable
 
 #define ERT_THRESHOLD 0.98
+#define AO_STRENGTH 0.3f   // darkening of fully occluded surfaces
+
+// work counters, enabled with -DCOUNTERS (indices match counter_id on the host)
+#define CNT_RAYS            0   // rays that entered the volume
+#define CNT_SAMPLES         1   // volume samples taken
+#define CNT_BRICKS_SKIPPED  2   // empty bricks skipped by object order ESS
+#define CNT_ERT             3   // rays terminated early
+#define CNT_COUNT           4
+
+#define RATE_BLOCK  8   // side of the pixel block traced by a variable rate work group (LOCAL_SIZE)
 
 constant sampler_t linearSmp = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_CLAMP_TO_EDGE |
                                CLK_FILTER_LINEAR;
@@ -394,40 +404,35 @@ bool checkBoundingCell(int3 cell, int3 volRes, int size)
         return false;
 }
 
-// Uniform Sampling of the hemisphere above the normal n
-float3 getUniformRandomSampleDirectionUpper(float3 n, uint4 *taus)
-{
-    float z = (hybridTaus(taus) * 2.f) - 1.f;
-    float phi = hybridTaus(taus) * 2.f * M_PI_F;
-
-    float3 sampleDirection = (float3)(sqrt(1.f - z*z) * sin(phi), sqrt(1.f - z*z) * cos(phi), z);
-    float cosTheta = dot(n, sampleDirection);
-
-    if (cosTheta < 0)
-        sampleDirection *= -1;
-    return sampleDirection;
-}
-
-
-// Calculate ambient occlusion factor with monte carlo sampling
-float calcAO(float3 n, uint4 *taus, image3d_t volData, float3 pos, float stepSize, float r)
+// Fixed set of directions for ambient occlusion: 6 face and 8 corner directions of a cube
+constant float3 aoDirections[14] = {
+    (float3)( 1.f,  0.f,  0.f), (float3)(-1.f,  0.f,  0.f),
+    (float3)( 0.f,  1.f,  0.f), (float3)( 0.f, -1.f,  0.f),
+    (float3)( 0.f,  0.f,  1.f), (float3)( 0.f,  0.f, -1.f),
+    (float3)( 0.57735f,  0.57735f,  0.57735f), (float3)(-0.57735f, -0.57735f, -0.57735f),
+    (float3)( 0.57735f,  0.57735f, -0.57735f), (float3)(-0.57735f, -0.57735f,  0.57735f),
+    (float3)( 0.57735f, -0.57735f,  0.57735f), (float3)(-0.57735f,  0.57735f, -0.57735f),
+    (float3)(-0.57735f,  0.57735f,  0.57735f), (float3)( 0.57735f, -0.57735f, -0.57735f)
+};
+
+// Calculate ambient occlusion factor by compositing the classified opacity along fixed directions
+float calcAO(image3d_t volData, image1d_t tffData, float3 pos, float stepSize, float r)
 {
     float ao = 0.f;
-    int rays = 12;
-    // rays
+    int rays = 14;
     for (int i = 0; i < rays; ++i)
     {
-        float3 dir = getUniformRandomSampleDirectionUpper(n, taus);
-        float sample = 0.f;
-        int cnt = 0;
-
-        while (cnt*stepSize < r)
+        float occlusion = 0.f;
+        int cnt = 1;
+        while (cnt*stepSize < r && occlusion < ERT_THRESHOLD)
         {
+            float density = read_imagef(volData, linearSmp,
+                                        (float4)(pos + aoDirections[i]*cnt*stepSize, 1.f)).x;
+            float opacity = read_imagef(tffData, linearSmp, density).w;
+            occlusion += opacity * (1.f - occlusion);
             ++cnt;
-            sample += read_imagef(volData, linearSmp, (float4)(pos + dir*cnt*stepSize, 1.f)).x;
         }
-        sample /= cnt;
-        ao += sample;
+        ao += occlusion;
     }
     ao /= (float)(rays);
 
@@ -472,6 +477,16 @@ __kernel void volumeRender(  __read_only image3d_t volData
 //                           , __read_only image2d_t indexMap
                            , const uint2 resultImgExtends
                            , __global samplingDataStruct *samplingData
+                           , __read_only image2d_t tffPreInt   // pre-integrated transfer function
+                           , const uint preIntegrated
+                           , __read_only image3d_t aoVol      // precomputed ambient occlusion
+                           , __write_only image2d_t depthImg  // representative depth (LBG)
+                           , const float4 layerViewport   // multi-resolution layer: origin, pixel size, step factor
+                           , __global const uint4 *rateGroups  // variable rate: block origin (xy), lattice step (z)
+                           , __global const uint *rateGroupCount  // variable rate: valid entries of rateGroups
+#ifdef COUNTERS
+                           , __global uint *counters
+#endif
 //                           , __read_only image3d_t volMip1
 //                           , __read_only image3d_t volMip2
 //                           , __read_only image3d_t volMip3
@@ -481,348 +496,425 @@ __kernel void volumeRender(  __read_only image3d_t volData
     int2 globalId = (int2)(get_global_id(0), get_global_id(1));
     int2 img_bounds = get_image_dim(outImg);
     int2 texCoords = globalId;
+    int2 viewBounds = img_bounds;   // extent of the image plane in pixels
+    float2 pixelPos;                // position on the image plane in pixels
     uint texId;
     int2 gp;
     int mipLvl = 0;
     float mipMix = 0.f;
     float gazeDistance = 0.f;
+    uint rayHit = 0;    // ray result differs from the background, for image order ESS
+
+    // work group wide values, visible to all work items after the first barrier below
+    uint localId = get_local_id(1)*get_local_size(0) + get_local_id(0);
+    local uint hits;
+    if (localId == 0)
+        hits = 0;
+#ifdef COUNTERS
+    local uint groupCounters[CNT_COUNT];
+    if (localId == 0)
+    {
+        for (int i = 0; i < CNT_COUNT; ++i)
+            groupCounters[i] = 0;
+    }
+    uint cntRays = 0;
+    uint cntSamples = 0;
+    uint cntSkipped = 0;
+    uint cntErt = 0;
+#endif
 
-    switch(rmode)
+    // Early exits leave this block instead of returning, so that every work item of the group
+    // reaches the barriers of the work group reductions below.
+    do
     {
-        case 1:
-            // LBG-Sampling
-            // gp are the unnormalized coordinates between 0 and one half of the indexMap extends
-            gp = convert_int2_rtz(convert_float2(img_bounds/2) * gpoint);
-//            gp += get_image_dim(indexMap) / (int2)(2);
-            // used to look up the sampleCoordinates
-            texId = globalId.x; //index_from_2d(globalId, get_global_size(0));
-            if(texId >= sdSamples) return;
-
-            int2 sampleCoords = convert_int2(samplingData[texId].id);
-            // texCoords are the sampleCoords but with an offset according to gp
-            // if gp in middle of screen one half of one half, then offset is zero
-            texCoords = sampleCoords + gp - (img_bounds / 4);
-            sampleCoords /= 2;
-            sampleCoords -= img_bounds/4;
-            gazeDistance = length(convert_float2(sampleCoords)/convert_float2(img_bounds/4));
-//            float mipDiv = (convert_float2(max(img_bounds.x, img_bounds.y)/4) * (float)(1.f/4.f));
-//            float mipDist = length(convert_float2(sampleCoords)) / (mipDiv * 2.f);// M_SQRT2_F);
-//            mipMix = fract(mipDist, &mipMix);
-//            mipLvl = floor(mipDist);
-//            if (length(convert_float2(sampleCoords)) > mipDiv*1.f) mipLvl = 1;
-//            if (length(convert_float2(sampleCoords)) > mipDiv*2.f) mipLvl = 2;
-//            if (length(convert_float2(sampleCoords)) > mipDiv*3.f) mipLvl = 3;
+        if (rmode == 1 && globalId.x >= sdSamples)
             break;
-        default:
-            // Standard
+        switch(rmode)
+        {
+            case 1:
+                // LBG-Sampling
+                // gp are the unnormalized coordinates between 0 and one half of the indexMap extends
+                gp = convert_int2_rtz(convert_float2(img_bounds/2) * gpoint);
+    //            gp += get_image_dim(indexMap) / (int2)(2);
+                // used to look up the sampleCoordinates
+                texId = globalId.x; //index_from_2d(globalId, get_global_size(0));
+
+                int2 sampleCoords = convert_int2(samplingData[texId].id);
+                // texCoords are the sampleCoords but with an offset according to gp
+                // if gp in middle of screen one half of one half, then offset is zero
+                texCoords = sampleCoords + gp - (img_bounds / 4);
+                sampleCoords /= 2;
+                sampleCoords -= img_bounds/4;
+                gazeDistance = length(convert_float2(sampleCoords)/convert_float2(img_bounds/4));
+    //            float mipDiv = (convert_float2(max(img_bounds.x, img_bounds.y)/4) * (float)(1.f/4.f));
+    //            float mipDist = length(convert_float2(sampleCoords)) / (mipDiv * 2.f);// M_SQRT2_F);
+    //            mipMix = fract(mipDist, &mipMix);
+    //            mipLvl = floor(mipDist);
+    //            if (length(convert_float2(sampleCoords)) > mipDiv*1.f) mipLvl = 1;
+    //            if (length(convert_float2(sampleCoords)) > mipDiv*2.f) mipLvl = 2;
+    //            if (length(convert_float2(sampleCoords)) > mipDiv*3.f) mipLvl = 3;
+                break;
+            case 2:
+                // Multi-resolution: outImg is a layer that covers part of the full resolution image,
+                // each layer pixel is traced through the center of the full resolution pixels it covers
+                viewBounds = convert_int2(resultImgExtends);
+                gazeDistance = layerViewport.w;
+                break;
+            case 3:
+                // Variable rate: each work group traces a block of the sample lattice of a rate tile,
+                // the remaining pixels are filled by fillVariableRate
+            {
+                // the dispatch covers the upper bound of groups, the list is built on the device
+                if (get_group_id(0) >= rateGroupCount[0])
+                {
+                    texCoords = (int2)(-1);
+                    break;
+                }
+                uint4 rateGroup = rateGroups[get_group_id(0)];
+                int2 blockId = (int2)(get_local_id(0) % RATE_BLOCK, get_local_id(0) / RATE_BLOCK);
+                texCoords = convert_int2(rateGroup.xy) + blockId*convert_int(rateGroup.z);
+                break;
+            }
+            default:
+                // Standard
+                break;
+        }
+        if(any(texCoords >= get_image_dim(outImg)) || any(texCoords < (int2)(0,0)))
             break;
-    }
-    if(any(texCoords >= get_image_dim(outImg)) || any(texCoords < (int2)(0,0)))
-        return;
+        pixelPos = convert_float2(texCoords);
+        if (rmode == 2)
+            pixelPos = layerViewport.xy + pixelPos*layerViewport.z + (layerViewport.z - 1.f)*0.5f;
 
-//write_imagef(outImg, texCoords, (float4)(convert_float2(texCoords)/convert_float2(resultImgExtends),0,1));
-//return;
+    //write_imagef(outImg, texCoords, (float4)(convert_float2(texCoords)/convert_float2(resultImgExtends),0,1));
+    //return;
 
-    // TODO: Check if get_group_id() is related to the number of total work items and if it results in an error when using lbg-sampling.
-    local uint hits;
-    if (imgEss)
-    {
-        hits = 0;
-        uint4 lastHit = read_imageui(inHitImg, (int2)(get_group_id(0)  , get_group_id(1)  ));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)+1, get_group_id(1)  ));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)-1, get_group_id(1)  ));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)  , get_group_id(1)+1));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)  , get_group_id(1)-1));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)+1, get_group_id(1)+1));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)-1, get_group_id(1)-1));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)-1, get_group_id(1)+1));
-        lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)+1, get_group_id(1)-1));
-        if (!lastHit.x)
+        // TODO: Check if get_group_id() is related to the number of total work items and if it results in an error when using lbg-sampling.
+        if (imgEss)
         {
-            write_imagef(outImg, texCoords, showEss ? (float4)(1.f) - background : background);
-            write_imageui(outHitImg, (int2)(get_group_id(0), get_group_id(1)), (uint4)(0u));
-            return;
+            uint4 lastHit = read_imageui(inHitImg, (int2)(get_group_id(0)  , get_group_id(1)  ));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)+1, get_group_id(1)  ));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)-1, get_group_id(1)  ));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)  , get_group_id(1)+1));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)  , get_group_id(1)-1));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)+1, get_group_id(1)+1));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)-1, get_group_id(1)-1));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)-1, get_group_id(1)+1));
+            lastHit += read_imageui(inHitImg,      (int2)(get_group_id(0)+1, get_group_id(1)-1));
+            if (!lastHit.x)
+            {
+                write_imagef(outImg, texCoords, showEss ? (float4)(1.f) - background : background);
+                if (rmode == 1)
+                    write_imagef(depthImg, texCoords, (float4)(-1.f));
+                write_imageui(outHitImg, (int2)(get_group_id(0), get_group_id(1)), (uint4)(0u));
+                break;
+            }
         }
-    }
 
-    uint4 taus = initRNG();
-    // pseudo random number [0,1] for ray offsets to avoid moire patterns
-    float iptr;
-    float rand = fract(sin(dot(convert_float2(globalId),
-                       (float2)(12.9898f, 78.233f))) * 43758.5453f, &iptr);
-
-    float aspectRatio = img_bounds.x > img_bounds.y ?
-                              native_divide((float)(img_bounds.y), (float)(img_bounds.x))
-                            : native_divide((float)(img_bounds.x), (float)(img_bounds.y));
-
-    int maxImgSize = max(resultImgExtends.x, resultImgExtends.y);
-    float2 imgCoords; // [-1,+1]
-    imgCoords.x = native_divide(texCoords.x + 0.f, convert_float(maxImgSize)) * 2.f;
-    imgCoords.y = native_divide(texCoords.y + 0.f, convert_float(maxImgSize)) * 2.f;
-    // calculate correct offset based on aspect ratio
-    imgCoords -= img_bounds.x > img_bounds.y ?
-                        (float2)(1.0f, aspectRatio) : (float2)(aspectRatio, 1.0);
-    if (rmode == 1) // add LBG-sampling offset
-        imgCoords -= img_bounds.x > img_bounds.y ?
+        // pseudo random number [0,1] for ray offsets to avoid moire patterns
+        float iptr;
+        float rand = fract(sin(dot(convert_float2(globalId),
+                           (float2)(12.9898f, 78.233f))) * 43758.5453f, &iptr);
+
+        float aspectRatio = viewBounds.x > viewBounds.y ?
+                                  native_divide((float)(viewBounds.y), (float)(viewBounds.x))
+                                : native_divide((float)(viewBounds.x), (float)(viewBounds.y));
+
+        int maxImgSize = max(resultImgExtends.x, resultImgExtends.y);
+        float2 imgCoords; // [-1,+1]
+        imgCoords.x = native_divide(pixelPos.x, convert_float(maxImgSize)) * 2.f;
+        imgCoords.y = native_divide(pixelPos.y, convert_float(maxImgSize)) * 2.f;
+        // calculate correct offset based on aspect ratio
+        imgCoords -= viewBounds.x > viewBounds.y ?
                             (float2)(1.0f, aspectRatio) : (float2)(aspectRatio, 1.0);
-    imgCoords.y *= -1.f;   // flip y coord
-
-    // z position of view plane is -1.0 to fit the cube to the screen quad when axes are aligned,
-    // zoom is -1 and the data set is uniform in each dimension
-    // (with FoV of 90° and near plane in range [-1,+1]).
-    float3 nearPlanePos = fast_normalize((float3)(imgCoords, -1.0f));
-    // transform nearPlane from view space to world space
-    float3 rayDir = (float3)(0.f);
-    rayDir.x = dot(viewMat.s012, nearPlanePos);
-    rayDir.y = dot(viewMat.s456, nearPlanePos);
-    rayDir.z = dot(viewMat.s89a, nearPlanePos);
-
-    // camera position in world space (ray origin) is translation vector of view matrix
-    float3 camPos = viewMat.s37b*modelScale;
-
-    if (orthoCam)
-    {
-        camPos = (float3)(viewMat.s37b);
-        float3 viewPlane_x = viewMat.s048;
-        float3 viewPlane_y = viewMat.s159;
-        float3 viewPlane_z = viewMat.s26a;
-        rayDir = -viewPlane_z;
-        nearPlanePos = camPos + imgCoords.x*viewPlane_x + imgCoords.y*viewPlane_y;
-        nearPlanePos *= length(camPos);
-        camPos = nearPlanePos * modelScale;
-    }
-    rayDir = fast_normalize(rayDir*modelScale);
-
-    float tnear = FLT_MIN;
-    float tfar = FLT_MAX;
-    int hit = 0;
-    // bbox from (-1,-1,-1) to (+1,+1,+1)
-    hit = intersectBox(camPos, rayDir, &tnear, &tfar);
-    if (!hit || tfar < 0)
-    {
-        write_imagef(outImg, texCoords, background);
-        if (imgEss)
-            write_imageui(outHitImg, (int2)(get_group_id(0), get_group_id(1)), (uint4)(0u));
-        return;
-    }
+        if (rmode == 1) // add LBG-sampling offset
+            imgCoords -= viewBounds.x > viewBounds.y ?
+                                (float2)(1.0f, aspectRatio) : (float2)(aspectRatio, 1.0);
+        imgCoords.y *= -1.f;   // flip y coord
+
+        // z position of view plane is -1.0 to fit the cube to the screen quad when axes are aligned,
+        // zoom is -1 and the data set is uniform in each dimension
+        // (with FoV of 90° and near plane in range [-1,+1]).
+        float3 nearPlanePos = fast_normalize((float3)(imgCoords, -1.0f));
+        // transform nearPlane from view space to world space
+        float3 rayDir = (float3)(0.f);
+        rayDir.x = dot(viewMat.s012, nearPlanePos);
+        rayDir.y = dot(viewMat.s456, nearPlanePos);
+        rayDir.z = dot(viewMat.s89a, nearPlanePos);
+
+        // camera position in world space (ray origin) is translation vector of view matrix
+        float3 camPos = viewMat.s37b*modelScale;
+
+        if (orthoCam)
+        {
+            camPos = (float3)(viewMat.s37b);
+            float3 viewPlane_x = viewMat.s048;
+            float3 viewPlane_y = viewMat.s159;
+            float3 viewPlane_z = viewMat.s26a;
+            rayDir = -viewPlane_z;
+            nearPlanePos = camPos + imgCoords.x*viewPlane_x + imgCoords.y*viewPlane_y;
+            nearPlanePos *= length(camPos);
+            camPos = nearPlanePos * modelScale;
+        }
+        rayDir = fast_normalize(rayDir*modelScale);
+
+        float tnear = FLT_MIN;
+        float tfar = FLT_MAX;
+        int hit = 0;
+        // bbox from (-1,-1,-1) to (+1,+1,+1)
+        hit = intersectBox(camPos, rayDir, &tnear, &tfar);
+        if (!hit || tfar < 0)
+        {
+            write_imagef(outImg, texCoords, background);
+            if (rmode == 1)
+                write_imagef(depthImg, texCoords, (float4)(-1.f));
+            if (imgEss)
+                write_imageui(outHitImg, (int2)(get_group_id(0), get_group_id(1)), (uint4)(0u));
+            break;
+        }
 
-    float sampleDist = tfar - tnear;
-    if (sampleDist <= 0.f)
-        return;
-    int3 volRes = get_image_dim(volData).xyz;
-    float stepSize = min(sampleDist, sampleDist /
-                            (samplingRate*length(sampleDist*rayDir*convert_float3(volRes))));
-    float samples = ceil(sampleDist/stepSize);
-    stepSize = sampleDist/samples;
-
-    // sample dist adaption (gazeDistance is normalized)
-    stepSize *= 1.f + gazeDistance*2.f;
-
-    float offset = stepSize*rand*0.9f; // offset by 'random' distance to avoid moiré pattern
-
-    // raycast parameters
-    tnear = max(0.f, tnear);    // clamp to near plane
-    float4 result = background;
-    float alpha = 0.f;
-    float3 pos = (float3)(0);
-    float density = 0.f;
-    float4 tfColor = (float4)(0);
-    float opacity = 0.f;
-    float t = tnear;
-
-    float3 voxLen = (float3)(1.f) / convert_float3(volRes);
-    float refSamplingInterval = 1.f / samplingRate;
-    float t_exit = tfar;
+        float sampleDist = tfar - tnear;
+        if (sampleDist <= 0.f)
+            break;
+        int3 volRes = get_image_dim(volData).xyz;
+        float stepSize = min(sampleDist, sampleDist /
+                                (samplingRate*length(sampleDist*rayDir*convert_float3(volRes))));
+        float samples = ceil(sampleDist/stepSize);
+        stepSize = sampleDist/samples;
+
+        // sample dist adaption (gazeDistance is normalized)
+        stepSize *= 1.f + gazeDistance*2.f;
+
+        float offset = stepSize*rand*0.9f; // offset by 'random' distance to avoid moiré pattern
+
+        // raycast parameters
+        tnear = max(0.f, tnear);    // clamp to near plane
+        float4 result = background;
+        float alpha = 0.f;
+        float3 pos = (float3)(0);
+        float density = 0.f;
+        float4 tfColor = (float4)(0);
+        float opacity = 0.f;
+        float t = tnear;
+        float depth = -1.f;     // ray distance where the accumulated opacity reaches one half
+
+        float3 voxLen = (float3)(1.f) / convert_float3(volRes);
+        float refSamplingInterval = 1.f / samplingRate;
+        float t_exit = tfar;
+        // density of the previous sample (front of the ray segment), negative if there is none
+        float densityFront = -1.f;
+        // opacity correction has to account for the adapted step size
+        float segmentInterval = refSamplingInterval * (1.f + gazeDistance*2.f);
 
 #ifdef ESS
-    // 3D DDA initialization
-    int3 bricksRes = get_image_dim(volBrickData).xyz;
-    // FIXME: correct if brick res is odd
-//    if ((bricksRes.x & 1) != 0) bricksRes.x -= 1;
-//    if ((bricksRes.y & 1) != 0) bricksRes.y -= 1;
-//    if ((bricksRes.z & 1) != 0) bricksRes.z -= 1;
-
-    float3 brickLen = (float3)(1.f) / convert_float3(bricksRes);
-    float3 invRay = 1.f/rayDir;
-    int3 step = convert_int3(sign(rayDir));
-    if (rayDir.x == 0.f)
-    {
-        invRay.x = FLT_MAX;
-        step.x = 1;
-    }
-    if (rayDir.y == 0.f)
-    {
-        invRay.y = FLT_MAX;
-        step.y = 1;
-    }
-    if (rayDir.z == 0.f)
-    {
-        invRay.z = FLT_MAX;
-        step.z = 1;
-    }
-    float3 deltaT = convert_float3(step)*(brickLen*2.f*invRay);
-    float3 voxIncr = (float3)0;
-
-    // convert ray starting point to cell coordinates
-    float3 rayOrigCell = (camPos + rayDir * tnear) - (float3)(-1.f);
-    int3 cell = clamp(convert_int3(floor(rayOrigCell / (2.f*brickLen))),
-                        (int3)(0), convert_int3(bricksRes.xyz) - 1);
-
-    // add +1 to cells if ray dir component is negative: rayDir >= 0 ? (-1) : 0
-    float3 tv = tnear + (convert_float3(cell - isgreaterequal(rayDir, (float3)(0)))
-                            * (2.f*brickLen) - rayOrigCell) * invRay;
-    int3 exit = step * bricksRes.xyz;
-    if (exit.x < 0) exit.x = -1;
-    if (exit.y < 0) exit.y = -1;
-    if (exit.z < 0) exit.z = -1;
-    // length of diagonal of a brick => longest distance through brick
-    float brickDia = length(brickLen)*2.f;
-
-    // 3D DDA loop over low-res grid for image order empty space skipping
-    while (t < tfar)
-    {
-        float2 minMaxDensity = read_imagef(volBrickData, (int4)(cell, 0)).xy;
-
-        // increment to next brick
-        voxIncr.x = (tv.x <= tv.y) && (tv.x <= tv.z) ? 1 : 0;
-        voxIncr.y = (tv.y <= tv.x) && (tv.y <= tv.z) ? 1 : 0;
-        voxIncr.z = (tv.z <= tv.x) && (tv.z <= tv.y) ? 1 : 0;
-        cell += convert_int3(voxIncr) * step;    // [0; res-1]
-
-        t_exit = dot((float3)(1), tv * voxIncr);
-        t_exit = clamp(t_exit, t+stepSize, t+brickDia);
-        tv += voxIncr*deltaT;
-
-        // skip bricks that contain only fully transparent voxels
-        float alphaMax = read_imagef(tffData, linearSmp, minMaxDensity.y).w;
-        if (alphaMax < 1e-6f)
+        // 3D DDA initialization
+        int3 bricksRes = get_image_dim(volBrickData).xyz;
+        // FIXME: correct if brick res is odd
+    //    if ((bricksRes.x & 1) != 0) bricksRes.x -= 1;
+    //    if ((bricksRes.y & 1) != 0) bricksRes.y -= 1;
+    //    if ((bricksRes.z & 1) != 0) bricksRes.z -= 1;
+
+        float3 brickLen = (float3)(1.f) / convert_float3(bricksRes);
+        float3 invRay = 1.f/rayDir;
+        int3 step = convert_int3(sign(rayDir));
+        if (rayDir.x == 0.f)
         {
-            uint prefixMin = read_imageui(tffPrefix, linearSmp, minMaxDensity.x).x;
-            uint prefixMax = read_imageui(tffPrefix, linearSmp, minMaxDensity.y).x;
-            if (prefixMin == prefixMax)
-            {
-                t = t_exit;
-                continue;
-            }
+            invRay.x = FLT_MAX;
+            step.x = 1;
         }
-#endif  // ESS
-        // standard raycasting loop
-        while (t < t_exit)
+        if (rayDir.y == 0.f)
+        {
+            invRay.y = FLT_MAX;
+            step.y = 1;
+        }
+        if (rayDir.z == 0.f)
+        {
+            invRay.z = FLT_MAX;
+            step.z = 1;
+        }
+        float3 deltaT = convert_float3(step)*(brickLen*2.f*invRay);
+        float3 voxIncr = (float3)0;
+
+        // convert ray starting point to cell coordinates
+        float3 rayOrigCell = (camPos + rayDir * tnear) - (float3)(-1.f);
+        int3 cell = clamp(convert_int3(floor(rayOrigCell / (2.f*brickLen))),
+                            (int3)(0), convert_int3(bricksRes.xyz) - 1);
+
+        // add +1 to cells if ray dir component is negative: rayDir >= 0 ? (-1) : 0
+        float3 tv = tnear + (convert_float3(cell - isgreaterequal(rayDir, (float3)(0)))
+                                * (2.f*brickLen) - rayOrigCell) * invRay;
+        int3 exit = step * bricksRes.xyz;
+        if (exit.x < 0) exit.x = -1;
+        if (exit.y < 0) exit.y = -1;
+        if (exit.z < 0) exit.z = -1;
+        // length of diagonal of a brick => longest distance through brick
+        float brickDia = length(brickLen)*2.f;
+
+        // 3D DDA loop over low-res grid for image order empty space skipping
+        while (t < tfar)
         {
-            pos = camPos + (t-offset)*rayDir;
-            pos = pos * 0.5f + 0.5f;    // normalize to [0,1]
+            float2 minMaxDensity = read_imagef(volBrickData, (int4)(cell, 0)).xy;
 
-            float4 gradient = (float4)(0.f);
-            if (illumType == 4)   // gradient magnitude based shading
+            // increment to next brick
+            voxIncr.x = (tv.x <= tv.y) && (tv.x <= tv.z) ? 1 : 0;
+            voxIncr.y = (tv.y <= tv.x) && (tv.y <= tv.z) ? 1 : 0;
+            voxIncr.z = (tv.z <= tv.x) && (tv.z <= tv.y) ? 1 : 0;
+            cell += convert_int3(voxIncr) * step;    // [0; res-1]
+
+            t_exit = dot((float3)(1), tv * voxIncr);
+            t_exit = clamp(t_exit, t+stepSize, t+brickDia);
+            tv += voxIncr*deltaT;
+
+            // skip bricks that contain only fully transparent voxels
+            float alphaMax = read_imagef(tffData, linearSmp, minMaxDensity.y).w;
+            if (alphaMax < 1e-6f)
             {
-                gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
-                tfColor = read_imagef(tffData, linearSmp, -gradient.w);
+                uint prefixMin = read_imageui(tffPrefix, linearSmp, minMaxDensity.x).x;
+                uint prefixMax = read_imageui(tffPrefix, linearSmp, minMaxDensity.y).x;
+                if (prefixMin == prefixMax)
+                {
+                    t = t_exit;
+                    densityFront = -1.f;    // segment is interrupted by the skipped brick
+#ifdef COUNTERS
+                    ++cntSkipped;
+#endif
+                    continue;
+                }
             }
-            else    // density based shading and optional illumination
+#endif  // ESS
+            // standard raycasting loop
+            while (t < t_exit)
             {
-                float density2 = 0.f;
-                // lerp between mipmap levels
-                switch (mipLvl)
+#ifdef COUNTERS
+                ++cntSamples;
+#endif
+                pos = camPos + (t-offset)*rayDir;
+                pos = pos * 0.5f + 0.5f;    // normalize to [0,1]
+
+                float4 gradient = (float4)(0.f);
+                if (illumType == 4)   // gradient magnitude based shading
                 {
-                case 0: density = useLinear ? read_imagef(volData,  linearSmp, (float4)(pos, 1.f)).x :
-                                              read_imagef(volData, nearestSmp, (float4)(pos, 1.f)).x;
-                        break;
-//                case 1: density = read_imagef(volData, linearSmp, (float4)(pos, 1.f)).x;
-//                        density2 = read_imagef(volMip1, linearSmp, (float4)(pos, 1.f)).x;
-//                        density = mix(density, density2, mipMix);
-//                        break;
-//                case 2: density = read_imagef(volMip1, linearSmp, (float4)(pos, 1.f)).x;
-//                        density2 = read_imagef(volMip2, linearSmp, (float4)(pos, 1.f)).x;
-//                        density = mix(density, density2, mipMix);
-//                        break;
-//                case 3: density = read_imagef(volMip2, linearSmp, (float4)(pos, 1.f)).x;
-//                        density2 = read_imagef(volMip3, linearSmp, (float4)(pos, 1.f)).x;
-//                        density = mix(density, density2, mipMix);
-//                        break;
-//                case 4: density = read_imagef(volMip3, linearSmp, (float4)(pos, 1.f)).x;
-//                        density2 = read_imagef(volMip4, linearSmp, (float4)(pos, 1.f)).x;
-//                        density = mix(density, density2, mipMix);
-//                        break;
+                    gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
+                    tfColor = read_imagef(tffData, linearSmp, -gradient.w);
                 }
-
-                tfColor = read_imagef(tffData, linearSmp, density);  // map density to color
-                if (tfColor.w > 0.1f && illumType)
+                else    // density based shading and optional illumination
                 {
-                    if (illumType == 1)         // central diff
-                        gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
-                    else if (illumType == 2)    // central diff & transfer function
-                        gradient = -gradientCentralDiffTff(volData, (float4)(pos, 1.f), tffData);
-                    else if (illumType == 3)    // sobel filter
-                        gradient = -gradientSobel(volData, (float4)(pos, 1.f));
-
-                    if (illumType == 5)
+                    float density2 = 0.f;
+                    // lerp between mipmap levels
+                    switch (mipLvl)
+                    {
+                    case 0: density = useLinear ? read_imagef(volData,  linearSmp, (float4)(pos, 1.f)).x :
+                                                  read_imagef(volData, nearestSmp, (float4)(pos, 1.f)).x;
+                            break;
+    //                case 1: density = read_imagef(volData, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density2 = read_imagef(volMip1, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density = mix(density, density2, mipMix);
+    //                        break;
+    //                case 2: density = read_imagef(volMip1, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density2 = read_imagef(volMip2, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density = mix(density, density2, mipMix);
+    //                        break;
+    //                case 3: density = read_imagef(volMip2, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density2 = read_imagef(volMip3, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density = mix(density, density2, mipMix);
+    //                        break;
+    //                case 4: density = read_imagef(volMip3, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density2 = read_imagef(volMip4, linearSmp, (float4)(pos, 1.f)).x;
+    //                        density = mix(density, density2, mipMix);
+    //                        break;
+                    }
+
+                    if (preIntegrated)  // classify the ray segment between the last and this sample
                     {
-                        gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
-                        tfColor.xyz = celShading(tfColor.xyz, -rayDir, gradient.xyz);
+                        float front = densityFront < 0.f ? density : densityFront;
+                        tfColor = read_imagef(tffPreInt, linearSmp, (float2)(front, density));
+                        densityFront = density;
                     }
                     else
-                        tfColor.xyz = illumination((float4)(pos, 1.f), tfColor.xyz, -rayDir, gradient.xyz);
+                        tfColor = read_imagef(tffData, linearSmp, density);  // map density to color
+                    if (tfColor.w > 0.1f && illumType)
+                    {
+                        if (illumType == 1)         // central diff
+                            gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
+                        else if (illumType == 2)    // central diff & transfer function
+                            gradient = -gradientCentralDiffTff(volData, (float4)(pos, 1.f), tffData);
+                        else if (illumType == 3)    // sobel filter
+                            gradient = -gradientSobel(volData, (float4)(pos, 1.f));
+
+                        if (illumType == 5)
+                        {
+                            gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
+                            tfColor.xyz = celShading(tfColor.xyz, -rayDir, gradient.xyz);
+                        }
+                        else
+                            tfColor.xyz = illumination((float4)(pos, 1.f), tfColor.xyz, -rayDir, gradient.xyz);
+                    }
+                    if (tfColor.w > 0.1f && contours) // edge enhancement
+                    {
+                        if (!illumType) // no illumination
+                            gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
+                        tfColor.xyz *= fabs(dot(rayDir, gradient.xyz));
+                    }
                 }
-                if (tfColor.w > 0.1f && contours) // edge enhancement
+                tfColor.xyz = background.xyz - tfColor.xyz;
+                if (aerial) // depth cue as aerial perspective
                 {
-                    if (!illumType) // no illumination
-                        gradient = -gradientCentralDiff(volData, (float4)(pos, 1.f));
-                    tfColor.xyz *= fabs(dot(rayDir, gradient.xyz));
+                    float depthCue = 1.f - (t - tnear)/sampleDist; // [0..1]
+                    tfColor.w *= depthCue;
                 }
-            }
-            tfColor.xyz = background.xyz - tfColor.xyz;
-            if (aerial) // depth cue as aerial perspective
-            {
-                float depthCue = 1.f - (t - tnear)/sampleDist; // [0..1]
-                tfColor.w *= depthCue;
-            }
 
-            // Taylor expansion approximation
-            opacity = 1.f - native_powr(1.f - tfColor.w, refSamplingInterval);
-            result.xyz = result.xyz - tfColor.xyz * opacity * (1.f - alpha);
-            alpha = alpha + opacity * (1.f - alpha);
+                // Taylor expansion approximation
+                opacity = 1.f - native_powr(1.f - tfColor.w, segmentInterval);
+                result.xyz = result.xyz - tfColor.xyz * opacity * (1.f - alpha);
+                alpha = alpha + opacity * (1.f - alpha);
+                if (depth < 0.f && alpha >= 0.5f)
+                    depth = t;
 
-            if (t >= tfar) break;
-            if (alpha > ERT_THRESHOLD)   // early ray termination check
-            {
-                if (useAO)  // ambient occlusion only on solid surfaces
+                if (t >= tfar) break;
+                if (alpha > ERT_THRESHOLD)   // early ray termination check
                 {
-                    float3 n = -gradientCentralDiff(volData, (float4)(pos, 1.f)).xyz;
-                    float ao = calcAO(n, &taus, volData, pos, length(voxLen), length(voxLen)*5.f);
-                    result.xyz *= 1.f - 0.3f*ao;
+                    if (useAO)  // precomputed ambient occlusion only on solid surfaces
+                        result.xyz *= 1.f - AO_STRENGTH*read_imagef(aoVol, linearSmp, (float4)(pos, 1.f)).x;
+                    break;
                 }
-                break;
+                t += stepSize;
             }
-            t += stepSize;
-        }
 #ifdef ESS
-        if (t >= tfar || alpha > ERT_THRESHOLD) break;
-        if (any(cell == exit)) break;
-        t = t_exit;
-    }
+            if (t >= tfar || alpha > ERT_THRESHOLD) break;
+            if (any(cell == exit)) break;
+            t = t_exit;
+        }
 #endif  // ESS
 
-    // visualize empty space skipping
-    if (showEss)
-    {
-        if (checkBoundingBox(pos, voxLen, (float2)(0.f, 1.f)))
+#ifdef COUNTERS
+        cntRays = 1;
+        cntErt = alpha > ERT_THRESHOLD;
+#endif
+
+        // visualize empty space skipping
+        if (showEss)
         {
-            result.xyz = fabs((float3)(1.f) - background.xyz);
-            alpha = 1.f;
+            if (checkBoundingBox(pos, voxLen, (float2)(0.f, 1.f)))
+            {
+                result.xyz = fabs((float3)(1.f) - background.xyz);
+                alpha = 1.f;
+            }
         }
-    }
-    // write final image
-    result.w = alpha;
-    write_imagef(outImg, texCoords, result);
+        // write final image
+        result.w = alpha;
+        rayHit = any(result.xyz != background.xyz);
+        write_imagef(outImg, texCoords, result);
+        if (rmode == 1) // rays that stay translucent are represented by their end point
+            write_imagef(depthImg, texCoords, (float4)(depth < 0.f && alpha > 0.f ? t : depth));
+    } while (0);
 
     // image order empty space skipping
     if (imgEss)
     {
         barrier(CLK_LOCAL_MEM_FENCE);
-        if (any(result.xyz != background.xyz))
-            ++hits;
+        if (rayHit)
+            atomic_inc(&hits);
         barrier(CLK_LOCAL_MEM_FENCE);
-        if (get_local_id(0) + get_local_id(1) == 0)
+        if (localId == 0)
         {
             if (hits == 0)
                 write_imageui(outHitImg, (int2)(get_group_id(0), get_group_id(1)), (uint4)(0u));
@@ -830,6 +922,77 @@ __kernel void volumeRender(  __read_only image3d_t volData
                 write_imageui(outHitImg, (int2)(get_group_id(0), get_group_id(1)), (uint4)(1u));
         }
     }
+
+#ifdef COUNTERS
+    // reduce the counters of the work group in local memory, one work item adds them to the
+    // global counters
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (cntRays)
+    {
+        atomic_inc(&groupCounters[CNT_RAYS]);
+        atomic_add(&groupCounters[CNT_SAMPLES], cntSamples);
+        if (cntSkipped)
+            atomic_add(&groupCounters[CNT_BRICKS_SKIPPED], cntSkipped);
+        if (cntErt)
+            atomic_inc(&groupCounters[CNT_ERT]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (localId == 0)
+    {
+        for (int i = 0; i < CNT_COUNT; ++i)
+        {
+            if (groupCounters[i])
+                atomic_add(&counters[i], groupCounters[i]);
+        }
+    }
+#endif
+}
+
+//************************** Reprojection for LBG temporal history ************
+
+/**
+ * Image plane coordinates in [-1,+1] of a pixel position, same mapping as in volumeRender
+ * for the standard rendering mode.
+ */
+float2 pixelToImgCoords(float2 px, int2 bounds)
+{
+    float aspectRatio = bounds.x > bounds.y ? (float)(bounds.y) / (float)(bounds.x)
+                                            : (float)(bounds.x) / (float)(bounds.y);
+    float2 imgCoords = px / convert_float(max(bounds.x, bounds.y)) * 2.f;
+    imgCoords -= bounds.x > bounds.y ? (float2)(1.0f, aspectRatio) : (float2)(aspectRatio, 1.0f);
+    imgCoords.y *= -1.f;
+    return imgCoords;
+}
+
+/**
+ * Inverse of pixelToImgCoords.
+ */
+float2 imgCoordsToPixel(float2 imgCoords, int2 bounds)
+{
+    float aspectRatio = bounds.x > bounds.y ? (float)(bounds.y) / (float)(bounds.x)
+                                            : (float)(bounds.x) / (float)(bounds.y);
+    imgCoords.y *= -1.f;
+    imgCoords += bounds.x > bounds.y ? (float2)(1.0f, aspectRatio) : (float2)(aspectRatio, 1.0f);
+    return imgCoords * 0.5f * convert_float(max(bounds.x, bounds.y));
+}
+
+/**
+ * Project a point in (scaled) world space into the image of a perspective camera with the
+ * given view matrix. If infinite is set, p is a direction (background) instead of a point.
+ * Returns 0 if the point is behind the camera or outside of the image.
+ */
+int projectToView(float3 p, int infinite, float16 viewMat, float3 modelScale, int2 bounds,
+                  float2 *px)
+{
+    float3 d = (infinite ? p : p - viewMat.s37b*modelScale) / modelScale;
+    // the rotation part is orthogonal up to a uniform zoom factor that may be negative
+    float3 n = (float3)(dot(viewMat.s048, d), dot(viewMat.s159, d), dot(viewMat.s26a, d));
+    if (dot(cross(viewMat.s048, viewMat.s159), viewMat.s26a) < 0.f)
+        n = -n;
+    if (n.z > -1e-6f)
+        return 0;
+    *px = imgCoordsToPixel(n.xy / -n.z, bounds);
+    return all(*px >= (float2)(0.f)) && all(*px < convert_float2(bounds));
 }
 
 //************************** Interpolation Kernel for LBG Sampling ***********
@@ -847,6 +1010,12 @@ __kernel void interpolateLBG( __read_only image2d_t inImg
                             , const uint frameCnt
                             , const uint viewChanged
                             , const uint gazeChanged
+                            , __read_only image2d_t depthImg  // representative depth of samples
+                            , const float16 viewMat
+                            , __global float16 *lastViews   // view matrix of each last frame
+                            , const float3 modelScale
+                            , const uint reproject
+                            , const uint accumulate // lastFrames holds a moving average
                             )
 {
     // position to write back
@@ -878,6 +1047,11 @@ __kernel void interpolateLBG( __read_only image2d_t inImg
     uint16 neighborIds = ids[mapId];
     float16 neighborWeights = weights[mapId];
     int2 sampleCoord;
+    // color range of the neighbors for clamping reprojected frames, depth of the nearest one
+    float4 neighborMin = (float4)(FLT_MAX);
+    float4 neighborMax = (float4)(-FLT_MAX);
+    float depth = -1.f;
+    float maxWeight = 0.f;
     for (int i = 0; i < 16; ++i)
     {
         float neighborWeight = getf16(neighborWeights, i);
@@ -887,24 +1061,68 @@ __kernel void interpolateLBG( __read_only image2d_t inImg
             sampleCoord += gp - (inImg_bounds / 4);
             float4 sampleColor = read_imagef(inImg, nearestIntSmp, sampleCoord);
             result += sampleColor * neighborWeight;
+            if (reproject)
+            {
+                neighborMin = min(neighborMin, sampleColor);
+                neighborMax = max(neighborMax, sampleColor);
+                if (neighborWeight > maxWeight)
+                {
+                    maxWeight = neighborWeight;
+                    depth = read_imagef(depthImg, nearestIntSmp, sampleCoord).x;
+                }
+            }
         }
     }
     result.w = 1.f;
-    if (gazeChanged && !viewChanged)   // not a still image
+    int storeFrame = reproject ? (gazeChanged || viewChanged) : (gazeChanged && !viewChanged);
+    if (storeFrame && !accumulate)
         write_imagef(thisFrame, globalId, result); // write frame for temporal interpolation
-    // Temporal interpolation of last frames
+    // Temporal interpolation of last frames, a moving average has a single layer
+    // weighted with the number of frames it represents
     uint numFrames = frameId > frameCnt ? frameCnt : frameId;
-    if (!viewChanged)
-    {                       
-        for (uint i = 0; i < numFrames; ++i)
+    uint numLayers = accumulate ? min(numFrames, 1u) : numFrames;
+    float layerWeight = accumulate ? convert_float(numFrames) : 1.f;
+    float3 pos = (float3)(0.f);
+    int infinite = depth < 0.f;
+    if (reproject && numLayers > 0)
+    {
+        // world position of this pixel, or its view direction if no surface was hit
+        float2 imgCoords = pixelToImgCoords(convert_float2(globalId), outImg_bounds);
+        float3 nearPlanePos = fast_normalize((float3)(imgCoords, -1.0f));
+        float3 rayDir = (float3)(dot(viewMat.s012, nearPlanePos), dot(viewMat.s456, nearPlanePos),
+                                 dot(viewMat.s89a, nearPlanePos));
+        rayDir = fast_normalize(rayDir*modelScale);
+        pos = infinite ? rayDir : viewMat.s37b*modelScale + depth*rayDir;
+    }
+    if (reproject || !viewChanged)
+    {
+        float4 sum = result;
+        float count = 1.f;
+        for (uint i = 0; i < numLayers; ++i)
         {
-            float4 last = read_imagef(lastFrames, nearestIntSmp,
-                                      (int4)(globalId, (frameId-(i+1)) % numFrames, 0));
-            result += last;
+            uint slot = accumulate ? 0 : (frameId-(i+1)) % numFrames;
+            int2 lastCoords = globalId;
+            float16 lastView = viewMat;
+            if (reproject)
+            {
+                lastView = lastViews[slot];
+                float2 lastPx;
+                if (!projectToView(pos, infinite, lastView, modelScale, outImg_bounds, &lastPx))
+                    continue;   // outside of the last frame
+                lastCoords = convert_int2_rtz(lastPx);
+            }
+            float4 last = read_imagef(lastFrames, nearestIntSmp, (int4)(lastCoords, slot, 0));
+            // frames of another view may show occluded or disoccluded parts
+            if (any(lastView != viewMat))
+                last = clamp(last, neighborMin, neighborMax);
+            sum += last * layerWeight;
+            count += layerWeight;
         }
-        result /= convert_float(numFrames + 1);
+        result = sum / count;
     }
     result.w = 1.f;
+    if (storeFrame && accumulate)
+        write_imagef(thisFrame, globalId, result); // new moving average
     write_imagef(outImg, globalId, result);
 #endif
 
@@ -919,8 +1137,275 @@ __kernel void interpolateLBG( __read_only image2d_t inImg
 }
 
 
+//************************** Multi-resolution composition *********************
+
+/**
+ * Blend weight of a multi-resolution layer, 1 inside the disc of radius viewport.w around the
+ * gaze point, fading out over blendWidth pixels towards its border.
+ */
+float layerWeight(float gazeDistance, float4 viewport, float blendWidth)
+{
+    return 1.f - smoothstep(viewport.w - blendWidth, viewport.w, gazeDistance);
+}
+
+/**
+ * Bilinear lookup of a multi-resolution layer at a full resolution pixel position.
+ * The viewport holds the full resolution origin (xy) and pixel size (z) of the layer.
+ */
+float4 readLayer(__read_only image2d_t layer, float2 pos, float4 viewport)
+{
+    float2 layerCoords = (pos - viewport.xy) / (viewport.z * convert_float2(get_image_dim(layer)));
+    return read_imagef(layer, linearSmp, layerCoords);
+}
+
+/**
+ * Compose the layers of the multi-resolution mode. The periphery layer covers the whole image,
+ * the finer layers are upsampled and blended in on concentric discs around the gaze point.
+ * Layer viewports are full resolution origin (xy), pixel size (z) and disc radius (w).
+ */
+__kernel void composeMultiRes(  __read_only image2d_t fovea
+                              , __read_only image2d_t middle
+                              , __read_only image2d_t periphery
+                              , __write_only image2d_t outImg
+                              , const float4 foveaViewport
+                              , const float4 middleViewport
+                              , const float4 peripheryViewport
+                              , const float2 gpoint       // gaze point in pixels
+                              , const uint layers         // 2: fovea and periphery, 3: all
+                              , const float blendWidth    // width of the transitions in pixels
+                             )
+{
+    int2 globalId = (int2)(get_global_id(0), get_global_id(1));
+    if (any(globalId >= get_image_dim(outImg)))
+        return;
+
+    float2 pos = convert_float2(globalId) + 0.5f;   // pixel center
+    float gazeDistance = fast_length(pos - gpoint);
+    float4 result = readLayer(periphery, pos, peripheryViewport);
+    if (layers > 2)
+        result = mix(result, readLayer(middle, pos, middleViewport),
+                     layerWeight(gazeDistance, middleViewport, blendWidth));
+    result = mix(result, readLayer(fovea, pos, foveaViewport),
+                 layerWeight(gazeDistance, foveaViewport, blendWidth));
+    result.w = 1.f;
+    write_imagef(outImg, globalId, result);
+}
+
+
+//************************** Variable rate raycasting *************************
+
+/**
+ * Shading rate of a tile from a low resolution pre-pass: the lattice step (1, 2 or 4) follows
+ * the luminance deviation of the tile's pre-pass samples including a one sample border and is
+ * refined towards the gaze point, full rate in the fovea and at most step 2 up to twice its radius.
+ */
+__kernel void shadingRate(  __read_only image2d_t prepass
+                          , __write_only image2d_t rateImg
+                          , const uint tileSamples    // pre-pass samples per tile side
+                          , const float2 gpoint       // gaze point in pixels
+                          , const float foveaRadius   // in pixels
+                          , const float threshold     // luminance deviation that needs full rate
+                          , const uint tileSize       // in pixels
+                          , const uint2 imgSize       // output image size in pixels
+                          , __global uint4 *rateGroups          // work groups of the main pass
+                          , volatile __global uint *rateGroupCount
+                         )
+{
+    int2 tile = (int2)(get_global_id(0), get_global_id(1));
+    if (any(tile >= get_image_dim(rateImg)))
+        return;
+
+    int2 prepassBounds = get_image_dim(prepass);
+    int2 first = tile*convert_int(tileSamples) - 1;
+    float sum = 0.f;
+    float sumSq = 0.f;
+    float n = 0.f;
+    for (int y = 0; y < convert_int(tileSamples) + 2; ++y)
+    {
+        for (int x = 0; x < convert_int(tileSamples) + 2; ++x)
+        {
+            int2 coords = clamp(first + (int2)(x, y), (int2)(0), prepassBounds - 1);
+            float lum = dot(read_imagef(prepass, nearestIntSmp, coords).xyz,
+                            (float3)(0.299f, 0.587f, 0.114f));
+            sum += lum;
+            sumSq += lum*lum;
+            n += 1.f;
+        }
+    }
+    float mean = sum / n;
+    float deviation = sqrt(max(sumSq/n - mean*mean, 0.f));
+    uint step = deviation >= threshold ? 1u : (deviation >= threshold*0.25f ? 2u : 4u);
+
+    // eccentricity of the nearest point of the tile
+    float2 tileMin = convert_float2(tile*convert_int(tileSize));
+    float2 nearest = clamp(gpoint, tileMin, tileMin + convert_float(tileSize));
+    float gazeDistance = fast_length(nearest - gpoint);
+    if (gazeDistance < foveaRadius)
+        step = 1u;
+    else if (gazeDistance < 2.f*foveaRadius)
+        step = min(step, 2u);
+    write_imageui(rateImg, tile, (uint4)(step));
+
+    // append one work group per RATE_BLOCK x RATE_BLOCK block of the tile's lattice
+    int2 blockSize = (int2)(RATE_BLOCK*convert_int(step));
+    int2 tileOrigin = tile*convert_int(tileSize);
+    int2 tileExtent = min((int2)(convert_int(tileSize)), convert_int2(imgSize) - tileOrigin);
+    int2 blocks = (tileExtent + blockSize - 1) / blockSize;
+    uint slot = atomic_add(rateGroupCount, convert_uint(blocks.x*blocks.y));
+    for (int y = 0; y < blocks.y; ++y)
+    {
+        for (int x = 0; x < blocks.x; ++x)
+        {
+            int2 origin = tileOrigin + (int2)(x, y)*blockSize;
+            rateGroups[slot++] = (uint4)(convert_uint2(origin), step, 0u);
+        }
+    }
+}
+
+/**
+ * Nearest traced sample of a pixel position, snapped to the lattice of the tile it belongs to.
+ */
+float4 readLattice(__read_only image2d_t lattice, __read_only image2d_t rateImg, int2 pos,
+                   int tileSize)
+{
+    int step = convert_int(read_imageui(rateImg, nearestIntSmp, pos / tileSize).x);
+    return read_imagef(lattice, nearestIntSmp, (pos / step) * step);
+}
+
+/**
+ * Fill the pixels between the traced lattice samples of the variable rate pass.
+ * Bilinear weights of the four surrounding samples are attenuated by their color distance to
+ * the nearest one, so edges inside a coarse tile are not blurred.
+ */
+__kernel void fillVariableRate(  __read_only image2d_t lattice
+                               , __read_only image2d_t rateImg
+                               , __write_only image2d_t outImg
+                               , const uint tileSize
+                              )
+{
+    int2 globalId = (int2)(get_global_id(0), get_global_id(1));
+    int2 bounds = get_image_dim(outImg);
+    if (any(globalId >= bounds))
+        return;
+
+    int step = convert_int(read_imageui(rateImg, nearestIntSmp,
+                                        globalId / convert_int(tileSize)).x);
+    int2 base = (globalId / step) * step;
+    if (all(base == globalId))
+    {
+        write_imagef(outImg, globalId, read_imagef(lattice, nearestIntSmp, globalId));
+        return;
+    }
+
+    // samples beyond the image border are replaced by the last lattice row or column
+    int2 next = base + step;
+    next = select(next, base, next >= bounds);
+    float2 f = convert_float2(globalId - base) / convert_float(step);
+    float4 c00 = read_imagef(lattice, nearestIntSmp, base);
+    float4 c10 = readLattice(lattice, rateImg, (int2)(next.x, base.y), convert_int(tileSize));
+    float4 c01 = readLattice(lattice, rateImg, (int2)(base.x, next.y), convert_int(tileSize));
+    float4 c11 = readLattice(lattice, rateImg, next, convert_int(tileSize));
+    float4 w = (float4)((1.f - f.x)*(1.f - f.y), f.x*(1.f - f.y), (1.f - f.x)*f.y, f.x*f.y);
+
+    // edge-aware: range weights w.r.t. the nearest sample
+    float4 nearest = f.y < 0.5f ? (f.x < 0.5f ? c00 : c10) : (f.x < 0.5f ? c01 : c11);
+    const float invSigmaSq = 1.f / (0.1f*0.1f);
+    w.x *= native_exp(-dot(c00.xyz - nearest.xyz, c00.xyz - nearest.xyz) * invSigmaSq);
+    w.y *= native_exp(-dot(c10.xyz - nearest.xyz, c10.xyz - nearest.xyz) * invSigmaSq);
+    w.z *= native_exp(-dot(c01.xyz - nearest.xyz, c01.xyz - nearest.xyz) * invSigmaSq);
+    w.w *= native_exp(-dot(c11.xyz - nearest.xyz, c11.xyz - nearest.xyz) * invSigmaSq);
+    float4 result = (c00*w.x + c10*w.y + c01*w.z + c11*w.w) / max(w.x + w.y + w.z + w.w, 1e-6f);
+    result.w = 1.f;
+    write_imagef(outImg, globalId, result);
+}
+
+
+//************************** Pre-integrate transfer function ******************
+
+/**
+ * Opacity weighted color and opacity of the linearly interpolated transfer function,
+ * integrated from texel position 0 to x, using the cumulative integral at the texels.
+ */
+float4 integrateTff(__read_only image1d_t tffData, __read_only image1d_t tffIntegral, float x)
+{
+    int last = get_image_width(tffData) - 1;
+    int k = min((int)x, last);
+    float t = x - (float)k;
+    float4 c0 = read_imagef(tffData, nearestIntSmp, k);
+    float4 c1 = read_imagef(tffData, nearestIntSmp, min(k + 1, last));
+    float4 f0 = (float4)(c0.xyz * c0.w, c0.w);
+    float4 f1 = (float4)(c1.xyz * c1.w, c1.w);
+    return read_imagef(tffIntegral, nearestIntSmp, k) + t*f0 + 0.5f*t*t*(f1 - f0);
+}
+
+/**
+ * Build the pre-integration table of the transfer function: each texel holds the
+ * classification of a ray segment from a front density (x) to a back density (y).
+ * Colors are opacity weighted averages, alpha is the average opacity of the segment.
+ * Texel centers map to the same densities as the normalized linear lookup of the
+ * transfer function in the raycaster, averages are differences of the cumulative integral.
+ */
+__kernel void preIntegrateTff(  __read_only image1d_t tffData
+                              , __read_only image1d_t tffIntegral
+                              , __write_only image2d_t tffPreInt
+                             )
+{
+    int2 coord = (int2)(get_global_id(0), get_global_id(1));
+    int2 tableRes = get_image_dim(tffPreInt);
+    if(any(coord >= tableRes))
+        return;
+
+    int tffRes = get_image_width(tffData);
+    float2 density = (convert_float2(coord) + 0.5f) / convert_float2(tableRes);
+    float2 tffPos = clamp(density * (float)tffRes - 0.5f, 0.f, (float)(tffRes - 1));
+    float lower = min(tffPos.x, tffPos.y);
+    float upper = max(tffPos.x, tffPos.y);
+
+    float4 avg;
+    if (upper - lower > 1e-3f)
+        avg = (integrateTff(tffData, tffIntegral, upper)
+                - integrateTff(tffData, tffIntegral, lower)) / (upper - lower);
+    else    // segment of constant density: the transfer function itself
+    {
+        float4 c = read_imagef(tffData, linearSmp, density.x);
+        avg = (float4)(c.xyz * c.w, c.w);
+    }
+
+    float4 result;
+    result.w = avg.w;
+    if (avg.w > 0.f)
+        result.xyz = avg.xyz / avg.w;
+    else
+        result.xyz = read_imagef(tffData, linearSmp, density.x).xyz;
+
+    write_imagef(tffPreInt, coord, clamp(result, 0.f, 1.f));
+}
+
+
 #pragma OPENCL EXTENSION cl_khr_3d_image_writes : enable
 
+//************************** Generate ambient occlusion volume ***************
+
+__kernel void generateAoVolume(  __read_only image3d_t volData
+                               , __read_only image1d_t tffData
+                               , __write_only image3d_t aoVol
+                              )
+{
+    int3 coord = (int3)(get_global_id(0), get_global_id(1), get_global_id(2));
+    int3 aoRes = get_image_dim(aoVol).xyz;
+    if(any(coord >= aoRes))
+        return;
+
+    // sample at the center of the low resolution cell, step with the cell size
+    float3 pos = (convert_float3(coord) + 0.5f) / convert_float3(aoRes);
+    float3 cellLen = (float3)(1.f) / convert_float3(aoRes);
+    float stepSize = length(cellLen) * 0.5f;
+    float ao = calcAO(volData, tffData, pos, stepSize, length(cellLen)*4.f);
+
+    write_imagef(aoVol, (int4)(coord, 0), (float4)(ao));
+}
+
+
 //************************** Generate brick volume ***************************
 
 __kernel void generateBricks(  __read_only image3d_t volData
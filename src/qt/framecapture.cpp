@@ -0,0 +1,294 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "src/qt/framecapture.h"
+#include "src/core/tracer.h"
+
+#include <cstring>
+
+#include <QDebug>
+#include <QDir>
+#include <QImage>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QThread>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+/**
+ * @brief FrameCapture::FrameCapture
+ */
+FrameCapture::FrameCapture()
+    : _nextSlot(0)
+    , _active(false)
+    , _stopping(false)
+    , _pipe(nullptr)
+    , _captured(0)
+    , _dropped(0)
+    , _written(0)
+{
+}
+
+/**
+ * @brief FrameCapture::~FrameCapture
+ */
+FrameCapture::~FrameCapture()
+{
+    // GL buffers are released with the context, only join the encoders here
+    if (_active && QOpenGLContext::currentContext())
+        stop();
+    else if (_active)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        for (std::thread &t : _encoders)
+            t.join();
+        if (_pipe)
+            pclose(_pipe);
+    }
+}
+
+void FrameCapture::setCommand(const QString &command)
+{
+    _command = command;
+}
+
+bool FrameCapture::isActive() const
+{
+    return _active;
+}
+
+/**
+ * @brief FrameCapture::start
+ * @param directory
+ */
+void FrameCapture::start(const QString &directory)
+{
+    if (_active)
+        return;
+    _directory = directory;
+    if (_command.isEmpty() && !QDir(_directory).exists())
+        QDir().mkpath(_directory);
+
+    _captured = 0;
+    _dropped = 0;
+    _written = 0;
+    _nextSlot = 0;
+    _stopping = false;
+    _active = true;
+
+    // frames piped to an encoder have to stay in order
+    const int threads = _command.isEmpty() ? qMax(1, QThread::idealThreadCount() / 2) : 1;
+    for (int i = 0; i < threads; ++i)
+        _encoders.emplace_back(&FrameCapture::encoderLoop, this);
+}
+
+/**
+ * @brief FrameCapture::stop
+ * @return
+ */
+FrameCapture::Stats FrameCapture::stop()
+{
+    Stats stats;
+    if (!_active)
+        return stats;
+
+    // collect outstanding read backs in issue order
+    for (size_t i = 0; i < PBO_COUNT; ++i)
+    {
+        Slot &slot = _slots[(_nextSlot + i) % PBO_COUNT];
+        if (slot.pending)
+            collect(slot);
+        if (slot.pbo.isCreated())
+            slot.pbo.destroy();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _cv.notify_all();
+    for (std::thread &t : _encoders)
+        t.join();
+    _encoders.clear();
+    if (_pipe)
+    {
+        pclose(_pipe);
+        _pipe = nullptr;
+    }
+    _active = false;
+
+    stats.captured = _captured;
+    stats.dropped = _dropped;
+    stats.written = _written;
+    if (stats.dropped > 0)
+        qWarning() << "Frame capture dropped" << stats.dropped << "of" << stats.captured << "frames.";
+    return stats;
+}
+
+/**
+ * @brief FrameCapture::capture
+ * @param name
+ * @param width
+ * @param height
+ */
+void FrameCapture::capture(const QString &name, const int width, const int height)
+{
+    if (!_active || width <= 0 || height <= 0)
+        return;
+    TRACE_SCOPE("captureFrame", "capture");
+
+    // the slot was issued PBO_COUNT frames ago, its copy has most likely finished
+    Slot &slot = _slots[_nextSlot];
+    if (slot.pending)
+        collect(slot);
+
+    const int size = width*height*4;
+    if (!slot.pbo.isCreated())
+    {
+        slot.pbo.create();
+        slot.pbo.setUsagePattern(QOpenGLBuffer::StreamRead);
+    }
+    slot.pbo.bind();
+    if (slot.pbo.size() != size)
+        slot.pbo.allocate(size);
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    f->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    slot.pbo.release();
+
+    slot.name = name;
+    slot.width = width;
+    slot.height = height;
+    slot.pending = true;
+    ++_captured;
+    _nextSlot = (_nextSlot + 1) % PBO_COUNT;
+}
+
+/**
+ * @brief Map a finished read back and hand it to the encoders, or drop it if they are busy.
+ */
+void FrameCapture::collect(Slot &slot)
+{
+    slot.pending = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_queue.size() >= QUEUE_SIZE)
+        {
+            ++_dropped;
+            return;
+        }
+    }
+
+    Frame frame;
+    frame.name = slot.name;
+    frame.width = slot.width;
+    frame.height = slot.height;
+    slot.pbo.bind();
+    const void *data = slot.pbo.mapRange(0, slot.width*slot.height*4, QOpenGLBuffer::RangeRead);
+    if (data)
+    {
+        frame.pixels = QByteArray(static_cast<const char*>(data), slot.width*slot.height*4);
+        slot.pbo.unmap();
+    }
+    slot.pbo.release();
+    if (!data)
+    {
+        ++_dropped;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(std::move(frame));
+    }
+    _cv.notify_one();
+}
+
+/**
+ * @brief Encoder thread: write queued frames until the capture is stopped and the queue is empty.
+ */
+void FrameCapture::encoderLoop()
+{
+    Tracer::setThreadName("frame encoder");
+    for (;;)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this]{ return _stopping || !_queue.empty(); });
+            if (_queue.empty())
+                return;
+            frame = std::move(_queue.front());
+            _queue.pop_front();
+        }
+        encode(frame);
+    }
+}
+
+/**
+ * @brief FrameCapture::encode
+ * @param frame
+ */
+void FrameCapture::encode(const Frame &frame)
+{
+    TRACE_SCOPE("encodeFrame", "capture");
+    if (!_command.isEmpty())
+    {
+        // only one encoder thread in pipe mode
+        if (!_pipe)
+        {
+            const QString cmd = QString(_command).arg(frame.width).arg(frame.height);
+#ifdef _WIN32
+            _pipe = popen(cmd.toLocal8Bit().constData(), "wb");
+#else
+            _pipe = popen(cmd.toLocal8Bit().constData(), "w");
+#endif
+            if (!_pipe)
+            {
+                qCritical() << "Could not start frame encoder" << cmd;
+                return;
+            }
+        }
+        if (fwrite(frame.pixels.constData(), 1, static_cast<size_t>(frame.pixels.size()), _pipe)
+                == static_cast<size_t>(frame.pixels.size()))
+            ++_written;
+        return;
+    }
+
+    // OpenGL rows are bottom-up
+    QImage img(frame.width, frame.height, QImage::Format_RGBA8888);
+    const int rowBytes = frame.width*4;
+    for (int y = 0; y < frame.height; ++y)
+        memcpy(img.scanLine(frame.height - 1 - y), frame.pixels.constData() + y*rowBytes,
+               static_cast<size_t>(rowBytes));
+    if (img.save(QDir(_directory).filePath(frame.name + ".png")))
+        ++_written;
+    else
+        qWarning() << "Could not write frame" << frame.name;
+}
@@ -0,0 +1,135 @@
+/**
+ * \file
+ *
+ * \author Valentin Bruder
+ *
+ * \copyright Copyright (C) 2018 Valentin Bruder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QByteArray>
+#include <QOpenGLBuffer>
+#include <QString>
+
+/**
+ * @brief Asynchronous frame capture for screenshots and video recording.
+ *        The framebuffer is read back into a ring of pixel buffer objects, so the GPU copy
+ *        overlaps with the following frames. Finished read backs are handed to a bounded queue
+ *        consumed by encoder threads which either write a PNG sequence or pipe raw RGBA frames
+ *        to an external encoder process (e.g. ffmpeg). Frames that do not fit into the queue are
+ *        dropped and counted instead of stalling the render loop.
+ */
+class FrameCapture
+{
+public:
+    struct Stats
+    {
+        quint64 captured = 0;   // read backs issued
+        quint64 dropped = 0;    // frames discarded because the encoders were busy
+        quint64 written = 0;    // frames encoded
+    };
+
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    /**
+     * @brief Set a shell command raw frames are piped to instead of writing PNG files.
+     *        %1 and %2 are replaced by the frame width and height, e.g.
+     *        "ffmpeg -y -f rawvideo -pix_fmt rgba -s %1x%2 -r 60 -i - -vf vflip out.mp4".
+     *        Frames are piped bottom-up as read from OpenGL.
+     */
+    void setCommand(const QString &command);
+
+    /**
+     * @brief Start a capture session writing to the given directory.
+     */
+    void start(const QString &directory);
+
+    /**
+     * @brief Collect all pending read backs, wait for the encoders and release the buffers.
+     *        Requires the OpenGL context of the captured framebuffer to be current.
+     * @return Statistics of the session.
+     */
+    Stats stop();
+
+    bool isActive() const;
+
+    /**
+     * @brief Queue an asynchronous read back of the currently bound framebuffer.
+     *        Requires a current OpenGL context.
+     * @param name File name of the frame without extension.
+     * @param width Framebuffer width in pixels.
+     * @param height Framebuffer height in pixels.
+     */
+    void capture(const QString &name, const int width, const int height);
+
+private:
+    struct Frame
+    {
+        QString name;
+        int width = 0;
+        int height = 0;
+        QByteArray pixels;      // RGBA, bottom-up
+    };
+
+    struct Slot
+    {
+        QOpenGLBuffer pbo = QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer);
+        QString name;
+        int width = 0;
+        int height = 0;
+        bool pending = false;
+    };
+
+    void collect(Slot &slot);
+    void encoderLoop();
+    void encode(const Frame &frame);
+
+    static const size_t PBO_COUNT = 3;
+    static const size_t QUEUE_SIZE = 8;
+
+    std::array<Slot, PBO_COUNT> _slots;
+    size_t _nextSlot;
+
+    std::deque<Frame> _queue;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::vector<std::thread> _encoders;
+    bool _active;
+    bool _stopping;
+
+    QString _directory;
+    QString _command;
+    FILE *_pipe;
+
+    quint64 _captured;
+    std::atomic<quint64> _dropped;
+    std::atomic<quint64> _written;
+};
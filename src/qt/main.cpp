@@ -21,7 +21,9 @@
  */
 
 #include "src/qt/mainwindow.h"
+#include "src/core/tracer.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QErrorMessage>
 
 int main(int argc, char *argv[])
@@ -29,8 +31,78 @@ int main(int argc, char *argv[])
     QApplication a(argc, argv);
     QErrorMessage::qtHandler();
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"trace", "Record a Chrome trace of the session to <file>.", "file"});
+    parser.addOption({"capture-command", "Pipe recorded frames to an encoder command, "
+                      "%1 and %2 are replaced by width and height.", "command"});
+    parser.addOption({"gaze-prediction", "Predict the gaze at the expected display time of a frame."});
+    parser.addOption({"display-latency", "Time from the end of a frame until it is shown, "
+                      "used for gaze prediction.", "ms", "16"});
+    parser.addOption({"pixels-per-degree", "Eye tracker display resolution in pixels per degree.",
+                      "ppd", "40"});
+    parser.addOption({"gaze-filter", "Filter the gaze and keep the image during fixations."});
+    parser.addOption({"fixation-detection", "Fixation detection method, ivt (velocity) or "
+                      "idt (dispersion).", "method", "ivt"});
+    parser.addOption({"gaze-source", "Gaze source used for eyetracking: tobii, mouse, an "
+                      "interaction log to replay or udp:<port>.", "source", "tobii"});
+    parser.addOption({"progressive-refinement", "Refine still LBG frames to full resolution in "
+                      "<passes> idle frames.", "passes"});
+    parser.addOption({"reprojection", "Reproject the LBG temporal history on camera motion."});
+    parser.addOption({"history", "LBG temporal history, ema (moving average) or frames.",
+                      "mode", "ema"});
+    parser.addOption({"history-depth", "Frames in the LBG temporal history.", "frames", "8"});
+    parser.addOption({"history-format", "Format of the LBG temporal history, output, half or "
+                      "float.", "format", "output"});
+    parser.addOption({"multires-layers", "Layers of the multi-resolution rendering method, 2 or 3.",
+                      "layers", "3"});
+    parser.addOption({"multires-fovea", "Radius of the full resolution multi-resolution layer, "
+                      "fraction of the larger image side.", "radius", "0.15"});
+    parser.addOption({"multires-scale", "Resolution factor between multi-resolution layers.",
+                      "factor", "2"});
+    parser.addOption({"vrs-fovea", "Full rate radius of the variable rate method, fraction of the "
+                      "larger image side.", "radius", "0.1"});
+    parser.addOption({"vrs-threshold", "Luminance deviation of a tile that is traced at full rate "
+                      "by the variable rate method.", "deviation", "0.02"});
+    parser.process(a);
+    Tracer::setThreadName("main");
+    if (parser.isSet("trace"))
+        Tracer::start(parser.value("trace").toStdString());
+
     MainWindow w;
+    if (parser.isSet("capture-command"))
+        w.setCaptureCommand(parser.value("capture-command"));
+    w.setGazePrediction(parser.isSet("gaze-prediction"), parser.value("display-latency").toDouble(),
+                        parser.value("pixels-per-degree").toDouble());
+    w.setGazeFilter(parser.isSet("gaze-filter"),
+                    parser.value("fixation-detection") == "idt" ? GazeFilter::IDT : GazeFilter::IVT,
+                    parser.value("pixels-per-degree").toDouble());
+    w.setGazeSource(parser.value("gaze-source"));
+    w.setReprojection(parser.isSet("reprojection"));
+    TemporalHistory::Parameters history;
+    history.mode = parser.value("history") == "frames" ? TemporalHistory::FRAMES
+                                                       : TemporalHistory::ACCUMULATE;
+    history.depth = parser.value("history-depth").toUInt();
+    const QString historyFormat = parser.value("history-format");
+    history.format = historyFormat == "float" ? TemporalHistory::FORMAT_FLOAT
+                                              : (historyFormat == "half" ? TemporalHistory::FORMAT_HALF
+                                                                         : TemporalHistory::FORMAT_OUTPUT);
+    w.setTemporalHistory(history);
+    VolumeRenderCL::MultiResParameters multiRes;
+    multiRes.layers = parser.value("multires-layers").toUInt();
+    multiRes.foveaRadius = parser.value("multires-fovea").toFloat();
+    multiRes.scale = parser.value("multires-scale").toUInt();
+    w.setMultiResParameters(multiRes);
+    VolumeRenderCL::VariableRateParameters variableRate;
+    variableRate.foveaRadius = parser.value("vrs-fovea").toFloat();
+    variableRate.threshold = parser.value("vrs-threshold").toFloat();
+    w.setVariableRateParameters(variableRate);
+    if (parser.isSet("progressive-refinement"))
+        w.setProgressiveRefinement(true, parser.value("progressive-refinement").toUInt());
     w.show();
 
-    return a.exec();
+    int ret = a.exec();
+    if (Tracer::isEnabled())
+        Tracer::stop();
+    return ret;
 }
@@ -22,6 +22,7 @@
 
 #include "src/qt/mainwindow.h"
 #include "ui_mainwindow.h"
+#include "src/core/tracer.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
@@ -104,6 +105,8 @@ MainWindow::MainWindow(QWidget *parent) :
             ui->volumeRenderWidget, &VolumeRenderWidget::do_all_Benchmarks);
     connect(ui->actionPlay_interaction_sequence, &QAction::triggered,
             this, &MainWindow::playInteractionSequence);
+    ui->actionRecordTrace->setChecked(Tracer::isEnabled());   // may be started from command line
+    connect(ui->actionRecordTrace, &QAction::toggled, this, &MainWindow::toggleTracing);
 
     // future watcher for concurrent data loading
     _watcher = new QFutureWatcher<void>(this);
@@ -123,6 +126,8 @@ MainWindow::MainWindow(QWidget *parent) :
             ui->volumeRenderWidget, &VolumeRenderWidget::setImageSamplingRate);
     connect(ui->cbIllum, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
             ui->volumeRenderWidget, &VolumeRenderWidget::setIllumination);
+    connect(ui->cbPrecision, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            ui->volumeRenderWidget, &VolumeRenderWidget::setImagePrecision);
     connect(ui->pbBgColor, &QPushButton::released, this, &MainWindow::chooseBackgroundColor);
 	connect(ui->setRdMt, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
 		ui->volumeRenderWidget, &VolumeRenderWidget::setRenderingMethod);
@@ -141,6 +146,8 @@ MainWindow::MainWindow(QWidget *parent) :
             ui->volumeRenderWidget, &VolumeRenderWidget::setContours);
     connect(ui->chbAerial, &QCheckBox::toggled,
             ui->volumeRenderWidget, &VolumeRenderWidget::setAerial);
+    connect(ui->chbPreIntegration, &QCheckBox::toggled,
+            ui->volumeRenderWidget, &VolumeRenderWidget::setPreIntegration);
     connect(ui->chbImageESS, &QCheckBox::toggled,
             ui->volumeRenderWidget, &VolumeRenderWidget::setImgEss);
     connect(ui->chbObjectESS, &QCheckBox::toggled,
@@ -191,6 +198,95 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+/**
+ * @brief MainWindow::setCaptureCommand
+ * @param command
+ */
+void MainWindow::setCaptureCommand(const QString &command)
+{
+    ui->volumeRenderWidget->setCaptureCommand(command);
+}
+
+/**
+ * @brief MainWindow::setGazePrediction
+ * @param enabled
+ * @param displayLatency
+ * @param pixelsPerDegree
+ */
+void MainWindow::setGazePrediction(const bool enabled, const double displayLatency,
+                                   const double pixelsPerDegree)
+{
+    ui->volumeRenderWidget->setGazePrediction(enabled, displayLatency, pixelsPerDegree);
+}
+
+/**
+ * @brief MainWindow::setGazeFilter
+ * @param enabled
+ * @param method
+ * @param pixelsPerDegree
+ */
+void MainWindow::setGazeFilter(const bool enabled, const GazeFilter::Method method,
+                               const double pixelsPerDegree)
+{
+    ui->volumeRenderWidget->setGazeFilter(enabled, method, pixelsPerDegree);
+}
+
+/**
+ * @brief MainWindow::setGazeSource
+ * @param source
+ * @return
+ */
+bool MainWindow::setGazeSource(const QString &source)
+{
+    return ui->volumeRenderWidget->setGazeSource(source);
+}
+
+/**
+ * @brief MainWindow::setProgressiveRefinement
+ * @param enabled
+ * @param passes
+ */
+void MainWindow::setProgressiveRefinement(const bool enabled, const unsigned int passes)
+{
+    ui->volumeRenderWidget->setProgressiveRefinement(enabled, passes);
+}
+
+/**
+ * @brief MainWindow::setReprojection
+ * @param reprojection
+ */
+void MainWindow::setReprojection(const bool reprojection)
+{
+    ui->volumeRenderWidget->setReprojection(reprojection);
+}
+
+/**
+ * @brief MainWindow::setTemporalHistory
+ * @param parameters
+ */
+void MainWindow::setTemporalHistory(const TemporalHistory::Parameters &parameters)
+{
+    ui->volumeRenderWidget->setTemporalHistory(parameters);
+}
+
+/**
+ * @brief MainWindow::setMultiResParameters
+ * @param parameters
+ */
+void MainWindow::setMultiResParameters(const VolumeRenderCL::MultiResParameters &parameters)
+{
+    ui->volumeRenderWidget->setMultiResParameters(parameters);
+}
+
+/**
+ * @brief MainWindow::setVariableRateParameters
+ * @param parameters
+ */
+void MainWindow::setVariableRateParameters(const VolumeRenderCL::VariableRateParameters &parameters)
+{
+    ui->volumeRenderWidget->setVariableRateParameters(parameters);
+}
+
 
 /**
  * @brief MainWindow::closeEvent
@@ -370,6 +466,8 @@ void MainWindow::loadCamState()
             ui->chbContours->setChecked(json["showContours"].toBool());
     if (json.contains("useAerial") && json["useAerial"].isBool())
             ui->chbAerial->setChecked(json["useAerial"].toBool());
+    if (json.contains("usePreIntegration") && json["usePreIntegration"].isBool())
+            ui->chbPreIntegration->setChecked(json["usePreIntegration"].toBool());
     if (json.contains("showBox") && json["showBox"].isBool())
             ui->chbBox->setChecked(json["showBox"].toBool());
     if (json.contains("useOrtho") && json["useOrtho"].isBool())
@@ -423,6 +521,7 @@ void MainWindow::saveCamState()
     stateObject["useAO"] = ui->chbAmbientOcclusion->isChecked();
     stateObject["showContours"] = ui->chbContours->isChecked();
     stateObject["useAerial"] = ui->chbAerial->isChecked();
+    stateObject["usePreIntegration"] = ui->chbPreIntegration->isChecked();
     stateObject["showBox"] = ui->chbBox->isChecked();
     stateObject["useOrtho"] = ui->chbOrtho->isChecked();
     // camera parameters
@@ -859,3 +958,29 @@ void MainWindow::playInteractionSequence()
         _settings->setValue( "LastInteractionSequence", pickedFile );
     }
 }
+
+/**
+ * @brief Start recording a Chrome trace or stop and write it.
+ * @param record
+ */
+void MainWindow::toggleTracing(bool record)
+{
+    if (!record)
+    {
+        if (Tracer::isEnabled())
+            Tracer::stop();
+        return;
+    }
+    QFileDialog dia;
+    QString defaultPath = _settings->value( "LastTraceFile" ).toString();
+    QString pickedFile = dia.getSaveFileName(
+                this, tr("Save Performance Trace"),
+                defaultPath, tr("Chrome trace files (*.json)"));
+    if (pickedFile.isEmpty())
+    {
+        ui->actionRecordTrace->setChecked(false);
+        return;
+    }
+    Tracer::start(pickedFile.toStdString());
+    _settings->setValue( "LastTraceFile", pickedFile );
+}
@@ -40,6 +40,9 @@
 #include <QSettings>
 #include <QVector4D>
 
+#include "src/gaze/gazefilter.h"
+#include "src/core/volumerendercl.h"
+
 namespace Ui {
 class MainWindow;
 }
@@ -52,6 +55,21 @@ public:
     explicit MainWindow(QWidget *parent = 0);
 	~MainWindow();
 
+    /**
+     * @brief Pipe recorded frames to an external encoder instead of writing PNG files.
+     */
+    void setCaptureCommand(const QString &command);
+    void setGazePrediction(const bool enabled, const double displayLatency,
+                           const double pixelsPerDegree);
+    void setGazeFilter(const bool enabled, const GazeFilter::Method method,
+                       const double pixelsPerDegree);
+    bool setGazeSource(const QString &source);
+    void setProgressiveRefinement(const bool enabled, const unsigned int passes);
+    void setReprojection(const bool reprojection);
+    void setTemporalHistory(const TemporalHistory::Parameters &parameters);
+    void setMultiResParameters(const VolumeRenderCL::MultiResParameters &parameters);
+    void setVariableRateParameters(const VolumeRenderCL::VariableRateParameters &parameters);
+
 protected slots:
     void openVolumeFile();
 
@@ -74,6 +92,7 @@ protected slots:
     void nextTimestep();
     void setPlaybackSpeed(int speed);
     void playInteractionSequence();
+    void toggleTracing(bool record);
 protected:
     void dragEnterEvent(QDragEnterEvent *ev) Q_DECL_OVERRIDE;
     void dropEvent(QDropEvent *ev) Q_DECL_OVERRIDE;
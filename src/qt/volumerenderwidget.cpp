@@ -21,6 +21,9 @@
  */
 
 #include "src/qt/volumerenderwidget.h"
+#include "src/core/benchmarkrunner.h"
+#include "src/core/tracer.h"
+#include "src/core/trajectory.h"
 
 #include <QPainter>
 #include <QGradient>
@@ -29,11 +32,17 @@
 #include <QScreen>
 #include <QInputDialog>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QApplication>
 #include <QErrorMessage>
 #include <QLoggingCategory>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QDateTime>
+#include <QTimer>
+#include <QtConcurrentRun>
 
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
@@ -72,12 +81,11 @@ VolumeRenderWidget::VolumeRenderWidget(QWidget *parent)
     , _tffRange(QPoint(0, 255))
     , _timestep(0)
     , _eyetracker(nullptr)
+    , _gazeSource(new TobiiGazeSource(_gazeBuffer))
     , _monitor_offset(QPoint(0,0))
     , _curr_monitor_width(0)
     , _curr_monitor_height(0)
     , _lastLocalCursorPos(QPoint(0,0))
-    , _rotQuat(QQuaternion(1, 0, 0, 0))
-    , _translation(QVector3D(0, 0, 2.0))
     , _useEyetracking(false)
     , _noUpdate(true)
     , _loadingFinished(false)
@@ -93,6 +101,15 @@ VolumeRenderWidget::VolumeRenderWidget(QWidget *parent)
     , _renderingMethod(Standard)
 {
     this->setMouseTracking(true);
+    // the swap of a frame that used a gaze sample completes its latency record
+    connect(this, &QOpenGLWidget::frameSwapped, this, [this]() {
+        if (_latency.present() && _logInteraction)
+            _interactionLog.logLatency(_timer.elapsed(), _latency.last());
+    });
+    connect(&_benchmarkWatcher, &QFutureWatcher<size_t>::finished, this, [this]() {
+        QApplication::restoreOverrideCursor();
+        updateView();
+    });
 }
 
 
@@ -101,6 +118,13 @@ VolumeRenderWidget::VolumeRenderWidget(QWidget *parent)
  */
 VolumeRenderWidget::~VolumeRenderWidget()
 {
+    _benchmarkWatcher.waitForFinished();
+    if (_capture.isActive())
+    {
+        makeCurrent();
+        _capture.stop();
+        doneCurrent();
+    }
 }
 
 
@@ -161,6 +185,193 @@ void VolumeRenderWidget::paintFps(QPainter &p, const double fps, const double la
     p.drawText(10, 36, s);
     s = QString(_volumerender.getCurrentDeviceName().c_str());
     p.drawText(10, 52, s);
+    // per stage device times in ms, mean and 99th percentile over the recent frames
+    const FrameTimingHistory &history = _volumerender.getTimingHistory();
+    s = "";
+    for (timing_id id : {TIMING_RAYCAST, TIMING_INTERPOLATE, TIMING_COPY, TIMING_READ})
+    {
+        const TimingStats stats = history.getStats(id);
+        if (stats.p99 > 0.0)
+            s += QString("%1: %2/%3  ").arg(timingName(id)).arg(stats.mean*1e3, 0, 'f', 2)
+                                        .arg(stats.p99*1e3, 0, 'f', 2);
+    }
+    p.drawText(10, 68, s);
+#ifdef KERNEL_COUNTERS
+    const FrameTiming last = history.last();
+    s = "";
+    for (int i = 0; i < COUNTER_COUNT; ++i)
+        s += QString("%1: %2  ").arg(counterName(static_cast<counter_id>(i)))
+                                .arg(static_cast<qulonglong>(last.counters.at(i)));
+    p.drawText(10, 84, s);
+#endif
+    paintPerformanceHud(p);
+}
+
+
+/**
+ * @brief Draw the performance overlay: scrolling frame time graph with the device stages
+ *        stacked per frame, mean stage breakdown, device memory and foveation parameters.
+ *        Everything is taken from the recorded timing history, no device synchronization.
+ */
+void VolumeRenderWidget::paintPerformanceHud(QPainter &p)
+{
+    const FrameTimingHistory &history = _volumerender.getTimingHistory();
+    const QRectF graph(10, height() - 140, qMin(512, width() - 20), 100);
+    if (history.size() == 0 || graph.width() < 64 || graph.top() < 100)
+        return;
+
+    static const std::array<timing_id, 6> stages = {{ TIMING_ACQUIRE, TIMING_RAYCAST,
+        TIMING_INTERPOLATE, TIMING_COPY, TIMING_READ, TIMING_RELEASE }};
+    static const std::array<QColor, 6> colors = {{ QColor(120, 120, 220), QColor(230, 120, 40),
+        QColor(60, 180, 220), QColor(200, 60, 160), QColor(120, 200, 80), QColor(160, 160, 160) }};
+
+    // scale to the slowest recent frames, but show at least the 30 Hz budget
+    const double range = 1.1 * std::max({ 1.0/30.0, history.getStats(TIMING_INTERVAL).p99,
+                                          history.getStats(TIMING_DEVICE).p99 });
+    const auto toY = [&](const double t) {
+        return graph.bottom() - std::min(t / range, 1.0) * graph.height();
+    };
+
+    p.setRenderHint(QPainter::Antialiasing, false);
+    p.fillRect(graph, QColor(0, 0, 0, 140));
+
+    // one column per frame, newest on the right
+    const size_t columns = std::min(history.size(), static_cast<size_t>(graph.width() / 2));
+    const double columnWidth = graph.width() / columns;
+    const size_t first = history.size() - columns;
+    QPolygonF frameTimes;
+    for (size_t i = 0; i < columns; ++i)
+    {
+        const FrameTiming &frame = history.at(first + i);
+        const double x = graph.left() + i * columnWidth;
+        double t = 0.0;
+        for (size_t j = 0; j < stages.size(); ++j)
+        {
+            const double d = frame.values.at(stages.at(j));
+            if (d <= 0.0)
+                continue;
+            p.fillRect(QRectF(QPointF(x, toY(t + d)), QPointF(x + columnWidth, toY(t))), colors.at(j));
+            t += d;
+        }
+        frameTimes << QPointF(x + 0.5 * columnWidth, toY(frame.values.at(TIMING_INTERVAL)));
+    }
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setPen(QPen(Qt::white, 1.5));
+    p.drawPolyline(frameTimes);
+
+    // frame budgets
+    p.setFont(QFont("Helvetica", 8));
+    p.setPen(QPen(QColor(255, 255, 255, 160), 1, Qt::DashLine));
+    for (const int hz : {60, 30})
+    {
+        const double y = toY(1.0 / hz);
+        p.drawLine(QPointF(graph.left(), y), QPointF(graph.right(), y));
+        p.drawText(QPointF(graph.right() - 36, y - 2), QString("%1 Hz").arg(hz));
+    }
+    p.drawText(QPointF(graph.left() + 2, graph.top() + 10),
+               QString("%1 ms").arg(range * 1e3, 0, 'f', 1));
+
+    // mean stage breakdown relative to the mean frame time, the rest is host/idle time
+    const QRectF bar(graph.left(), graph.bottom() + 4, graph.width(), 8);
+    const double frameMean = std::max(history.getStats(TIMING_INTERVAL).mean,
+                                      history.getStats(TIMING_DEVICE).mean);
+    p.fillRect(bar, QColor(80, 80, 80, 180));
+    double x = bar.left();
+    QString legend;
+    for (size_t j = 0; j < stages.size(); ++j)
+    {
+        const double mean = history.getStats(stages.at(j)).mean;
+        if (mean <= 0.0 || frameMean <= 0.0)
+            continue;
+        const double w = bar.width() * mean / frameMean;
+        p.fillRect(QRectF(x, bar.top(), w, bar.height()), colors.at(j));
+        x += w;
+    }
+    p.setFont(QFont("Helvetica", 9));
+    double legendX = bar.left();
+    for (size_t j = 0; j < stages.size(); ++j)
+    {
+        if (history.getStats(stages.at(j)).mean <= 0.0)
+            continue;
+        p.fillRect(QRectF(legendX, bar.bottom() + 6, 8, 8), colors.at(j));
+        const QString name = timingName(stages.at(j));
+        p.setPen(Qt::darkGreen);
+        p.drawText(QPointF(legendX + 11, bar.bottom() + 14), name);
+        legendX += 18 + p.fontMetrics().width(name);
+    }
+
+    // device memory and foveation parameters
+    p.setFont(QFont("Helvetica", 11));
+    p.setPen(Qt::darkGreen);
+    const double mib = 1024.0 * 1024.0;
+    QString s = QString("Device memory: %1 / %2 MiB")
+            .arg(_volumerender.getDeviceMemoryUsage() / mib, 0, 'f', 1)
+            .arg(_volumerender.getDeviceMemorySize() / mib, 0, 'f', 0);
+    p.drawText(QPointF(graph.left(), graph.top() - 22), s);
+    if (_useEyetracking && _latency.size() > 0)
+    {
+        // gaze-to-photon distribution and mean time spent in each stage, in ms
+        const TimingStats total = _latency.getStats(STAGE_CAPTURE, STAGE_PRESENT);
+        s = QString("Gaze-to-photon: %1/%2/%3/%4 ms (min/mean/p95/p99),")
+                .arg(total.min*1e3, 0, 'f', 1).arg(total.mean*1e3, 0, 'f', 1)
+                .arg(total.p95*1e3, 0, 'f', 1).arg(total.p99*1e3, 0, 'f', 1);
+        for (int i = STAGE_RECEIVE; i < STAGE_COUNT; ++i)
+            s += QString(" %1 %2").arg(latencyStageName(static_cast<latency_stage>(i)))
+                    .arg(_latency.getStageStats(static_cast<latency_stage>(i)).mean*1e3, 0, 'f', 1);
+        p.drawText(QPointF(graph.left(), graph.top() - 38), s);
+    }
+    if (_renderingMethod == LBG_Sampling)
+    {
+        const cl_float2 gaze = _volumerender.getGazePoint();
+        const TemporalHistory &history = _volumerender.getTemporalHistory();
+        s = QString("LBG: %1 samples, %2 %3 frames (%4 MiB), gaze %5 %6%7")
+                .arg(_volumerender.getLbgSampleCount())
+                .arg(history.getParameters().mode == TemporalHistory::ACCUMULATE ? "averaged"
+                                                                                : "blended")
+                .arg(_volumerender.getFrameBlendCount())
+                .arg(history.getMemoryUsage() / mib, 0, 'f', 1)
+                .arg(gaze.s[0], 0, 'f', 3).arg(gaze.s[1], 0, 'f', 3)
+                .arg(_useEyetracking ? " (" + _gazeSource->name() + ")" : "");
+        if (_progressiveRefinement)
+            s += QString(", refined %1%").arg(
+                        static_cast<int>(_volumerender.getRefinementProgress()*100.f));
+        if (_gazeProcessor.filter().getParameters().enabled)
+            s += QString(", %1, %2 frames held")
+                    .arg(_gazeProcessor.filter().isFixation() ? "fixation" : "moving")
+                    .arg(_heldFrames);
+        const GazePredictor::Stats stats = _gazeProcessor.predictor().getStats();
+        if (_gazeProcessor.predictor().getParameters().enabled && stats.count > 0)
+            s += QString(", error %1/%2 deg").arg(stats.predictedError, 0, 'f', 2)
+                                             .arg(stats.rawError, 0, 'f', 2);
+    }
+    else if (_renderingMethod == MultiResolution)
+    {
+        const cl_float2 gaze = _volumerender.getGazePoint();
+        const size_t pixels = static_cast<size_t>(floor(width() * _imgSamplingRate)
+                                                  * floor(height() * _imgSamplingRate));
+        s = QString("Multi-resolution: %1 layers, %2 rays (%3%), gaze %4 %5%6")
+                .arg(_volumerender.getMultiResParameters().layers)
+                .arg(_volumerender.getMultiResRayCount())
+                .arg(pixels > 0 ? 100 * _volumerender.getMultiResRayCount() / pixels : 0)
+                .arg(gaze.s[0], 0, 'f', 3).arg(gaze.s[1], 0, 'f', 3)
+                .arg(_useEyetracking ? " (" + _gazeSource->name() + ")" : "");
+    }
+    else if (_renderingMethod == VariableRate)
+    {
+        const cl_float2 gaze = _volumerender.getGazePoint();
+        const size_t pixels = static_cast<size_t>(floor(width() * _imgSamplingRate)
+                                                  * floor(height() * _imgSamplingRate));
+        s = QString("Variable rate: %1 rays (%2%), gaze %3 %4%5")
+                .arg(_volumerender.getVariableRateRayCount())
+                .arg(pixels > 0 ? 100 * _volumerender.getVariableRateRayCount() / pixels : 0)
+                .arg(gaze.s[0], 0, 'f', 3).arg(gaze.s[1], 0, 'f', 3)
+                .arg(_useEyetracking ? " (" + _gazeSource->name() + ")" : "");
+    }
+    else
+    {
+        s = "Standard raycasting";
+    }
+    p.drawText(QPointF(graph.left(), graph.top() - 6), s);
 }
 
 
@@ -260,6 +471,15 @@ void VolumeRenderWidget::saveFrame()
     update();
 }
 
+/**
+ * @brief Pipe recorded frames to an external encoder instead of writing PNG files.
+ * @param command Shell command, see FrameCapture::setCommand.
+ */
+void VolumeRenderWidget::setCaptureCommand(const QString &command)
+{
+    _capture.setCommand(command);
+}
+
 /**
  * @brief VolumeRenderWidget::toggleVideoRecording
  */
@@ -289,7 +509,11 @@ void VolumeRenderWidget::toggleViewRecording()
                                                 QDir::currentPath(), tr("All files"));
         if (_viewLogFile.isEmpty())
             return;
+        if (!_viewLog.open(_viewLogFile))
+            qWarning() << "Couldn't open file for saving the camera configurations: " << _viewLogFile;
     }
+    else
+        _viewLog.close();
     updateView();
 }
 
@@ -310,42 +534,25 @@ void VolumeRenderWidget::toggleInteractionLogging()
 			QDir::currentPath(), tr("All files"));
 		if (_interactionLogFile.isEmpty())
 			return;
+		if (!_interactionLog.open(_interactionLogFile))
+		{
+			qWarning() << "Couldn't open file for saving the camera configurations: "
+					   << _interactionLogFile;
+			return;
+		}
 		_timer.restart();
 
 		// log initial configuration
-		QString s;
-		s += QString::number(_timer.elapsed());
-		s += "; tffInterpolation; ";
-		s += _tffInterpol == QEasingCurve::InOutQuad ? "quad" : "linear";
-		s += "\n";
-		// tff
-		s += QString::number(_timer.elapsed());
-		s += "; transferFunction; ";
-		const std::vector<unsigned char> tff = getRawTransferFunction(_tffStops);
-		foreach(unsigned char c, tff)
-		{
-			s += QString::number(static_cast<int>(c)) + " ";
-		}
-		s += "\n";
-		// camera
-		s += QString::number(_timer.elapsed());
-		s += "; camera; ";
-		s += QString::number(_rotQuat.toVector4D().w()) + " ";
-		s += QString::number(_rotQuat.x()) + " " + QString::number(_rotQuat.y()) + " ";
-		s += QString::number(_rotQuat.z()) + ", ";
-		s += QString::number(_translation.x()) + " " + QString::number(_translation.y()) + " ";
-		s += QString::number(_translation.z()) + "\n";
-        // volume timestep
-		s += QString::number(_timer.elapsed());
-		s += "; timestep; ";
-		s += QString::number(_timestep) + "\n";
-        // gaze
-        s += QString::number(_timer.elapsed());
-        s += "; gaze; ";
-        s += QString::number(_renderingMethod == LBG_Sampling ? _last_valid_gaze_position.x : 0) + " ";
-        s += QString::number(_renderingMethod == LBG_Sampling ? _last_valid_gaze_position.y : 0) + "\n";
-		logInteraction(s);
+		const qint64 t = _timer.elapsed();
+		_interactionLog.logTffInterpolation(t, _tffInterpol == QEasingCurve::InOutQuad);
+		_interactionLog.logTransferFunction(t, getRawTransferFunction(_tffStops));
+		_interactionLog.logCamera(t, _camera);
+		_interactionLog.logTimestep(t, _timestep);
+		_interactionLog.logGaze(t, _renderingMethod != Standard ? _last_valid_gaze_position.x : 0,
+		                        _renderingMethod != Standard ? _last_valid_gaze_position.y : 0);
 	}
+	else
+		_interactionLog.close();
 }
 
 void VolumeRenderWidget::setSequenceStep(QString line)
@@ -362,13 +569,8 @@ void VolumeRenderWidget::setSequenceStep(QString line)
     else if (line.contains("camera"))
     {
         int pos = line.lastIndexOf(';');
-        line.remove(',');
-        QStringList values = line.remove(0, pos + 2).split(' ');
-        setCamRotation(QQuaternion(values.at(0).toFloat(), values.at(1).toFloat(),
-                                   values.at(2).toFloat(), values.at(3).toFloat()));
-        setCamTranslation(QVector3D(values.at(4).toFloat(), values.at(5).toFloat(),
-                                    values.at(6).toFloat()));
-        updateViewMatrix();
+        if (_camera.fromString(line.remove(0, pos + 2)))
+            updateViewMatrix();
     }
     else if (line.contains("timestep"))
     {
@@ -391,16 +593,11 @@ void VolumeRenderWidget::setSequenceStep(QString line)
  */
 void VolumeRenderWidget::playInteractionSequence(const QString &fileName)
 {
-    QFile f(fileName);
-    if (!f.isOpen() && !f.open(QFile::ReadOnly | QFile::Text))
-        throw std::invalid_argument("Invalid file name for interaction log: " + fileName.toStdString());
-
-    _interactionSequence.clear();
+    // events with the same time stamp are replayed in one frame
+    _interactionSequence = readInteractionFrames(fileName);
     _interactionSequencePos = 0;
-    QTextStream sqeuence(&f);
-    QString line;
-    while (sqeuence.readLineInto(&line))
-        _interactionSequence.append(line);
+    if (_interactionSequence.empty())
+        return;
 
     toggleVideoRecording();
     _playInteraction = true;
@@ -417,14 +614,7 @@ void VolumeRenderWidget::setTimeStep(int timestep)
     update();
 
 	if (_logInteraction)
-	{
-		QString s;
-		s += QString::number(_timer.elapsed());
-		s += "; timestep; ";
-		s += QString::number(_timestep) + "\n";
-
-		logInteraction(s);
-	}
+		_interactionLog.logTimestep(_timer.elapsed(), _timestep);
 }
 
 /**
@@ -446,32 +636,53 @@ void VolumeRenderWidget::setRenderingMethod(int rm)
 
 void VolumeRenderWidget::setEyetracking(bool eyetracking)
 {
-	if (check_eyetracker_availability(eyetracking)) {
-		if (eyetracking) {
-			// start using eyetracking: subscribe to data
-			TobiiResearchStatus status = tobii_research_subscribe_to_gaze_data(_eyetracker, &VolumeRenderWidget::gaze_data_callback, &_gaze_data);
-			if (status != TOBII_RESEARCH_STATUS_OK) {
-				qCritical() << "Something went wrong when trying to subscribe to eyetracker data.\n";
-			}
-		}
-		else {
-			// stop using eyetracking: unsubscribe to data
-			TobiiResearchStatus status = tobii_research_unsubscribe_from_gaze_data(_eyetracker, &VolumeRenderWidget::gaze_data_callback);
-			if (status != TOBII_RESEARCH_STATUS_OK) {
-				qCritical() << "Something went wrong when trying to unsubscribe to eyetracker data.\n";
-			}
-
-		}
-		_useEyetracking = eyetracking;
+	bool available = true;
+	TobiiGazeSource *tobii = dynamic_cast<TobiiGazeSource*>(_gazeSource.get());
+	if (tobii) {
+		available = check_eyetracker_availability(eyetracking);
+		if (available && tobii->getEyetracker() != _eyetracker)
+			tobii->setEyetracker(_eyetracker);
 	}
-	else {
-		_useEyetracking = false;
+	_gazeSource->stop();
+	if (available && eyetracking) {
+		// start using eyetracking: restart the gaze source with an empty buffer
+		_gazeBuffer.clear();
+		_gazeProcessor.reset();
+		_latency.clear();
+		available = _gazeSource->start();
+		if (!available)
+			qCritical() << "Could not start gaze source" << _gazeSource->name();
+	}
+	_useEyetracking = eyetracking && available;
+	if (!available) {
 		QWidget* ppW = parentWidget()->parentWidget();
 		QCheckBox* eyeCB = ppW->findChild<QCheckBox*>("chbEyetracking");
-		eyeCB->setChecked(false);
+		if (eyeCB)
+			eyeCB->setChecked(false);
 	}
 	update();
-	// std::cout << "use eyetracking: " << _useEyetracking << std::endl;
+}
+
+/**
+ * @brief VolumeRenderWidget::setGazeSource Select the backend used for eyetracking. A running
+ *        source is replaced and the new one is started.
+ * @param source "tobii", "mouse", an interaction log file to replay or "udp:<port>".
+ * @return false if the new source could not be started.
+ */
+bool VolumeRenderWidget::setGazeSource(const QString &source)
+{
+	if (_gazeSource)
+		_gazeSource->stop();
+	if (source == "tobii")
+		_gazeSource.reset(new TobiiGazeSource(_gazeBuffer));
+	else if (source == "mouse")
+		_gazeSource.reset(new MouseGazeSource(_gazeBuffer));
+	else
+		_gazeSource.reset(new ReplayGazeSource(_gazeBuffer, source, true));
+
+	if (_useEyetracking)
+		setEyetracking(true);
+	return !_useEyetracking || _gazeSource->isRunning();
 }
 
 /*
@@ -610,6 +821,7 @@ void VolumeRenderWidget::actionSelectMonitor()
 			_monitor_offset = QPoint(return_data.left, return_data.top);
 			_curr_monitor_width = return_data.right - return_data.left;
 			_curr_monitor_height = return_data.bottom - return_data.top;
+			_gazeProcessor.setDisplaySize(_curr_monitor_width, _curr_monitor_height);
 			qDebug() << QString("Montitor ").append(QString::fromStdString(return_data.device_name)).append(" selected.");
 		}
 		else {
@@ -680,9 +892,140 @@ bool VolumeRenderWidget::check_eyetracker_availability(bool eyetracking)
 
 }
 
-void VolumeRenderWidget::gaze_data_callback(TobiiResearchGazeData * gaze_data, void * user_data)
+/**
+ * @brief Process the gaze samples received since the last frame, see GazeProcessor::process.
+ *        Earlier predictions are compared to the measured gaze and logged with the interactions.
+ * @param sample Output gaze point for the next frame.
+ * @return false if no valid sample has been received.
+ */
+bool VolumeRenderWidget::processGaze(GazeSample &sample)
+{
+    const double frameTime = _volumerender.getLastFrameTiming().values.at(TIMING_HOST);
+    return _gazeProcessor.process(_gazeBuffer, frameTime, sample,
+                                  [this](const GazePredictor::Evaluation &e) {
+        if (_logInteraction)
+            _interactionLog.logPrediction(_timer.elapsed(), e.predicted, e.raw, e.actual,
+                                          static_cast<float>((e.target - e.time) * 1e-3));
+    });
+}
+
+/**
+ * @brief VolumeRenderWidget::setGazeFilter
+ * @param enabled
+ * @param method Fixation detection, velocity (I-VT) or dispersion (I-DT) threshold.
+ * @param pixelsPerDegree Resolution of the eye tracker display in pixels per degree.
+ */
+void VolumeRenderWidget::setGazeFilter(const bool enabled, const GazeFilter::Method method,
+                                       const double pixelsPerDegree)
+{
+    GazeFilter::Parameters params = _gazeProcessor.filter().getParameters();
+    params.enabled = enabled;
+    params.method = method;
+    params.pixelsPerDegree = pixelsPerDegree;
+    params.displayWidth = _gazeProcessor.predictor().getParameters().displayWidth;
+    params.displayHeight = _gazeProcessor.predictor().getParameters().displayHeight;
+    _gazeProcessor.filter().setParameters(params);
+}
+
+/**
+ * @brief VolumeRenderWidget::setGazePrediction
+ * @param enabled
+ * @param displayLatency Time in ms from the end of a frame until it is shown.
+ * @param pixelsPerDegree Resolution of the eye tracker display in pixels per degree.
+ */
+void VolumeRenderWidget::setGazePrediction(const bool enabled, const double displayLatency,
+                                           const double pixelsPerDegree)
+{
+    GazePredictor::Parameters params = _gazeProcessor.predictor().getParameters();
+    params.enabled = enabled;
+    params.pixelsPerDegree = pixelsPerDegree;
+    if (_curr_monitor_width > 0 && _curr_monitor_height > 0)
+    {
+        params.displayWidth = _curr_monitor_width;
+        params.displayHeight = _curr_monitor_height;
+    }
+    else if (QGuiApplication::primaryScreen())
+    {
+        params.displayWidth = QGuiApplication::primaryScreen()->size().width();
+        params.displayHeight = QGuiApplication::primaryScreen()->size().height();
+    }
+    _gazeProcessor.predictor().setParameters(params);
+    _gazeProcessor.predictor().resetStats();
+    _gazeProcessor.setDisplayLatency(displayLatency);
+}
+
+/**
+ * @brief VolumeRenderWidget::setProgressiveRefinement
+ * @param enabled
+ * @param passes
+ */
+void VolumeRenderWidget::setProgressiveRefinement(const bool enabled, const unsigned int passes)
+{
+    _progressiveRefinement = enabled;
+    _volumerender.setRefinementPasses(passes);
+    update();
+}
+
+/**
+ * @brief VolumeRenderWidget::setReprojection
+ * @param reprojection
+ */
+void VolumeRenderWidget::setReprojection(const bool reprojection)
+{
+    _volumerender.setReprojection(reprojection);
+    update();
+}
+
+/**
+ * @brief VolumeRenderWidget::setTemporalHistory
+ * @param parameters
+ */
+void VolumeRenderWidget::setTemporalHistory(const TemporalHistory::Parameters &parameters)
+{
+    try
+    {
+        _volumerender.setTemporalHistory(parameters);
+    }
+    catch (std::invalid_argument e)
+    {
+        qCritical() << e.what();
+    }
+    update();
+}
+
+/**
+ * @brief VolumeRenderWidget::setMultiResParameters
+ * @param parameters
+ */
+void VolumeRenderWidget::setMultiResParameters(const VolumeRenderCL::MultiResParameters &parameters)
+{
+    try
+    {
+        _volumerender.setMultiResParameters(parameters);
+    }
+    catch (std::invalid_argument e)
+    {
+        qCritical() << e.what();
+    }
+    update();
+}
+
+/**
+ * @brief VolumeRenderWidget::setVariableRateParameters
+ * @param parameters
+ */
+void VolumeRenderWidget::setVariableRateParameters(
+        const VolumeRenderCL::VariableRateParameters &parameters)
 {
-	memcpy(user_data, gaze_data, sizeof(*gaze_data));
+    try
+    {
+        _volumerender.setVariableRateParameters(parameters);
+    }
+    catch (std::invalid_argument e)
+    {
+        qCritical() << e.what();
+    }
+    update();
 }
 
 /**
@@ -690,8 +1033,11 @@ void VolumeRenderWidget::gaze_data_callback(TobiiResearchGazeData * gaze_data, v
  */
 void VolumeRenderWidget::paintGL()
 {
+    TRACE_SCOPE("paintGL", "widget");
 	switch (_renderingMethod) {
 	case LBG_Sampling:
+	case MultiResolution:
+	case VariableRate:
 		cl_float2 lcpf;
         if (_bench.active)
         {
@@ -706,54 +1052,49 @@ void VolumeRenderWidget::paintGL()
         }
         else
         {
-            if (_useEyetracking && _gaze_data.right_eye.gaze_point.validity == TOBII_RESEARCH_VALIDITY_VALID)
+            GazeSample sample;
+            if (_useEyetracking && processGaze(sample))
             {
-					lcpf.x = _gaze_data.right_eye.gaze_point.position_on_display_area.x;
-					lcpf.y = _gaze_data.right_eye.gaze_point.position_on_display_area.y;
-                    _last_valid_gaze_position = lcpf;
-			}
+                lcpf.x = sample.x;
+                lcpf.y = sample.y;
+                _last_valid_gaze_position = lcpf;
+                _latency.begin(_gazeProcessor.lastInput());
+            }
             else
+            {
                 lcpf = _last_valid_gaze_position;
+                _latency.cancel();
+            }
 
             // log gaze data
-            if (_logInteraction && _renderingMethod == LBG_Sampling)
-            {
-                QString s;
-                s += QString::number(_timer.elapsed());
-                s += "; gaze; ";
-                s += QString::number(_last_valid_gaze_position.x) + " ";
-                s += QString::number(_last_valid_gaze_position.y) + "\n";
-                logInteraction(s);
-            }
+            if (_logInteraction)
+                _interactionLog.logGaze(_timer.elapsed(), _last_valid_gaze_position.x,
+                                        _last_valid_gaze_position.y);
         }
 		_volumerender.setGazePoint(lcpf);
-		paintGL_LBG_sampling();
+		if (_renderingMethod == LBG_Sampling)
+			paintGL_LBG_sampling();
+		else
+			paintGL_standard();
 //        if (_logInteraction)
 //            paintGL_standard();
 
         if (_bench.active)
-        {
-            QString outString;
-            QTextStream out(&outString);
-            out << _bench.iteration << "; ";
-            out << _rotQuat.toVector4D().w() << " " << _rotQuat.x() << " " << _rotQuat.y() << " "
-                       << _rotQuat.z() << "; ";
-            out << _translation.x() << " " << _translation.y() << " " << _translation.z() << "; ";
-            out << lcpf.x << " " << lcpf.y << "; ";
-            out << _volumerender.getLastExecTime() << "\n";
-            _bench.writeState(out.readAll());
-        }
+            _bench.writeState(_camera, lcpf.x, lcpf.y, _volumerender.getLastExecTime());
 		break;
 	default:
+		_latency.cancel();
 		paintGL_standard();
 		break;
 	}
+    _latency.stamp(STAGE_DRAW);
     if (_contRendering)
         update();
 
     if (_playInteraction)
     {
-        setSequenceStep(_interactionSequence.at(_interactionSequencePos));
+        for (const QString &line : _interactionSequence.at(_interactionSequencePos).split('\n'))
+            setSequenceStep(line);
         _interactionSequencePos++;
         if (_interactionSequencePos >= _interactionSequence.size())
         {
@@ -773,23 +1114,39 @@ void VolumeRenderWidget::paintGL_standard()
 		// OpenCL raycast
 		try
 		{
-			if (_useGL)
+			if (_useGL && _renderingMethod == MultiResolution)
+				_volumerender.runRaycastMultiRes(floor(this->size().width() * _imgSamplingRate),
+					floor(this->size().height()* _imgSamplingRate), _timestep);
+			else if (_useGL && _renderingMethod == VariableRate)
+				_volumerender.runRaycastVariableRate(floor(this->size().width() * _imgSamplingRate),
+					floor(this->size().height()* _imgSamplingRate), _timestep);
+			else if (_useGL)
 				_volumerender.runRaycast(floor(this->size().width() * _imgSamplingRate),
 					floor(this->size().height()* _imgSamplingRate), _timestep);
 			else
 			{
-				std::vector<float> d;
-				_volumerender.runRaycastNoGL(floor(this->size().width() * _imgSamplingRate),
-					floor(this->size().height()* _imgSamplingRate),
-					_timestep, d);
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
+				std::vector<unsigned char> d;
+				if (_renderingMethod == MultiResolution)
+					_volumerender.runRaycastMultiResNoGL(floor(this->size().width() * _imgSamplingRate),
+						floor(this->size().height()* _imgSamplingRate),
+						_timestep, d);
+				else if (_renderingMethod == VariableRate)
+					_volumerender.runRaycastVariableRateNoGL(floor(this->size().width() * _imgSamplingRate),
+						floor(this->size().height()* _imgSamplingRate),
+						_timestep, d);
+				else
+					_volumerender.runRaycastNoGL(floor(this->size().width() * _imgSamplingRate),
+						floor(this->size().height()* _imgSamplingRate),
+						_timestep, d);
+				GLint internalFormat = GL_RGBA8;
+				GLenum type = GL_UNSIGNED_BYTE;
+				getGLTexFormat(internalFormat, type);
+				glTexImage2D(GL_TEXTURE_2D, 0, internalFormat,
 					floor(this->size().width() * _imgSamplingRate),
 					floor(this->size().height()* _imgSamplingRate),
-					0, GL_RGBA, GL_FLOAT,
+					0, GL_RGBA, type,
 					d.data());
 				glGenerateMipmap(GL_TEXTURE_2D);
-				_volumerender.updateOutputImg(static_cast<size_t>(width()),
-					static_cast<size_t>(height()), _outTexId);
 			}
 		}
 		catch (std::runtime_error e)
@@ -798,6 +1155,7 @@ void VolumeRenderWidget::paintGL_standard()
 		}
 		fps = getFps();
 	}
+	_latency.stamp(STAGE_RENDER);
 
 	QPainter p(this);
 	p.beginNativePainting();
@@ -832,19 +1190,22 @@ void VolumeRenderWidget::paintGL_standard()
 
 		if (_volumerender.hasData() && _writeImage)
 		{
-			QImage img = this->grabFramebuffer();
+			// asynchronous read back, written by the capture threads
+			if (!_capture.isActive())
+				_capture.start("img");
 			QString number = QString("%1").arg(_imgCount++, 6, 10, QChar('0'));
+			_capture.capture("frame_" + number + "_" + QString::number(_volumerender.getLastExecTime()),
+				width() * devicePixelRatio(), height() * devicePixelRatio());
 			if (!_recordVideo)
 			{
 				QLoggingCategory category("screenshot");
 				qCInfo(category, "Writing current frame img/frame_%s.png",
 					number.toStdString().c_str());
 				_writeImage = false;
+				const FrameCapture::Stats stats = _capture.stop();
+				qCInfo(category, "Captured %llu frames, dropped %llu.",
+					stats.captured, stats.dropped);
 			}
-			if (!QDir("img").exists())
-				QDir().mkdir("img");
-			img.save("img/frame_" + number + "_"
-				+ QString::number(_volumerender.getLastExecTime()) + ".png");
 		}
 	}
 	p.endNativePainting();
@@ -868,7 +1229,46 @@ void VolumeRenderWidget::paintGL_standard()
 
 void VolumeRenderWidget::paintGL_LBG_sampling() {
 	double fps = 0.0;
-	if (this->_loadingFinished && _volumerender.hasData() && !_noUpdate)
+    const bool still = !_bench.active && _heldVersion == _volumerender.getParameterVersion()
+            && _heldTimestep == _timestep && _heldSize == size();
+    // keep the last image during a fixation if nothing else changed
+    const bool hold = still && _useEyetracking && _gazeProcessor.filter().getParameters().enabled
+            && _gazeProcessor.filter().isFixation();
+    if (still && _progressiveRefinement && _loadingFinished && _volumerender.hasData()
+            && !_noUpdate)
+    {
+        // idle tick: raycast the next full resolution tiles into the still image
+        bool complete = true;
+        try
+        {
+            const size_t w = floor(this->size().width() * _imgSamplingRate);
+            const size_t h = floor(this->size().height() * _imgSamplingRate);
+            if (_useGL)
+                complete = _volumerender.refineLBG(w, h, _timestep, _outTexId);
+            else
+            {
+                std::vector<unsigned char> d;
+                complete = _volumerender.refineLBGNoGL(w, h, _timestep, d);
+                GLint internalFormat = GL_RGBA8;
+                GLenum type = GL_UNSIGNED_BYTE;
+                getGLTexFormat(internalFormat, type);
+                glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, GL_RGBA, type, d.data());
+            }
+        }
+        catch (std::runtime_error e)
+        {
+            qCritical() << e.what();
+        }
+        if (!complete && !_contRendering)
+            QTimer::singleShot(0, this, [this]() { update(); });
+        fps = getFps();
+    }
+    else if (hold)
+    {
+        ++_heldFrames;
+        fps = getFps();
+    }
+	else if (this->_loadingFinished && _volumerender.hasData() && !_noUpdate)
 	{
 		// OpenCL raycast
 		try
@@ -882,8 +1282,6 @@ void VolumeRenderWidget::paintGL_LBG_sampling() {
                                             floor(this->size().height()* _imgSamplingRate),
                                             _timestep);
 
-				fps = _volumerender.getLastExecTime();
-
 				// second texture needs to have one third in each dimension of the index map
 
                 _volumerender.interpolateLBG(floor(_volumerender.getIndexMapExtends().x() / 2.0),
@@ -893,27 +1291,32 @@ void VolumeRenderWidget::paintGL_LBG_sampling() {
 			}
 			else
 			{
-				std::vector<float> d;
+				std::vector<unsigned char> d;
 				_volumerender.runRaycastLBGNoGL(floor(this->size().width() * _imgSamplingRate),
 					floor(this->size().height()* _imgSamplingRate),
 					_timestep, d);
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
+				GLint internalFormat = GL_RGBA8;
+				GLenum type = GL_UNSIGNED_BYTE;
+				getGLTexFormat(internalFormat, type);
+				glTexImage2D(GL_TEXTURE_2D, 0, internalFormat,
 					floor(this->size().width() * _imgSamplingRate),
 					floor(this->size().height()* _imgSamplingRate),
-					0, GL_RGBA, GL_FLOAT,
+					0, GL_RGBA, type,
 					d.data());
                 //glGenerateMipmap(GL_TEXTURE_2D);
-				_volumerender.updateOutputImg(static_cast<size_t>(width()),
-					static_cast<size_t>(height()), _outTexId);
 			}
 		}
 		catch (std::runtime_error e)
 		{
 			qCritical() << e.what();
 		}
-        // offset for render pass + interpolation
-        fps = getFps(fps);
+        // last exec time covers raycast and interpolation
+        fps = getFps();
+        _heldVersion = _volumerender.getParameterVersion();
+        _heldTimestep = _timestep;
+        _heldSize = size();
 	}
+	_latency.stamp(STAGE_RENDER);
 
 	QPainter p(this);
 	p.beginNativePainting();
@@ -958,19 +1361,22 @@ void VolumeRenderWidget::paintGL_LBG_sampling() {
 
 		if (_volumerender.hasData() && _writeImage)
 		{
-			QImage img = this->grabFramebuffer();
+			// asynchronous read back, written by the capture threads
+			if (!_capture.isActive())
+				_capture.start("img_et");
 			QString number = QString("%1").arg(_imgCount++, 6, 10, QChar('0'));
+			_capture.capture("frame_" + number + "_" + QString::number(_volumerender.getLastExecTime()),
+				width() * devicePixelRatio(), height() * devicePixelRatio());
 			if (!_recordVideo)
 			{
 				QLoggingCategory category("screenshot");
-				qCInfo(category, "Writing current frame img/frame_%s.png",
+				qCInfo(category, "Writing current frame img_et/frame_%s.png",
 					number.toStdString().c_str());
 				_writeImage = false;
+				const FrameCapture::Stats stats = _capture.stop();
+				qCInfo(category, "Captured %llu frames, dropped %llu.",
+					stats.captured, stats.dropped);
 			}
-            if (!QDir("img_et").exists())
-                QDir().mkdir("img_et");
-            img.save("img_et/frame_" + number + "_"
-				+ QString::number(_volumerender.getLastExecTime()) + ".png");
 		}
 	}
 	p.endNativePainting();
@@ -999,6 +1405,7 @@ void VolumeRenderWidget::paintGL_LBG_sampling() {
  */
 void VolumeRenderWidget::resizeGL(const int w, const int h)
 {
+    TRACE_SCOPE("resizeGL", "widget");
     _screenQuadProjMX.setToIdentity();
     _screenQuadProjMX.perspective(53.14f, 1.0f, Z_NEAR, Z_FAR);
 
@@ -1065,9 +1472,12 @@ void VolumeRenderWidget::generateOutputTextures(const int width, const int heigh
     }
     else
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+        GLint internalFormat = GL_RGBA8;
+        GLenum type = GL_UNSIGNED_BYTE;
+        getGLTexFormat(internalFormat, type);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat,
                      width, height, 0,
-                     GL_RGBA, GL_UNSIGNED_BYTE,
+                     GL_RGBA, type,
                      nullptr);
     }
     glGenerateMipmap(GL_TEXTURE_2D);
@@ -1078,6 +1488,42 @@ void VolumeRenderWidget::generateOutputTextures(const int width, const int heigh
     updateView(0, 0);
 }
 
+/**
+ * @brief VolumeRenderWidget::getGLTexFormat
+ * @param internalFormat
+ * @param type
+ */
+void VolumeRenderWidget::getGLTexFormat(GLint &internalFormat, GLenum &type) const
+{
+    switch (_volumerender.getImagePrecision())
+    {
+    case VolumeRenderCL::PRECISION_FLOAT:
+        internalFormat = GL_RGBA32F;
+        type = GL_FLOAT;
+        break;
+    case VolumeRenderCL::PRECISION_HALF:
+        internalFormat = GL_RGBA16F;
+        type = GL_HALF_FLOAT;
+        break;
+    default:
+        internalFormat = GL_RGBA8;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    }
+}
+
+/**
+ * @brief VolumeRenderWidget::setImagePrecision
+ * @param precision
+ */
+void VolumeRenderWidget::setImagePrecision(const int precision)
+{
+    _volumerender.setImagePrecision(static_cast<VolumeRenderCL::image_precision>(precision));
+    makeCurrent();
+    this->resizeGL(this->width(), this->height());  // re-create textures and images
+    doneCurrent();
+}
+
 void VolumeRenderWidget::setShowOverlay(bool showOverlay)
 {
     _showOverlay = showOverlay;
@@ -1086,22 +1532,22 @@ void VolumeRenderWidget::setShowOverlay(bool showOverlay)
 
 QQuaternion VolumeRenderWidget::getCamRotation() const
 {
-    return _rotQuat;
+    return _camera.getRotation();
 }
 
 void VolumeRenderWidget::setCamRotation(const QQuaternion &rotQuat)
 {
-    _rotQuat = rotQuat;
+    _camera.setRotation(rotQuat);
 }
 
 QVector3D VolumeRenderWidget::getCamTranslation() const
 {
-    return _translation;
+    return _camera.getTranslation();
 }
 
 void VolumeRenderWidget::setCamTranslation(const QVector3D &translation)
 {
-    _translation = translation;
+    _camera.setTranslation(translation);
 }
 
 /**
@@ -1229,6 +1675,7 @@ void VolumeRenderWidget::setupVertexAttribs()
  */
 void VolumeRenderWidget::setVolumeData(const QString &fileName)
 {
+    TRACE_SCOPE("setVolumeData", "widget");
     this->_noUpdate = true;
     size_t timesteps = 0;
     try
@@ -1267,6 +1714,8 @@ void VolumeRenderWidget::setIndexandSamplingMap(const QString &fileNameIndexMap,
                                               fileNameSamplingMap.toStdString(),
                                               fileNameNeighborIndex,
                                               fileNameNeighborWeights);
+        _lbgMapFiles = QStringList({fileNameIndexMap, fileNameSamplingMap,
+                                    fileNameNeighborIndex, fileNameNeighborWeights});
 	}
 	catch (std::invalid_argument e)
 	{
@@ -1331,15 +1780,7 @@ void VolumeRenderWidget::setTffInterpolation(const QString method)
         _tffInterpol = QEasingCurve::Linear;
 
 	if (_logInteraction)
-	{
-		QString s;
-		s += QString::number(_timer.elapsed());
-		s += "; tffInterpolation; ";
-		s += _tffInterpol == QEasingCurve::InOutQuad ? "quad" : "linear";
-		s += "\n";
-
-		logInteraction(s);
-	}
+		_interactionLog.logTffInterpolation(_timer.elapsed(), _tffInterpol == QEasingCurve::InOutQuad);
 }
 
 /**
@@ -1365,6 +1806,7 @@ void VolumeRenderWidget::setRawTransferFunction(std::vector<unsigned char> tff)
  */
 void VolumeRenderWidget::updateTransferFunction(QGradientStops stops)
 {
+    TRACE_SCOPE("updateTransferFunction", "widget");
     const int tffSize = 256;
     const qreal granularity = 4096.0;
     std::vector<uchar> tff(tffSize*4);
@@ -1406,17 +1848,7 @@ void VolumeRenderWidget::updateTransferFunction(QGradientStops stops)
     _tffStops = stops;
 
 	if (_logInteraction)
-	{
-		QString s;
-		s += QString::number(_timer.elapsed());
-		s += "; transferFunction; ";
-		const std::vector<unsigned char> tff = getRawTransferFunction(stops);
-		foreach (unsigned char c, tff)
-		{
-			s += QString::number(static_cast<int>(c)) + " ";
-		}
-		s += "\n";
-	}
+		_interactionLog.logTransferFunction(_timer.elapsed(), getRawTransferFunction(stops));
 }
 
 std::vector<unsigned char> VolumeRenderWidget::getRawTransferFunction(QGradientStops stops) const
@@ -1459,6 +1891,9 @@ void VolumeRenderWidget::setGazeFromCursorPos(const QPoint &cursorPos)
 {
     _last_valid_gaze_position = {{qBound(0.f, cursorPos.x() / static_cast<float>(width()), 1.f),
                                   qBound(0.f, cursorPos.y() / static_cast<float>(height()), 1.f)}};
+    MouseGazeSource *mouse = dynamic_cast<MouseGazeSource*>(_gazeSource.get());
+    if (mouse)
+        mouse->setPosition(_last_valid_gaze_position.x, _last_valid_gaze_position.y);
 }
 
 /**
@@ -1486,40 +1921,9 @@ void VolumeRenderWidget::mouseReleaseEvent(QMouseEvent *event)
 /**
  * @brief VolumeRenderWidget::recordView
  */
-void VolumeRenderWidget::recordViewConfig() const
+void VolumeRenderWidget::recordViewConfig()
 {
-    QFile saveQuat(_viewLogFile + "_quat.txt");
-    QFile saveTrans(_viewLogFile + "_trans.txt");
-    if (!saveQuat.open(QFile::WriteOnly | QFile::Append)
-            || !saveTrans.open(QFile::WriteOnly | QFile::Append))
-    {
-        qWarning() << "Couldn't open file for saving the camera configurations: "
-                   << _viewLogFile;
-        return;
-    }
-
-    QTextStream quatStream(&saveQuat);
-    quatStream << _rotQuat.toVector4D().w() << " " << _rotQuat.x() << " " << _rotQuat.y() << " "
-               << _rotQuat.z() << "; ";
-    QTextStream transStream(&saveTrans);
-    transStream << _translation.x() << " " << _translation.y() << " " << _translation.z() << "; ";
-}
-
-
-/**
- *
- */
-void VolumeRenderWidget::logInteraction(const QString &str) const
-{
-	QFile f(_interactionLogFile);
-	if (!f.open(QFile::WriteOnly | QFile::Append))
-	{
-		qWarning() << "Couldn't open file for saving the camera configurations: "
-				   << _interactionLogFile;
-		return;
-	}
-	QTextStream fileStream(&f);
-	fileStream << str;
+    _viewLog.logView(QDateTime::currentMSecsSinceEpoch(), _camera);
 }
 
 /**
@@ -1527,31 +1931,16 @@ void VolumeRenderWidget::logInteraction(const QString &str) const
  */
 void VolumeRenderWidget::resetCam()
 {
-    _rotQuat = QQuaternion(1, 0, 0, 0);
-    _translation = QVector3D(0, 0, 2.0);
+    _camera.reset();
     updateView();
 }
 
 void VolumeRenderWidget::updateViewMatrix()
 {
-    QMatrix4x4 viewMat;
-//    viewMat.scale(QVector3D(1,1,1./_zScale));
-    viewMat.rotate(_rotQuat);
-
-    _coordViewMX.setToIdentity();
-    _coordViewMX.scale(1, -1, 1);
-    _coordViewMX.translate(_translation * -1.0);
-    _coordViewMX *= QMatrix4x4(_rotQuat.toRotationMatrix().transposed());
-
-    viewMat.translate(_translation);
-    viewMat.scale(_translation.z());
-
-    std::array<float, 16> viewArray;
-    for (size_t i = 0; i < viewArray.size(); ++i)
-        viewArray.at(i) = viewMat.transposed().constData()[i];
+    _coordViewMX = _camera.getCoordViewMatrix();
     try
     {
-        _volumerender.updateView(viewArray);
+        _volumerender.updateView(_camera.getViewMatrix());
     }
     catch (std::runtime_error e)
     {
@@ -1571,31 +1960,19 @@ void VolumeRenderWidget::updateView(float dx, float dy)
         _bench.iteration++;
         dx = static_cast<float>(std::generate_canonical<float, std::numeric_limits<float>::digits>(_prng));
         dy = static_cast<float>(std::generate_canonical<float, std::numeric_limits<float>::digits>(_prng));
-        _translation.setZ(static_cast<float>(std::generate_canonical<float, std::numeric_limits<float>::digits>(_prng)) * 4);
+        QVector3D trans = _camera.getTranslation();
+        trans.setZ(static_cast<float>(std::generate_canonical<float, std::numeric_limits<float>::digits>(_prng)) * 4);
+        _camera.setTranslation(trans);
     }
 
-    QVector3D rotAxis = QVector3D(dy, dx, 0.0f).normalized();
-    float angle = QVector2D(dx, dy).length()*360.f;
-    _rotQuat = _rotQuat * QQuaternion::fromAxisAndAngle(rotAxis, -angle);
+    _camera.rotate(dx, dy);
     updateViewMatrix();
     update();
 
     if (_logView)
         recordViewConfig();
 	if (_logInteraction)
-	{
-		QString s;
-		s += QString::number(_timer.elapsed());
-		s += "; camera; ";
-		s += QString::number(_rotQuat.toVector4D().w()) + " ";
-		s += QString::number(_rotQuat.x()) + " " + QString::number(_rotQuat.y()) + " ";
-		s += QString::number(_rotQuat.z()) + ", ";
-
-		s += QString::number(_translation.x()) + " " + QString::number(_translation.y()) + " ";
-		s += QString::number(_translation.z()) + "\n";
-
-		logInteraction(s);
-	}
+		_interactionLog.logCamera(_timer.elapsed(), _camera);
 }
 
 
@@ -1625,8 +2002,10 @@ void VolumeRenderWidget::mouseMoveEvent(QMouseEvent *event)
         if (event->modifiers() & Qt::ShiftModifier)
             sensitivity = 1;
 
-        _translation.setX(_translation.x() - dx*sensitivity);
-        _translation.setY(_translation.y() + dy*sensitivity);
+        QVector3D trans = _camera.getTranslation();
+        trans.setX(trans.x() - dx*sensitivity);
+        trans.setY(trans.y() + dy*sensitivity);
+        _camera.setTranslation(trans);
         updateView();
     }
 
@@ -1648,7 +2027,9 @@ void VolumeRenderWidget::wheelEvent(QWheelEvent *event)
         t *= 6.0;
 
     // limit translation to origin, otherwise camera setup breaks (flips)
-    _translation.setZ(qMax(0.01, _translation.z() - event->angleDelta().y() / t));
+    QVector3D trans = _camera.getTranslation();
+    trans.setZ(qMax(0.01, trans.z() - event->angleDelta().y() / t));
+    _camera.setTranslation(trans);
     updateView();
     event->accept();
 }
@@ -1770,6 +2151,16 @@ void VolumeRenderWidget::setAerial(const bool aerial)
     this->updateView();
 }
 
+/**
+ * @brief VolumeRenderWidget::setPreIntegration
+ * @param preIntegration
+ */
+void VolumeRenderWidget::setPreIntegration(const bool preIntegration)
+{
+    _volumerender.setPreIntegration(preIntegration);
+    this->updateView();
+}
+
 /**
  * @brief VolumeRenderWidget::setImgEss
  * @param useEss
@@ -1882,10 +2273,8 @@ void VolumeRenderWidget::read(const QJsonObject &json)
         QStringList sl = json["camRotation"].toVariant().toString().split(' ');
         if (sl.length() >= 4)
         {
-            _rotQuat.setScalar(sl.at(0).toFloat());
-            _rotQuat.setX(sl.at(1).toFloat());
-            _rotQuat.setY(sl.at(2).toFloat());
-            _rotQuat.setZ(sl.at(3).toFloat());
+            _camera.setRotation(QQuaternion(sl.at(0).toFloat(), sl.at(1).toFloat(),
+                                            sl.at(2).toFloat(), sl.at(3).toFloat()));
         }
     }
     if (json.contains("camTranslation"))
@@ -1893,9 +2282,8 @@ void VolumeRenderWidget::read(const QJsonObject &json)
         QStringList sl = json["camTranslation"].toVariant().toString().split(' ');
         if (sl.length() >= 3)
         {
-            _translation.setX(sl.at(0).toFloat());
-            _translation.setY(sl.at(1).toFloat());
-            _translation.setZ(sl.at(2).toFloat());
+            _camera.setTranslation(QVector3D(sl.at(0).toFloat(), sl.at(1).toFloat(),
+                                             sl.at(2).toFloat()));
         }
     }
     updateView();
@@ -1907,11 +2295,13 @@ void VolumeRenderWidget::read(const QJsonObject &json)
  */
 void VolumeRenderWidget::write(QJsonObject &json) const
 {
-    QString sTmp = QString::number(_rotQuat.scalar()) + " " + QString::number(_rotQuat.x())
-                   + " " + QString::number(_rotQuat.y()) + " " + QString::number(_rotQuat.z());
+    const QQuaternion rot = _camera.getRotation();
+    const QVector3D trans = _camera.getTranslation();
+    QString sTmp = QString::number(rot.scalar()) + " " + QString::number(rot.x())
+                   + " " + QString::number(rot.y()) + " " + QString::number(rot.z());
     json["camRotation"] = sTmp;
-    sTmp = QString::number(_translation.x()) + " " + QString::number(_translation.y())
-            + " " + QString::number(_translation.z());
+    sTmp = QString::number(trans.x()) + " " + QString::number(trans.y())
+            + " " + QString::number(trans.z());
     json["camTranslation"] = sTmp;
 }
 
@@ -1937,6 +2327,8 @@ void VolumeRenderWidget::toggleBenchmark() //QString logFileName, int gaze_itera
     qInfo() << (_bench.active ? "Stopped benchmark run." : "Started benchmark run.");
 
     _bench.active = !_bench.active;
+    if (!_bench.active)
+        _bench.log.close();
     if (_bench.active)
     {
 		if (logFileName.isEmpty()) {
@@ -1973,88 +2365,73 @@ void VolumeRenderWidget::toggleBenchmark() //QString logFileName, int gaze_itera
 /*
 * Select a folder to save the benchmarks to and select a folder which contains a folder for each volume to be benchmarked.
 * In each of those folders there has to exist a volume file (.dat with the appropriate .raw) and a transferfunction file (.tff) (loaded as raw values).
-* In the previously selected folder to save the benchmarks to, the same folder structure will be created but in each folder there will be two benchmarks,
-* one for the standard method and one for the lbg-sampling method.
+* The benchmarks are run headless by a BenchmarkRunner on the current OpenCL device, one result file per volume and method
+* (standard and, if index and sampling maps have been loaded, lbg-sampling) is written to the selected folder.
 */
 void VolumeRenderWidget::do_all_Benchmarks()
 {
+	if (_benchmarkWatcher.isRunning())
+	{
+		qWarning() << "Benchmarks are already running.";
+		return;
+	}
 	std::cout << "Starting to do all benchmarks." << std::endl;
 
 	QFileDialog dialog;
 	QString directorySavePath = dialog.getExistingDirectory(this, tr("Select the Folder to save the benchmarks results to."),
 		QDir::currentPath());
-	
 	QString directoryVolumesPath = dialog.getExistingDirectory(this, tr("Select the Folder containing the the folders to the volumes and transferfunctions."),
 		QDir::currentPath());
+	if (directorySavePath.isEmpty() || directoryVolumesPath.isEmpty())
+		return;
 
-	std::cout << "directorySavePath: " << directorySavePath.toStdString() << std::endl;
-	std::cout << "directoryVolumesPath: " << directoryVolumesPath.toStdString() << std::endl;
-
-	QDirIterator it(directoryVolumesPath, QDirIterator::NoIteratorFlags);
-	std::cout << "Direcotries in directoryVolumesPath:" << std::endl;
-	
-	// iterate the directories and do the benchmarks for each of them
+	BenchmarkRunner runner;
+	runner.setOutputDirectory(directorySavePath);
+	runner.setLbgMaps(_lbgMapFiles);
+	runner.setDevice(false, QString::fromStdString(_volumerender.getCurrentDeviceName()));
+	QJsonObject cfg;
+	cfg["resolutions"] = QJsonArray({QJsonArray({static_cast<int>(width() * _imgSamplingRate),
+	                                             static_cast<int>(height() * _imgSamplingRate)})});
+	cfg["gazeIterations"] = static_cast<int>(_bench.gaze_iterations);
+	runner.read(cfg);
+
+	// iterate the directories and add a data set for each of them
+	QDirIterator it(directoryVolumesPath, QDir::Dirs | QDir::NoDotAndDotDot);
 	while (it.hasNext()) {
 		it.next();
-		
-		if (it.fileName() == "." || it.fileName() == "..") {
-			// skip '.' and '..' directories, only want folders
-			it.next();
-			continue;
-		}
-
 		QDir cBD = QDir(it.filePath());
 
-		std::cout << "currentBenchmarkDirectoryPath: " << cBD.absolutePath().toStdString() << std::endl;
-		std::cout << "currentBenchmarkDirectoryName: " << cBD.dirName().toStdString() << std::endl;
-		
 		// search for .dat file
 		cBD.setNameFilters(QStringList() << "*.dat");
 		if (cBD.entryList().isEmpty()) {
 			std::cout << "could not find the volume file for : " << cBD.dirName().toStdString() << std::endl;
 			continue;
 		}
-		QString volume_file = cBD.entryList().first();
+		QString volume_file = cBD.absoluteFilePath(cBD.entryList().first());
 
 		cBD.setNameFilters(QStringList() << "*.tff");
 		if (cBD.entryList().isEmpty()) {
 			std::cout << "could not find the tff file for : " << cBD.dirName().toStdString() << std::endl;
 			continue;
 		}
-		QString tff_file = cBD.entryList().first();
+		QString tff_file = cBD.absoluteFilePath(cBD.entryList().first());
 
-		std::cout << "volume_file: " << volume_file.toStdString() << std::endl;
-		std::cout << "tff_file: " << tff_file.toStdString() << std::endl;
+		runner.addDataSet(cBD.dirName(), volume_file, tff_file);
+	}
 
-		// load volume
-		setVolumeData(cBD.absolutePath() + QDir::separator() + volume_file);
-		
-		// load raw values of tff
-		std::ifstream tff_file_((cBD.absolutePath() + QDir::separator() + tff_file).toStdString(), std::ios::in);
-		float value = 0;
-		std::vector<unsigned char> values;
-		// read lines from file and split on whitespace
-		if (tff_file_.is_open())
+	// the runner uses its own renderer without GL sharing, run the batch off the GUI thread
+	QApplication::setOverrideCursor(Qt::BusyCursor);
+	_benchmarkWatcher.setFuture(QtConcurrent::run([runner, directorySavePath]() mutable {
+		size_t n = 0;
+		try
 		{
-			while (tff_file_ >> value)
-			{
-				values.push_back((char)value);
-			}
-			tff_file_.close();
-			setRawTransferFunction(values);
+			n = runner.run();
+			std::cout << "Wrote " << n << " benchmark result files to " << directorySavePath.toStdString() << std::endl;
 		}
-		else
+		catch (std::exception &e)
 		{
-			qDebug() << "Could not open transfer function file " + tff_file;
+			qCritical() << e.what();
 		}
-
-		// TODO: Benchmark with Standard
-
-		// TODO: Benchmark with LBG-Sampling
-				
-
-	}
-
-
-	updateView();
+		return n;
+	}));
 }
@@ -44,12 +44,17 @@
 #include <qcheckbox.h>
 #include <QRandomGenerator>
 #include <QDirIterator>
+#include <QFutureWatcher>
 
 #include "src/core/volumerendercl.h"
+#include "src/core/camera.h"
+#include "src/core/eventlogger.h"
+#include "src/gaze/gazebuffer.h"
+#include "src/gaze/gazelatency.h"
+#include "src/gaze/gazeprocessor.h"
+#include "src/gaze/tobiigazesource.h"
+#include "src/qt/framecapture.h"
 
-#include <inc/TOBIIRESEARCH/tobii_research.h>
-#include <inc/TOBIIRESEARCH/tobii_research_eyetracker.h>
-#include <inc/TOBIIRESEARCH/tobii_research_streams.h>
 #include <inc/TOBIIRESEARCH/tobii_research_calibration.h>
 
 
@@ -59,7 +64,8 @@ struct Benchmark
     quint64 iteration = 0;
     quint64 gaze_iterations = 100;    // gaze iterations per camera state
     QString logFileName = "";
-    QFile f;
+    QElapsedTimer timer;
+    EventLogger log;                  // written asynchronously, converted to text on close
 
     bool isCameraIteration()
     {
@@ -67,20 +73,18 @@ struct Benchmark
         return (this->iteration % this->gaze_iterations) == 0;
     }
 
-    void writeState(const QString &str)
+    void writeState(const Camera &camera, const float gazeX, const float gazeY, const double execTime)
     {
-        if (!f.isOpen() && !logFileName.isEmpty())
+        if (!log.isOpen() && !logFileName.isEmpty())
         {
-            this->f.setFileName(this->logFileName);
-            bool ok = f.open(QFile::WriteOnly);
-            if (!ok)
+            if (!log.open(this->logFileName))
             {
                 qWarning() << "Failed to open benchmark file" << logFileName;
                 return;
             }
+            timer.start();
         }
-        QTextStream fileStream(&f);
-        fileStream << str;
+        log.logBenchmark(timer.elapsed(), iteration, camera, gazeX, gazeY, execTime);
     }
 };
 
@@ -128,7 +132,7 @@ public:
     QQuaternion getCamRotation() const;
     void setCamRotation(const QQuaternion &rotQuat);
 
-	enum RenderingMethod { Standard, LBG_Sampling };
+	enum RenderingMethod { Standard, LBG_Sampling, MultiResolution, VariableRate };
 	void setRenderingMethod(int rm);	/* sets the current rending method
 	updates RenderingParameters of the kernel and calls update() to update the screen. */
 
@@ -160,6 +164,11 @@ public slots:
     void setLinearInterpolation(const bool linear);
     void setContours(const bool contours);
     void setAerial(const bool aerial);
+    /**
+     * @brief Classify ray segments using the pre-integrated transfer function.
+     * @param preIntegration
+     */
+    void setPreIntegration(const bool preIntegration);
     /**
      * @brief Set image order empty space skipping.
      * @param useEss
@@ -173,10 +182,42 @@ public slots:
     void setDrawBox(bool box);
     void setBackgroundColor(const QColor col);
     void setImageSamplingRate(const double samplingRate);
+    /**
+     * @brief Set the precision of the output and intermediate images.
+     * @param precision Index into VolumeRenderCL::image_precision.
+     */
+    void setImagePrecision(const int precision);
     void setShowOverlay(bool showOverlay);
 
     void saveFrame();
     void toggleVideoRecording();
+    void setCaptureCommand(const QString &command);
+    void setGazePrediction(const bool enabled, const double displayLatency,
+                           const double pixelsPerDegree);
+    void setGazeFilter(const bool enabled, const GazeFilter::Method method,
+                       const double pixelsPerDegree);
+    bool setGazeSource(const QString &source);
+    /**
+     * @brief Refine still LBG frames to full resolution on idle ticks.
+     * @param passes Number of ticks until the image is complete.
+     */
+    void setProgressiveRefinement(const bool enabled, const unsigned int passes = 16);
+    /**
+     * @brief Reproject the LBG temporal history on camera motion instead of discarding it.
+     */
+    void setReprojection(const bool reprojection);
+    /**
+     * @brief Set mode, depth and format of the LBG temporal history.
+     */
+    void setTemporalHistory(const TemporalHistory::Parameters &parameters);
+    /**
+     * @brief Set the layer configuration of the multi-resolution rendering method.
+     */
+    void setMultiResParameters(const VolumeRenderCL::MultiResParameters &parameters);
+    /**
+     * @brief Set the shading rate control of the variable rate rendering method.
+     */
+    void setVariableRateParameters(const VolumeRenderCL::VariableRateParameters &parameters);
     void toggleViewRecording();
 	void toggleInteractionLogging();
     void setTimeStep(int timestep);
@@ -210,6 +251,8 @@ private:
     void setGazeFromCursorPos(const QPoint &cursorPos);
     void paintOrientationAxis(QPainter &p);
     void paintFps(QPainter &p, const double fps, const double lastTime);
+    void paintPerformanceHud(QPainter &p);
+    bool processGaze(GazeSample &sample);
     double getFps(double offset=0.0);
 
 	// Different methods called from within the paintGL()-method
@@ -218,7 +261,6 @@ private:
 
 	// Eyetracking
 	bool check_eyetracker_availability(bool eyetracking);	// Checks if the currently selected eyetracker (_eyetracker) exists
-	static void gaze_data_callback(TobiiResearchGazeData *gaze_data, void *user_data);
 
     /**
      * @brief Initialize the OpenCL volume renderer.
@@ -234,17 +276,17 @@ private:
 	 */
     void generateOutputTextures(const int width, const int height, GLuint* texture, GLuint tex_unit);
 
-	/**
-	 * @brief Log camera configurations rotation and zoom) to two files selected by the user.
-	 */
-    void recordViewConfig() const;
+    /**
+     * @brief Get the OpenGL texture format matching the image precision of the renderer.
+     * @param internalFormat Internal texture format, e.g. GL_RGBA8.
+     * @param type Pixel data type, e.g. GL_UNSIGNED_BYTE.
+     */
+    void getGLTexFormat(GLint &internalFormat, GLenum &type) const;
 
 	/**
-	 * @brief Log a user interaction to file.
-	 * @param str String containing the user interaction in the fowllowing format:
-	 *	          time stamp, interaction type, interaction parameters
+	 * @brief Log camera configurations rotation and zoom) to two files selected by the user.
 	 */
-	void logInteraction(const QString &str) const;
+    void recordViewConfig();
     void setSequenceStep(QString line);
 
     // -------Member variables--------
@@ -271,7 +313,16 @@ private:
 
 	// Eyetracking
 	TobiiResearchEyeTracker* _eyetracker;	// points to the currently selected eyetracker
-	TobiiResearchGazeData _gaze_data;	// holds the latest collected data from the eyetracking callback
+	GazeBuffer _gazeBuffer;	// gaze samples pushed by the gaze source
+    std::unique_ptr<GazeSource> _gazeSource;   // tobii, mouse or replay, see setGazeSource()
+    GazeProcessor _gazeProcessor;
+    LatencyRecorder _latency;   // gaze-to-photon latency of the frames rendered with eyetracking
+    QFutureWatcher<size_t> _benchmarkWatcher;  // benchmark batch running on the thread pool
+    uint64_t _heldVersion = UINT64_MAX;   // renderer parameters of the last rendered LBG frame
+    int _heldTimestep = -1;
+    QSize _heldSize;
+    quint64 _heldFrames = 0;    // frames kept during fixations
+    bool _progressiveRefinement = false;
 	cl_float2 _last_valid_gaze_position;
 
 	// Monitorselection
@@ -281,8 +332,7 @@ private:
 
     // global rendering flags
     QPoint _lastLocalCursorPos;
-    QQuaternion _rotQuat;
-    QVector3D _translation;
+    Camera _camera;
 
 	bool _useEyetracking;
     bool _noUpdate;
@@ -290,6 +340,7 @@ private:
     bool _writeImage;
     bool _recordVideo;
     qint64 _imgCount;
+    FrameCapture _capture;
     QVector<double> _times;
     double _imgSamplingRate;       // image oversampling rate
     bool _useGL;
@@ -298,6 +349,8 @@ private:
 	bool _logInteraction;
     QString _viewLogFile;
 	QString _interactionLogFile;
+    EventLogger _viewLog;
+    EventLogger _interactionLog;
     bool _contRendering;
     QGradientStops _tffStops;
 	QElapsedTimer _timer;
@@ -305,6 +358,7 @@ private:
     QRandomGenerator64 _prng;
     Benchmark _bench;
     QStringList _interactionSequence;
+    QStringList _lbgMapFiles;   // index map, sampling map, neighbor ids and weights for benchmarks
     int _interactionSequencePos = 0;
     bool _playInteraction = false;
 };